@@ -0,0 +1,274 @@
+// File: src/visual_code/VCPromptNgramEmbedding.hpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Cheap CPU text featurizer for the `text_vec` that VCVisualTracePipeline
+//   and ILatentGenerator take, built from the sanitized core prompt without
+//   a text encoder. Uses:
+//
+//   - Fallback conditioning vector when the text encoder is saturated
+//   - Cache key / near-duplicate fingerprint (sim_hash)
+//   - Dedup and retrieval by cosine similarity
+//
+//   Features are hashed word n-grams (1..word_ngram_max) and character
+//   n-grams (char_ngram_min..char_ngram_max, within word-padded text). Each
+//   feature hashes to a bucket and a sign (signed feature hashing, so
+//   collisions cancel in expectation rather than pile up).
+//
+//   - Without a projection the buckets are the output dimensions.
+//   - With a learned projection (hash_buckets x output_dim, row-major) each
+//     feature adds its signed, weighted row to the output. That is one
+//     SIMD axpy per feature (AVX / SSE2 / NEON), so the cost scales with the
+//     prompt length, not with hash_buckets x output_dim.
+//
+//   The result is L2-normalized. Embeddings are deterministic across
+//   platforms for a given config (fixed 64-bit hashing, no locale).
+
+#pragma once
+#include "VCVisualLatentTrace.hpp"
+
+#include <cstring>
+#include <string_view>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VCVISUAL_NGRAM_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VCVISUAL_NGRAM_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VCVISUAL_NGRAM_NEON 1
+#endif
+
+namespace vcvisual {
+
+/// Featurizer settings; the embedding space is defined by all of them, so
+/// persist the config next to any index built from these vectors.
+struct VCNgramEmbeddingConfig {
+    size_t output_dim = 768;           // text_vec size handed to the generator
+    size_t hash_buckets = 1u << 16;    // used with a projection; else = output_dim
+    int word_ngram_max = 2;            // 1 = unigrams only
+    int char_ngram_min = 3;
+    int char_ngram_max = 5;            // 0 disables character n-grams
+    float word_weight = 1.0f;
+    float char_weight = 0.5f;
+    uint64_t seed = 0x5EED5EED5EED5EEDull;
+};
+
+namespace detail {
+
+inline uint64_t ngram_mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t ngram_hash_bytes(const char* s, size_t n, uint64_t seed) {
+    uint64_t h = 0xCBF29CE484222325ull ^ seed;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 0x100000001B3ull;
+    }
+    return ngram_mix64(h);
+}
+
+/// y[0..n) += a * x[0..n)
+inline void ngram_axpy(float* y, const float* x, float a, size_t n) {
+    size_t i = 0;
+#if defined(VCVISUAL_NGRAM_AVX)
+    const __m256 va = _mm256_set1_ps(a);
+    for (; i + 8 <= n; i += 8) {
+        __m256 vy = _mm256_loadu_ps(y + i);
+        vy = _mm256_add_ps(vy, _mm256_mul_ps(va, _mm256_loadu_ps(x + i)));
+        _mm256_storeu_ps(y + i, vy);
+    }
+#elif defined(VCVISUAL_NGRAM_SSE2)
+    const __m128 va = _mm_set1_ps(a);
+    for (; i + 4 <= n; i += 4) {
+        __m128 vy = _mm_loadu_ps(y + i);
+        vy = _mm_add_ps(vy, _mm_mul_ps(va, _mm_loadu_ps(x + i)));
+        _mm_storeu_ps(y + i, vy);
+    }
+#elif defined(VCVISUAL_NGRAM_NEON)
+    const float32x4_t va = vdupq_n_f32(a);
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(y + i, vmlaq_f32(vld1q_f32(y + i), va, vld1q_f32(x + i)));
+#endif
+    for (; i < n; ++i) y[i] += a * x[i];
+}
+
+inline float ngram_dot(const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    float acc = 0.0f;
+#if defined(VCVISUAL_NGRAM_AVX)
+    __m256 s = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+        s = _mm256_add_ps(s, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, s);
+    for (float v : lanes) acc += v;
+#elif defined(VCVISUAL_NGRAM_SSE2)
+    __m128 s = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4)
+        s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, s);
+    acc = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(VCVISUAL_NGRAM_NEON)
+    float32x4_t s = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4)
+        s = vmlaq_f32(s, vld1q_f32(a + i), vld1q_f32(b + i));
+    acc = (vgetq_lane_f32(s, 0) + vgetq_lane_f32(s, 1)) +
+          (vgetq_lane_f32(s, 2) + vgetq_lane_f32(s, 3));
+#endif
+    for (; i < n; ++i) acc += a[i] * b[i];
+    return acc;
+}
+
+} // namespace detail
+
+/// Cosine similarity of two embeddings of the same config (they are
+/// L2-normalized, so this is their dot product).
+inline float ngram_cosine(const VCFloatVec& a, const VCFloatVec& b) {
+    if (a.dim() != b.dim()) throw std::invalid_argument("ngram_cosine: dimension mismatch");
+    return detail::ngram_dot(a.data.data(), b.data.data(), a.dim());
+}
+
+/// 64-bit SimHash of an embedding: bit k is the sign of its dot product
+/// with a fixed pseudo-random +-1 direction. Near-duplicate prompts share
+/// most bits; identical prompts give identical keys.
+inline uint64_t ngram_sim_hash(const VCFloatVec& v) {
+    uint64_t key = 0;
+    for (int bit = 0; bit < 64; ++bit) {
+        double acc = 0.0;
+        uint64_t state = detail::ngram_mix64(0x9E3779B97F4A7C15ull * (bit + 1));
+        for (size_t i = 0; i < v.dim(); i += 64) {
+            const size_t end = std::min(v.dim(), i + 64);
+            for (size_t j = i; j < end; ++j)
+                acc += ((state >> (j - i)) & 1u) ? v.data[j] : -v.data[j];
+            state = detail::ngram_mix64(state);
+        }
+        if (acc > 0.0) key |= uint64_t{1} << bit;
+    }
+    return key;
+}
+
+class VCPromptNgramEmbedder {
+public:
+    explicit VCPromptNgramEmbedder(const VCNgramEmbeddingConfig& cfg = VCNgramEmbeddingConfig())
+        : cfg_(cfg) {
+        if (cfg_.output_dim == 0)
+            throw std::invalid_argument("VCPromptNgramEmbedder: output_dim must be positive");
+        if (cfg_.word_ngram_max < 1)
+            throw std::invalid_argument("VCPromptNgramEmbedder: word_ngram_max must be >= 1");
+        if (cfg_.char_ngram_max > 0 &&
+            (cfg_.char_ngram_min < 1 || cfg_.char_ngram_min > cfg_.char_ngram_max))
+            throw std::invalid_argument("VCPromptNgramEmbedder: bad char n-gram range");
+        if (cfg_.hash_buckets == 0)
+            throw std::invalid_argument("VCPromptNgramEmbedder: hash_buckets must be positive");
+    }
+
+    /// Installs a learned projection: `weights` is hash_buckets rows of
+    /// output_dim floats (row b is the vector feature bucket b contributes).
+    void set_projection(const float* weights, size_t count) {
+        if (count != cfg_.hash_buckets * cfg_.output_dim)
+            throw std::invalid_argument("VCPromptNgramEmbedder: projection must be hash_buckets x output_dim");
+        projection_.assign(weights, weights + count);
+    }
+
+    void clear_projection() { projection_.clear(); }
+    bool has_projection() const { return !projection_.empty(); }
+    const VCNgramEmbeddingConfig& config() const { return cfg_; }
+
+    /// Embeds sanitized prompt text (e.g. VCScenePlan::corePrompt) into
+    /// `out`, reusing its storage.
+    void embed(std::string_view text, VCFloatVec& out) const {
+        out.data.assign(cfg_.output_dim, 0.0f);
+        float* y = out.data.data();
+        const size_t buckets = has_projection() ? cfg_.hash_buckets : cfg_.output_dim;
+
+        auto add = [&](uint64_t h, float w) {
+            const size_t b = static_cast<size_t>(((h & 0xFFFFFFFFull) * buckets) >> 32);
+            const float s = (h >> 63) ? -w : w;
+            if (has_projection())
+                detail::ngram_axpy(y, projection_.data() + b * cfg_.output_dim, s, cfg_.output_dim);
+            else
+                y[b] += s;
+        };
+
+        // Lowercased, word-padded copy: " w1 w2 ... wn ". Separators are ASCII
+        // non-alphanumerics; UTF-8 bytes stay inside words.
+        std::string& norm = scratch_text();
+        norm.assign(1, ' ');
+        for (char c : text) {
+            const unsigned char u = static_cast<unsigned char>(c);
+            const bool word = u >= 0x80 || (u >= '0' && u <= '9') || (u >= 'a' && u <= 'z') ||
+                              (u >= 'A' && u <= 'Z');
+            if (word)
+                norm.push_back(u >= 'A' && u <= 'Z' ? static_cast<char>(u + 32) : c);
+            else if (norm.back() != ' ')
+                norm.push_back(' ');
+        }
+        if (norm.back() != ' ') norm.push_back(' ');
+
+        // Word n-grams: hash each word once, then combine order-dependently.
+        std::vector<uint64_t>& words = scratch_words();
+        words.clear();
+        for (size_t i = 1; i < norm.size();) {
+            const size_t end = norm.find(' ', i);
+            words.push_back(detail::ngram_hash_bytes(norm.data() + i, end - i, cfg_.seed));
+            i = end + 1;
+        }
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t h = words[i];
+            add(h, cfg_.word_weight);
+            for (int n = 2; n <= cfg_.word_ngram_max && i + n <= words.size(); ++n) {
+                h = detail::ngram_mix64(h * 0x9E3779B97F4A7C15ull + words[i + n - 1] + n);
+                add(h, cfg_.word_weight);
+            }
+        }
+
+        // Character n-grams over the padded text, starting on character
+        // boundaries only (no n-gram begins inside a UTF-8 sequence).
+        if (cfg_.char_ngram_max > 0) {
+            const uint64_t char_seed = detail::ngram_mix64(cfg_.seed ^ 0xC4A2C4A2C4A2C4A2ull);
+            for (size_t i = 0; i < norm.size(); ++i) {
+                if ((static_cast<unsigned char>(norm[i]) & 0xC0) == 0x80) continue;
+                for (int n = cfg_.char_ngram_min; n <= cfg_.char_ngram_max; ++n) {
+                    if (i + static_cast<size_t>(n) > norm.size()) break;
+                    add(detail::ngram_hash_bytes(norm.data() + i, static_cast<size_t>(n),
+                                                 char_seed + static_cast<uint64_t>(n)),
+                        cfg_.char_weight);
+                }
+            }
+        }
+
+        out.normalize_l2();
+    }
+
+    VCFloatVec embed(std::string_view text) const {
+        VCFloatVec v;
+        embed(text, v);
+        return v;
+    }
+
+private:
+    VCNgramEmbeddingConfig cfg_;
+    std::vector<float> projection_;  // [hash_buckets][output_dim] or empty
+
+    // Per-thread scratch so embed() stays const and allocation-free once warm.
+    static std::string& scratch_text() {
+        thread_local std::string s;
+        return s;
+    }
+    static std::vector<uint64_t>& scratch_words() {
+        thread_local std::vector<uint64_t> w;
+        return w;
+    }
+};
+
+} // namespace vcvisual
@@ -16,11 +16,12 @@
 //   generation models that operate in compact latent spaces [web:5][web:10].
 
 #pragma once
-#include stdint>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <array>
-#include string>
 #include <stdexcept>
 
 namespace vcvisual {
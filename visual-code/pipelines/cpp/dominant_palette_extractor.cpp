@@ -0,0 +1,551 @@
+// File: /visual-code/pipelines/cpp/dominant_palette_extractor.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS (NDK); SSE2 / NEON / scalar
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Dominant-palette extraction from a reference VCDecodedImage, used to
+//   populate VCColorLightingDescriptor::paletteHint for image-to-image,
+//   inpaint and outpaint requests in the semantic router.
+//
+//   Pipeline (budget: < 1 ms per image at any input size):
+//   1) Sparse grid sampling (at most 64x64 taps) into an RGB555 histogram.
+//   2) Each non-empty histogram bin is converted once to OKLab, a
+//      perceptual space where Euclidean distance tracks visible difference.
+//   3) Weighted k-means over the bins (deterministic farthest-point seeding,
+//      vectorized assignment step). Images with fewer distinct colours
+//      than k get fewer clusters.
+//   4) Clusters closer than mergeDistance in OKLab are merged, so one
+//      jittered region does not take two hint slots.
+//   5) Clusters sorted by pixel share and rendered as colour names
+//      ("teal and orange") or hex ("#1f6f78, #e07a2f").
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VC_PAL_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VC_PAL_NEON 1
+#endif
+
+#include "vc_decoded_image.hpp"
+
+enum class VCPaletteFormat {
+  Names,  // "teal, orange and navy"
+  Hex     // "#1f6f78, #e07a2f, #1b2a4a"
+};
+
+struct VCPaletteConfig {
+  int maxSamplesPerAxis;  // sampling grid cap (taps = n * n)
+  int clusters;           // k for k-means
+  int iterations;         // k-means iterations (converges early if stable)
+  int maxHintColors;      // colours emitted into the hint string
+  float minShare;         // drop clusters covering less than this fraction
+  float mergeDistance;    // merge clusters closer than this (OKLab units)
+
+  VCPaletteConfig()
+      : maxSamplesPerAxis(64),
+        clusters(5),
+        iterations(8),
+        maxHintColors(3),
+        minShare(0.05f),
+        mergeDistance(0.05f) {}
+};
+
+struct VCPaletteColor {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+  float share;       // fraction of sampled pixels in this cluster
+  const char* name;  // nearest entry of the named-colour table
+};
+
+struct VCPalette {
+  std::vector<VCPaletteColor> colors;  // sorted by share, descending
+};
+
+namespace vc_palette_detail {
+
+struct Lab {
+  float L, a, b;
+};
+
+struct NamedColor {
+  const char* name;
+  uint8_t r, g, b;
+};
+
+// Compact vocabulary that image backends understand in prompt text.
+static const NamedColor kNamedColors[] = {
+    {"black", 0x10, 0x10, 0x10},      {"charcoal", 0x36, 0x45, 0x4f},
+    {"gray", 0x80, 0x80, 0x80},       {"silver", 0xc0, 0xc0, 0xc0},
+    {"white", 0xf5, 0xf5, 0xf5},      {"beige", 0xe8, 0xdc, 0xc0},
+    {"tan", 0xd2, 0xb4, 0x8c},        {"brown", 0x7b, 0x4a, 0x2a},
+    {"maroon", 0x80, 0x10, 0x20},     {"crimson", 0xc0, 0x14, 0x3c},
+    {"red", 0xe0, 0x20, 0x20},        {"coral", 0xff, 0x7f, 0x50},
+    {"orange", 0xf0, 0x80, 0x20},     {"amber", 0xff, 0xbf, 0x00},
+    {"gold", 0xd4, 0xaf, 0x37},       {"yellow", 0xf5, 0xe0, 0x30},
+    {"olive", 0x80, 0x80, 0x20},      {"lime", 0x9a, 0xe0, 0x30},
+    {"green", 0x30, 0xa0, 0x40},      {"forest green", 0x22, 0x5b, 0x22},
+    {"mint", 0xa0, 0xe6, 0xc0},       {"teal", 0x1a, 0x80, 0x80},
+    {"turquoise", 0x40, 0xd0, 0xc8},  {"cyan", 0x20, 0xd8, 0xe8},
+    {"sky blue", 0x87, 0xc8, 0xeb},   {"blue", 0x25, 0x55, 0xd0},
+    {"navy", 0x14, 0x20, 0x5a},       {"indigo", 0x4b, 0x1f, 0x8c},
+    {"purple", 0x80, 0x30, 0xa0},     {"violet", 0xa0, 0x70, 0xe0},
+    {"lavender", 0xc8, 0xb8, 0xee},   {"magenta", 0xd0, 0x20, 0xb0},
+    {"pink", 0xf4, 0xa0, 0xc0},       {"rose", 0xe0, 0x60, 0x80},
+};
+
+static inline float srgbToLinear(float c) {
+  return c <= 0.04045f ? c / 12.92f
+                       : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static inline float linearToSrgb(float c) {
+  c = std::min(1.0f, std::max(0.0f, c));
+  return c <= 0.0031308f ? c * 12.92f
+                         : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static inline Lab linearRgbToOklab(float r, float g, float b) {
+  const float l = std::cbrt(0.4122214708f * r + 0.5363325363f * g +
+                            0.0514459929f * b);
+  const float m = std::cbrt(0.2119034982f * r + 0.6806995451f * g +
+                            0.1073969566f * b);
+  const float s = std::cbrt(0.0883024619f * r + 0.2817188376f * g +
+                            0.6299787005f * b);
+  return Lab{0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+             1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+             0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s};
+}
+
+static inline void oklabToSrgb8(const Lab& c, uint8_t* rgb) {
+  const float l_ = c.L + 0.3963377774f * c.a + 0.2158037573f * c.b;
+  const float m_ = c.L - 0.1055613458f * c.a - 0.0638541728f * c.b;
+  const float s_ = c.L - 0.0894841775f * c.a - 1.2914855480f * c.b;
+  const float l = l_ * l_ * l_, m = m_ * m_ * m_, s = s_ * s_ * s_;
+  const float lin[3] = {
+      4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s,
+      -1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s,
+      -0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s};
+  for (int i = 0; i < 3; ++i) {
+    rgb[i] = static_cast<uint8_t>(linearToSrgb(lin[i]) * 255.0f + 0.5f);
+  }
+}
+
+static inline Lab srgb8ToOklab(uint8_t r, uint8_t g, uint8_t b) {
+  return linearRgbToOklab(srgbToLinear(r / 255.0f), srgbToLinear(g / 255.0f),
+                          srgbToLinear(b / 255.0f));
+}
+
+// OKLab coordinates of RGB555 bin centres share one linearization table.
+struct Rgb5Linear {
+  float v[32];
+  Rgb5Linear() {
+    for (int i = 0; i < 32; ++i) v[i] = srgbToLinear((i * 8 + 4) / 255.0f);
+  }
+};
+
+struct NamedLabTable {
+  Lab lab[sizeof(kNamedColors) / sizeof(kNamedColors[0])];
+  NamedLabTable() {
+    for (size_t i = 0; i < sizeof(kNamedColors) / sizeof(kNamedColors[0]); ++i) {
+      lab[i] = srgb8ToOklab(kNamedColors[i].r, kNamedColors[i].g,
+                            kNamedColors[i].b);
+    }
+  }
+};
+
+static const char* nearestColorName(const Lab& c) {
+  static const NamedLabTable table;
+  const size_t n = sizeof(kNamedColors) / sizeof(kNamedColors[0]);
+  size_t best = 0;
+  float bestD = 1e30f;
+  for (size_t i = 0; i < n; ++i) {
+    const float dL = c.L - table.lab[i].L;
+    const float da = c.a - table.lab[i].a;
+    const float db = c.b - table.lab[i].b;
+    const float d = dL * dL + da * da + db * db;
+    if (d < bestD) {
+      bestD = d;
+      best = i;
+    }
+  }
+  return kNamedColors[best].name;
+}
+
+// Assign every point (SoA) to its nearest centroid. Four points per step.
+static void assignNearest(const float* L,
+                          const float* A,
+                          const float* B,
+                          size_t n,
+                          const Lab* centroids,
+                          int k,
+                          uint8_t* label) {
+  size_t i = 0;
+#if defined(VC_PAL_SSE2)
+  for (; i + 4 <= n; i += 4) {
+    const __m128 pl = _mm_loadu_ps(L + i);
+    const __m128 pa = _mm_loadu_ps(A + i);
+    const __m128 pb = _mm_loadu_ps(B + i);
+    __m128 best = _mm_set1_ps(1e30f);
+    __m128i bestIdx = _mm_setzero_si128();
+    for (int c = 0; c < k; ++c) {
+      const __m128 dl = _mm_sub_ps(pl, _mm_set1_ps(centroids[c].L));
+      const __m128 da = _mm_sub_ps(pa, _mm_set1_ps(centroids[c].a));
+      const __m128 db = _mm_sub_ps(pb, _mm_set1_ps(centroids[c].b));
+      const __m128 d = _mm_add_ps(_mm_mul_ps(dl, dl),
+                                  _mm_add_ps(_mm_mul_ps(da, da), _mm_mul_ps(db, db)));
+      const __m128 lt = _mm_cmplt_ps(d, best);
+      best = _mm_min_ps(d, best);
+      const __m128i ltI = _mm_castps_si128(lt);
+      bestIdx = _mm_or_si128(_mm_and_si128(ltI, _mm_set1_epi32(c)),
+                             _mm_andnot_si128(ltI, bestIdx));
+    }
+    alignas(16) int32_t idx[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(idx), bestIdx);
+    for (int j = 0; j < 4; ++j) label[i + j] = static_cast<uint8_t>(idx[j]);
+  }
+#elif defined(VC_PAL_NEON)
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t pl = vld1q_f32(L + i);
+    const float32x4_t pa = vld1q_f32(A + i);
+    const float32x4_t pb = vld1q_f32(B + i);
+    float32x4_t best = vdupq_n_f32(1e30f);
+    uint32x4_t bestIdx = vdupq_n_u32(0);
+    for (int c = 0; c < k; ++c) {
+      const float32x4_t dl = vsubq_f32(pl, vdupq_n_f32(centroids[c].L));
+      const float32x4_t da = vsubq_f32(pa, vdupq_n_f32(centroids[c].a));
+      const float32x4_t db = vsubq_f32(pb, vdupq_n_f32(centroids[c].b));
+      float32x4_t d = vmulq_f32(dl, dl);
+      d = vmlaq_f32(d, da, da);
+      d = vmlaq_f32(d, db, db);
+      const uint32x4_t lt = vcltq_f32(d, best);
+      best = vminq_f32(d, best);
+      bestIdx = vbslq_u32(lt, vdupq_n_u32(static_cast<uint32_t>(c)), bestIdx);
+    }
+    uint32_t idx[4];
+    vst1q_u32(idx, bestIdx);
+    for (int j = 0; j < 4; ++j) label[i + j] = static_cast<uint8_t>(idx[j]);
+  }
+#endif
+  for (; i < n; ++i) {
+    float best = 1e30f;
+    int bestIdx = 0;
+    for (int c = 0; c < k; ++c) {
+      const float dl = L[i] - centroids[c].L;
+      const float da = A[i] - centroids[c].a;
+      const float db = B[i] - centroids[c].b;
+      const float d = dl * dl + da * da + db * db;
+      if (d < best) {
+        best = d;
+        bestIdx = c;
+      }
+    }
+    label[i] = static_cast<uint8_t>(bestIdx);
+  }
+}
+
+}  // namespace vc_palette_detail
+
+class VCDominantPaletteExtractor {
+ public:
+  explicit VCDominantPaletteExtractor(
+      const VCPaletteConfig& cfg = VCPaletteConfig())
+      : config_(cfg) {
+    if (config_.clusters < 1 || config_.clusters > 16) {
+      throw std::invalid_argument("Palette: clusters must be in [1, 16]");
+    }
+    if (config_.maxSamplesPerAxis < 1 || config_.maxSamplesPerAxis > 512) {
+      throw std::invalid_argument("Palette: maxSamplesPerAxis out of range");
+    }
+  }
+
+  // Not thread-safe: reuses internal scratch buffers between calls.
+  // Use one extractor per worker thread.
+  VCPalette extract(const VCDecodedImage& img) {
+    using namespace vc_palette_detail;
+    if (img.width <= 0 || img.height <= 0 ||
+        img.data.size() < static_cast<size_t>(img.width) * img.height * 3) {
+      throw std::invalid_argument("Palette: invalid image");
+    }
+
+    buildHistogram(img);
+
+    // Bins → SoA OKLab points with weights.
+    static const Rgb5Linear lin;
+    const size_t n = binIds_.size();
+    L_.resize(n);
+    A_.resize(n);
+    B_.resize(n);
+    W_.resize(n);
+    label_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      const uint16_t id = binIds_[i];
+      const Lab c = linearRgbToOklab(lin.v[(id >> 10) & 31], lin.v[(id >> 5) & 31],
+                                     lin.v[id & 31]);
+      L_[i] = c.L;
+      A_[i] = c.a;
+      B_[i] = c.b;
+      W_[i] = static_cast<float>(hist_[id]);
+    }
+
+    std::vector<Lab> centroids =
+        seedCentroids(std::min<int>(config_.clusters, static_cast<int>(n)));
+    const int k = static_cast<int>(centroids.size());  // may be below clusters
+    std::vector<double> sumL(k), sumA(k), sumB(k), sumW(k);
+
+    for (int it = 0; it < config_.iterations; ++it) {
+      assignNearest(L_.data(), A_.data(), B_.data(), n, centroids.data(), k,
+                    label_.data());
+      std::fill(sumL.begin(), sumL.end(), 0.0);
+      std::fill(sumA.begin(), sumA.end(), 0.0);
+      std::fill(sumB.begin(), sumB.end(), 0.0);
+      std::fill(sumW.begin(), sumW.end(), 0.0);
+      for (size_t i = 0; i < n; ++i) {
+        const int c = label_[i];
+        sumL[c] += W_[i] * L_[i];
+        sumA[c] += W_[i] * A_[i];
+        sumB[c] += W_[i] * B_[i];
+        sumW[c] += W_[i];
+      }
+      float moved = 0.0f;
+      for (int c = 0; c < k; ++c) {
+        if (sumW[c] <= 0.0) continue;
+        const Lab next{static_cast<float>(sumL[c] / sumW[c]),
+                       static_cast<float>(sumA[c] / sumW[c]),
+                       static_cast<float>(sumB[c] / sumW[c])};
+        moved = std::max(moved, std::fabs(next.L - centroids[c].L) +
+                                    std::fabs(next.a - centroids[c].a) +
+                                    std::fabs(next.b - centroids[c].b));
+        centroids[c] = next;
+      }
+      if (moved < 1e-4f) break;
+    }
+
+    // Greedy merge of near-identical clusters (weighted mean).
+    const float mergeSq = config_.mergeDistance * config_.mergeDistance;
+    for (int c = 0; c < k; ++c) {
+      if (sumW[c] <= 0.0) continue;
+      for (int d = c + 1; d < k; ++d) {
+        if (sumW[d] <= 0.0) continue;
+        const float dl = centroids[c].L - centroids[d].L;
+        const float da = centroids[c].a - centroids[d].a;
+        const float db = centroids[c].b - centroids[d].b;
+        if (dl * dl + da * da + db * db >= mergeSq) continue;
+        const double w = sumW[c] + sumW[d];
+        const Lab merged{
+            static_cast<float>((sumW[c] * centroids[c].L + sumW[d] * centroids[d].L) / w),
+            static_cast<float>((sumW[c] * centroids[c].a + sumW[d] * centroids[d].a) / w),
+            static_cast<float>((sumW[c] * centroids[c].b + sumW[d] * centroids[d].b) / w)};
+        centroids[c] = merged;
+        sumW[c] = w;
+        sumW[d] = 0.0;
+      }
+    }
+
+    double total = 0.0;
+    for (int c = 0; c < k; ++c) total += sumW[c];
+
+    VCPalette palette;
+    for (int c = 0; c < k; ++c) {
+      const float share = total > 0.0 ? static_cast<float>(sumW[c] / total) : 0.0f;
+      if (share < config_.minShare) continue;
+      VCPaletteColor pc;
+      uint8_t rgb[3];
+      oklabToSrgb8(centroids[c], rgb);
+      pc.r = rgb[0];
+      pc.g = rgb[1];
+      pc.b = rgb[2];
+      pc.share = share;
+      pc.name = nearestColorName(centroids[c]);
+      palette.colors.push_back(pc);
+    }
+    std::sort(palette.colors.begin(), palette.colors.end(),
+              [](const VCPaletteColor& x, const VCPaletteColor& y) {
+                return x.share > y.share;
+              });
+    return palette;
+  }
+
+  // Compact hint for VCColorLightingDescriptor::paletteHint.
+  std::string toHint(const VCPalette& palette, VCPaletteFormat format) const {
+    std::vector<std::string> parts;
+    for (const VCPaletteColor& c : palette.colors) {
+      if (static_cast<int>(parts.size()) >= config_.maxHintColors) break;
+      if (format == VCPaletteFormat::Hex) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "#%02x%02x%02x", c.r, c.g, c.b);
+        parts.emplace_back(buf);
+      } else if (std::find(parts.begin(), parts.end(), c.name) == parts.end()) {
+        parts.emplace_back(c.name);
+      }
+    }
+
+    std::string out;
+    for (size_t i = 0; i < parts.size(); ++i) {
+      if (i > 0) {
+        if (format == VCPaletteFormat::Names && i + 1 == parts.size())
+          out += " and ";
+        else
+          out += ", ";
+      }
+      out += parts[i];
+    }
+    return out;
+  }
+
+  std::string extractHint(const VCDecodedImage& img,
+                          VCPaletteFormat format = VCPaletteFormat::Names) {
+    return toHint(extract(img), format);
+  }
+
+ private:
+  VCPaletteConfig config_;
+  std::vector<uint32_t> hist_;    // 32768 RGB555 bins
+  std::vector<uint16_t> binIds_;  // non-empty bins in first-seen order
+  std::vector<float> L_, A_, B_, W_;
+  std::vector<uint8_t> label_;
+
+  void buildHistogram(const VCDecodedImage& img) {
+    hist_.assign(1u << 15, 0);
+    binIds_.clear();
+    const int nx = std::min(config_.maxSamplesPerAxis, img.width);
+    const int ny = std::min(config_.maxSamplesPerAxis, img.height);
+    const size_t rowBytes = static_cast<size_t>(img.width) * 3;
+    const uint8_t* base = img.data.data();
+    for (int sy = 0; sy < ny; ++sy) {
+      const int y = static_cast<int>((static_cast<int64_t>(2 * sy + 1) * img.height) /
+                                     (2 * ny));
+      const uint8_t* row = base + y * rowBytes;
+      for (int sx = 0; sx < nx; ++sx) {
+        const int x = static_cast<int>((static_cast<int64_t>(2 * sx + 1) * img.width) /
+                                       (2 * nx));
+        const uint8_t* p = row + x * 3;
+        const uint16_t id = static_cast<uint16_t>(((p[0] >> 3) << 10) |
+                                                  ((p[1] >> 3) << 5) | (p[2] >> 3));
+        if (hist_[id]++ == 0) binIds_.push_back(id);
+      }
+    }
+  }
+
+  // Deterministic farthest-point seeding: heaviest bin first, then the bin
+  // maximizing weight * squared distance to its nearest existing seed.
+  std::vector<vc_palette_detail::Lab> seedCentroids(int k) const {
+    using vc_palette_detail::Lab;
+    const size_t n = L_.size();
+    std::vector<Lab> seeds;
+    seeds.reserve(k);
+    size_t first = 0;
+    for (size_t i = 1; i < n; ++i) {
+      if (W_[i] > W_[first]) first = i;
+    }
+    seeds.push_back(Lab{L_[first], A_[first], B_[first]});
+
+    std::vector<float> nearest(n, 1e30f);
+    while (static_cast<int>(seeds.size()) < k) {
+      const Lab& last = seeds.back();
+      size_t pick = 0;
+      float bestScore = -1.0f;
+      for (size_t i = 0; i < n; ++i) {
+        const float dl = L_[i] - last.L;
+        const float da = A_[i] - last.a;
+        const float db = B_[i] - last.b;
+        nearest[i] = std::min(nearest[i], dl * dl + da * da + db * db);
+        const float score = W_[i] * nearest[i];
+        if (score > bestScore) {
+          bestScore = score;
+          pick = i;
+        }
+      }
+      if (bestScore <= 0.0f) break;  // fewer distinct colours than k
+      seeds.push_back(Lab{L_[pick], A_[pick], B_[pick]});
+    }
+    return seeds;
+  }
+};
+
+#ifdef VC_DOMINANT_PALETTE_DEMO
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+int main() {
+  // 1024x768 split into teal sky, orange ground and a navy band.
+  VCDecodedImage img;
+  img.width = 1024;
+  img.height = 768;
+  img.data.resize(static_cast<size_t>(img.width) * img.height * 3);
+  for (int y = 0; y < img.height; ++y) {
+    for (int x = 0; x < img.width; ++x) {
+      uint8_t* p = &img.data[(static_cast<size_t>(y) * img.width + x) * 3];
+      const int jitter = (x * 7 + y * 13) % 9 - 4;
+      if (y < 400) {
+        p[0] = 0x1a; p[1] = static_cast<uint8_t>(0x80 + jitter); p[2] = 0x80;
+      } else if (y < 520) {
+        p[0] = 0x14; p[1] = 0x20; p[2] = static_cast<uint8_t>(0x5a + jitter);
+      } else {
+        p[0] = 0xf0; p[1] = static_cast<uint8_t>(0x80 + jitter); p[2] = 0x20;
+      }
+    }
+  }
+
+  VCDominantPaletteExtractor extractor;
+  const int kRuns = 2000;
+  std::string hint;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRuns; ++i) {
+    hint = extractor.extractHint(img, VCPaletteFormat::Names);
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const double us =
+      std::chrono::duration<double, std::micro>(t1 - t0).count() / kRuns;
+
+  std::cout << "palette (names): " << hint << "\n"
+            << "palette (hex):   "
+            << extractor.extractHint(img, VCPaletteFormat::Hex) << "\n"
+            << "latency: " << us << " us/image\n";
+
+  // Expected: teal (52%), orange (32%), navy (16%), one entry each.
+  int failures = 0;
+  auto near = [](const VCPaletteColor& c, int r, int g, int b) {
+    return std::abs(c.r - r) <= 12 && std::abs(c.g - g) <= 12 &&
+           std::abs(c.b - b) <= 12;
+  };
+  const VCPalette palette = extractor.extract(img);
+  if (palette.colors.size() != 3 || !near(palette.colors[0], 0x1a, 0x80, 0x80) ||
+      !near(palette.colors[1], 0xf0, 0x80, 0x20) ||
+      !near(palette.colors[2], 0x14, 0x20, 0x5a)) {
+    std::cerr << "FAIL: expected teal, orange, navy\n";
+    ++failures;
+  }
+
+  // Two distinct colours with clusters = 5: seeding stops at two.
+  VCDecodedImage two;
+  two.width = 64;
+  two.height = 64;
+  two.data.resize(static_cast<size_t>(two.width) * two.height * 3);
+  for (size_t i = 0; i < two.data.size(); i += 3) {
+    const bool left = (i / 3) % two.width < 40;
+    two.data[i] = left ? 0xff : 0x00;
+    two.data[i + 1] = 0x00;
+    two.data[i + 2] = left ? 0x00 : 0xff;
+  }
+  const VCPalette duo = extractor.extract(two);
+  if (duo.colors.size() != 2 || !near(duo.colors[0], 0xff, 0x00, 0x00) ||
+      !near(duo.colors[1], 0x00, 0x00, 0xff)) {
+    std::cerr << "FAIL: expected red, blue\n";
+    ++failures;
+  }
+  std::cout << "two-colour image: " << extractor.toHint(duo, VCPaletteFormat::Hex)
+            << "\n";
+  return failures == 0 ? 0 : 1;
+}
+#endif
@@ -0,0 +1,697 @@
+// File: /visual-code/pipelines/cpp/image_quality_metrics.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS (NDK); SSE2 / NEON / scalar
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   CPU image-quality metrics for regression checks on pipeline variants
+//   (faster resize paths, quantized decoders, new checkpoints):
+//   - PSNR over RGB (alpha ignored for RGBA decoder outputs).
+//   - SSIM on BT.601 luma, 11x11 Gaussian window (sigma 1.5), valid region.
+//   - MS-SSIM, 5 scales with the standard Wang et al. weights.
+//
+//   Rows are split across worker threads; the inner loops are SIMD
+//   (byte-difference accumulation for PSNR, column-wise axpy for the
+//   separable Gaussian). SSIM keeps an 11-row ring of horizontally filtered
+//   rows per thread instead of full-size intermediate maps.
+//
+//   VCQualityRegressionHarness compares a candidate variant against a
+//   golden corpus and reports a failure when any case drops below the
+//   configured thresholds.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VC_IQ_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VC_IQ_NEON 1
+#endif
+
+#include "vc_decoded_image.hpp"
+#include "../../runtime/vlig_semantic_guided_router.cpp"  // VCJsonWriter
+
+// Non-owning view over 8-bit interleaved pixels (RGB or RGBA).
+struct VCImageView {
+  const uint8_t* data;
+  int width;
+  int height;
+  int channels;     // 3 (VCDecodedImage) or 4 (IImageDecoder RGBA output)
+  int strideBytes;  // bytes per row
+};
+
+static VCImageView VCViewOf(const VCDecodedImage& img) {
+  if (img.width <= 0 || img.height <= 0 ||
+      img.data.size() < static_cast<size_t>(img.width) * img.height * 3) {
+    throw std::invalid_argument("VCViewOf: invalid VCDecodedImage");
+  }
+  return VCImageView{img.data.data(), img.width, img.height, 3, img.width * 3};
+}
+
+static VCImageView VCViewOfRGBA(const std::vector<uint8_t>& rgba,
+                                int width,
+                                int height) {
+  if (width <= 0 || height <= 0 ||
+      rgba.size() < static_cast<size_t>(width) * height * 4) {
+    throw std::invalid_argument("VCViewOfRGBA: invalid RGBA buffer");
+  }
+  return VCImageView{rgba.data(), width, height, 4, width * 4};
+}
+
+struct VCQualityScores {
+  double psnr;    // dB; identical images report kPsnrIdentical
+  double ssim;    // [-1, 1]
+  double msssim;  // [0, 1]
+};
+
+namespace vc_iq_detail {
+
+static const int kWin = 11;
+static const double kC1 = (0.01 * 255.0) * (0.01 * 255.0);
+static const double kC2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+template <typename F>
+static void parallelRows(int rows, int threads, F fn) {
+  const int minRowsPerThread = 32;
+  int n = std::max(1, std::min(threads, rows / minRowsPerThread));
+  if (n == 1) {
+    fn(0, rows, 0);
+    return;
+  }
+  std::vector<std::thread> pool;
+  pool.reserve(n - 1);
+  const int chunk = (rows + n - 1) / n;
+  for (int t = 1; t < n; ++t) {
+    const int begin = t * chunk;
+    const int end = std::min(rows, begin + chunk);
+    if (begin >= end) break;
+    pool.emplace_back([&fn, begin, end, t] { fn(begin, end, t); });
+  }
+  fn(0, std::min(rows, chunk), 0);
+  for (auto& th : pool) th.join();
+}
+
+// Sum of squared byte differences; alpha bytes are masked out for RGBA.
+static uint64_t rowSquaredError(const uint8_t* a,
+                                const uint8_t* b,
+                                int bytes,
+                                int channels) {
+  uint64_t total = 0;
+  int i = 0;
+#if defined(VC_IQ_SSE2)
+  const __m128i mask = channels == 4 ? _mm_set1_epi32(0x00FFFFFF)
+                                     : _mm_set1_epi32(-1);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+  int pending = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+    d = _mm_and_si128(d, mask);
+    const __m128i lo = _mm_unpacklo_epi8(d, zero);
+    const __m128i hi = _mm_unpackhi_epi8(d, zero);
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, lo));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, hi));
+    // Each lane gains at most 4 * 255^2 per step; flush well before overflow.
+    if (++pending == 2048) {
+      alignas(16) uint32_t lanes[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+      total += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+      acc = _mm_setzero_si128();
+      pending = 0;
+    }
+  }
+  alignas(16) uint32_t lanes[4];
+  _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+  total += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#elif defined(VC_IQ_NEON)
+  static const uint8_t kAlphaMask[16] = {255, 255, 255, 0, 255, 255, 255, 0,
+                                         255, 255, 255, 0, 255, 255, 255, 0};
+  const uint8x16_t mask = channels == 4 ? vld1q_u8(kAlphaMask) : vdupq_n_u8(255);
+  uint32x4_t acc = vdupq_n_u32(0);
+  int pending = 0;
+  for (; i + 16 <= bytes; i += 16) {
+    const uint8x16_t d = vandq_u8(vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i)), mask);
+    acc = vpadalq_u16(acc, vmull_u8(vget_low_u8(d), vget_low_u8(d)));
+    acc = vpadalq_u16(acc, vmull_u8(vget_high_u8(d), vget_high_u8(d)));
+    if (++pending == 2048) {
+      total += vgetq_lane_u32(acc, 0) + static_cast<uint64_t>(vgetq_lane_u32(acc, 1)) +
+               vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+      acc = vdupq_n_u32(0);
+      pending = 0;
+    }
+  }
+  total += vgetq_lane_u32(acc, 0) + static_cast<uint64_t>(vgetq_lane_u32(acc, 1)) +
+           vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+  for (; i < bytes; ++i) {
+    if (channels == 4 && (i & 3) == 3) continue;
+    const int d = static_cast<int>(a[i]) - static_cast<int>(b[i]);
+    total += static_cast<uint64_t>(d * d);
+  }
+  return total;
+}
+
+// y[i] += w * x[i] over n floats.
+static inline void axpy(float w, const float* x, float* y, int n) {
+  int i = 0;
+#if defined(VC_IQ_SSE2)
+  const __m128 vw = _mm_set1_ps(w);
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i),
+                                    _mm_mul_ps(vw, _mm_loadu_ps(x + i))));
+  }
+#elif defined(VC_IQ_NEON)
+  const float32x4_t vw = vdupq_n_f32(w);
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(y + i, vmlaq_f32(vld1q_f32(y + i), vw, vld1q_f32(x + i)));
+  }
+#endif
+  for (; i < n; ++i) y[i] += w * x[i];
+}
+
+struct Gaussian11 {
+  float w[kWin];
+  Gaussian11() {
+    double sum = 0.0;
+    double tmp[kWin];
+    for (int i = 0; i < kWin; ++i) {
+      const double x = i - kWin / 2;
+      tmp[i] = std::exp(-(x * x) / (2.0 * 1.5 * 1.5));
+      sum += tmp[i];
+    }
+    for (int i = 0; i < kWin; ++i) w[i] = static_cast<float>(tmp[i] / sum);
+  }
+};
+
+static const Gaussian11& gaussian() {
+  static const Gaussian11 g;
+  return g;
+}
+
+struct LumaPlane {
+  int width = 0;
+  int height = 0;
+  std::vector<float> px;
+};
+
+static LumaPlane toLuma(const VCImageView& v, int threads) {
+  LumaPlane p;
+  p.width = v.width;
+  p.height = v.height;
+  p.px.resize(static_cast<size_t>(v.width) * v.height);
+  parallelRows(v.height, threads, [&](int y0, int y1, int) {
+    for (int y = y0; y < y1; ++y) {
+      const uint8_t* row = v.data + static_cast<size_t>(y) * v.strideBytes;
+      float* out = &p.px[static_cast<size_t>(y) * v.width];
+      for (int x = 0; x < v.width; ++x) {
+        const uint8_t* q = row + x * v.channels;
+        out[x] = 0.299f * q[0] + 0.587f * q[1] + 0.114f * q[2];
+      }
+    }
+  });
+  return p;
+}
+
+static LumaPlane downsample2x(const LumaPlane& in) {
+  LumaPlane out;
+  out.width = in.width / 2;
+  out.height = in.height / 2;
+  out.px.resize(static_cast<size_t>(out.width) * out.height);
+  for (int y = 0; y < out.height; ++y) {
+    const float* r0 = &in.px[static_cast<size_t>(2 * y) * in.width];
+    const float* r1 = r0 + in.width;
+    float* o = &out.px[static_cast<size_t>(y) * out.width];
+    for (int x = 0; x < out.width; ++x) {
+      o[x] = 0.25f * (r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1]);
+    }
+  }
+  return out;
+}
+
+struct SsimMeans {
+  double ssim;  // mean of l * cs
+  double cs;    // mean of contrast-structure term
+};
+
+// Gaussian-windowed SSIM over the valid region of two luma planes.
+static SsimMeans ssimPlanes(const LumaPlane& a, const LumaPlane& b, int threads) {
+  const int W = a.width;
+  const int outW = W - kWin + 1;
+  const int outH = a.height - kWin + 1;
+  if (outW <= 0 || outH <= 0) {
+    throw std::invalid_argument("SSIM: image smaller than 11x11 window");
+  }
+  const Gaussian11& g = gaussian();
+
+  const int maxThreads = std::max(1, threads);
+  std::vector<double> ssimSum(maxThreads, 0.0), csSum(maxThreads, 0.0);
+
+  parallelRows(outH, threads, [&](int r0, int r1, int tid) {
+    // ring[k][m]: horizontally filtered row (input row % kWin) of map m,
+    // maps: mu_a, mu_b, a^2, b^2, a*b.
+    std::vector<float> ring(static_cast<size_t>(kWin) * 5 * outW);
+    std::vector<float> acc(static_cast<size_t>(5) * outW);
+    auto slot = [&](int row, int map) {
+      return &ring[(static_cast<size_t>(row % kWin) * 5 + map) * outW];
+    };
+    auto filterRow = [&](int y) {
+      const float* pa = &a.px[static_cast<size_t>(y) * W];
+      const float* pb = &b.px[static_cast<size_t>(y) * W];
+      float* m0 = slot(y, 0);
+      float* m1 = slot(y, 1);
+      float* m2 = slot(y, 2);
+      float* m3 = slot(y, 3);
+      float* m4 = slot(y, 4);
+      for (int x = 0; x < outW; ++x) {
+        float s0 = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+        for (int k = 0; k < kWin; ++k) {
+          const float va = pa[x + k], vb = pb[x + k], w = g.w[k];
+          s0 += w * va;
+          s1 += w * vb;
+          s2 += w * va * va;
+          s3 += w * vb * vb;
+          s4 += w * va * vb;
+        }
+        m0[x] = s0; m1[x] = s1; m2[x] = s2; m3[x] = s3; m4[x] = s4;
+      }
+    };
+
+    for (int y = r0; y < r0 + kWin - 1; ++y) filterRow(y);
+    double sAcc = 0.0, cAcc = 0.0;
+    for (int r = r0; r < r1; ++r) {
+      filterRow(r + kWin - 1);
+      std::fill(acc.begin(), acc.end(), 0.0f);
+      for (int k = 0; k < kWin; ++k) {
+        for (int m = 0; m < 5; ++m) {
+          axpy(g.w[k], slot(r + k, m), &acc[static_cast<size_t>(m) * outW], outW);
+        }
+      }
+      const float* muA = &acc[0];
+      const float* muB = &acc[static_cast<size_t>(outW)];
+      const float* eAA = &acc[static_cast<size_t>(2) * outW];
+      const float* eBB = &acc[static_cast<size_t>(3) * outW];
+      const float* eAB = &acc[static_cast<size_t>(4) * outW];
+      for (int x = 0; x < outW; ++x) {
+        const double ma = muA[x], mb = muB[x];
+        const double va = eAA[x] - ma * ma;
+        const double vb = eBB[x] - mb * mb;
+        const double cov = eAB[x] - ma * mb;
+        const double l = (2.0 * ma * mb + kC1) / (ma * ma + mb * mb + kC1);
+        const double cs = (2.0 * cov + kC2) / (va + vb + kC2);
+        sAcc += l * cs;
+        cAcc += cs;
+      }
+    }
+    ssimSum[tid] = sAcc;
+    csSum[tid] = cAcc;
+  });
+
+  double s = 0.0, c = 0.0;
+  for (int t = 0; t < maxThreads; ++t) {
+    s += ssimSum[t];
+    c += csSum[t];
+  }
+  const double n = static_cast<double>(outW) * outH;
+  return SsimMeans{s / n, c / n};
+}
+
+}  // namespace vc_iq_detail
+
+class VCImageQualityMetrics {
+ public:
+  static constexpr double kPsnrIdentical = 100.0;
+
+  // threads <= 0 selects std::thread::hardware_concurrency().
+  explicit VCImageQualityMetrics(int threads = 0)
+      : threads_(threads > 0 ? threads
+                             : std::max(1u, std::thread::hardware_concurrency())) {}
+
+  double psnr(const VCImageView& a, const VCImageView& b) const {
+    checkPair(a, b);
+    std::vector<uint64_t> partial(threads_, 0);
+    vc_iq_detail::parallelRows(a.height, threads_, [&](int y0, int y1, int tid) {
+      uint64_t sum = 0;
+      for (int y = y0; y < y1; ++y) {
+        sum += vc_iq_detail::rowSquaredError(
+            a.data + static_cast<size_t>(y) * a.strideBytes,
+            b.data + static_cast<size_t>(y) * b.strideBytes,
+            a.width * a.channels, a.channels);
+      }
+      partial[tid] = sum;
+    });
+    uint64_t sse = 0;
+    for (uint64_t p : partial) sse += p;
+    if (sse == 0) return kPsnrIdentical;
+    const double samples = static_cast<double>(a.width) * a.height * 3.0;
+    const double mse = static_cast<double>(sse) / samples;
+    return std::min(kPsnrIdentical, 10.0 * std::log10((255.0 * 255.0) / mse));
+  }
+
+  double ssim(const VCImageView& a, const VCImageView& b) const {
+    checkPair(a, b);
+    return vc_iq_detail::ssimPlanes(vc_iq_detail::toLuma(a, threads_),
+                                    vc_iq_detail::toLuma(b, threads_), threads_)
+        .ssim;
+  }
+
+  double msssim(const VCImageView& a, const VCImageView& b) const {
+    checkPair(a, b);
+    return msssimPlanes(vc_iq_detail::toLuma(a, threads_),
+                        vc_iq_detail::toLuma(b, threads_));
+  }
+
+  VCQualityScores all(const VCImageView& a, const VCImageView& b) const {
+    checkPair(a, b);
+    vc_iq_detail::LumaPlane la = vc_iq_detail::toLuma(a, threads_);
+    vc_iq_detail::LumaPlane lb = vc_iq_detail::toLuma(b, threads_);
+    VCQualityScores s;
+    s.psnr = psnr(a, b);
+    s.ssim = vc_iq_detail::ssimPlanes(la, lb, threads_).ssim;
+    s.msssim = msssimPlanes(la, lb);
+    return s;
+  }
+
+ private:
+  int threads_;
+
+  static void checkPair(const VCImageView& a, const VCImageView& b) {
+    if (!a.data || !b.data) {
+      throw std::invalid_argument("Quality metrics: null image");
+    }
+    if (a.width != b.width || a.height != b.height) {
+      throw std::invalid_argument("Quality metrics: dimension mismatch");
+    }
+    if (a.channels != b.channels || (a.channels != 3 && a.channels != 4)) {
+      throw std::invalid_argument("Quality metrics: channel layout mismatch");
+    }
+  }
+
+  double msssimPlanes(vc_iq_detail::LumaPlane a, vc_iq_detail::LumaPlane b) const {
+    static const double kWeights[5] = {0.0448, 0.2856, 0.3001, 0.2363, 0.1333};
+    // Use as many scales as keep the coarsest level >= the SSIM window,
+    // renormalizing the weights when small inputs drop scales.
+    int scales = 1;
+    for (int w = std::min(a.width, a.height); scales < 5 && w / 2 >= vc_iq_detail::kWin;
+         w /= 2) {
+      ++scales;
+    }
+    double wsum = 0.0;
+    for (int s = 0; s < scales; ++s) wsum += kWeights[s];
+
+    double result = 1.0;
+    for (int s = 0; s < scales; ++s) {
+      const vc_iq_detail::SsimMeans m = vc_iq_detail::ssimPlanes(a, b, threads_);
+      const double w = kWeights[s] / wsum;
+      if (s + 1 < scales) {
+        result *= std::pow(std::max(0.0, m.cs), w);
+        a = vc_iq_detail::downsample2x(a);
+        b = vc_iq_detail::downsample2x(b);
+      } else {
+        result *= std::pow(std::max(0.0, m.ssim), w);
+      }
+    }
+    return result;
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Golden-corpus regression harness.
+// -----------------------------------------------------------------------------
+
+struct VCQualityThresholds {
+  double minPSNR;
+  double minSSIM;
+  double minMSSSIM;
+
+  VCQualityThresholds() : minPSNR(35.0), minSSIM(0.95), minMSSSIM(0.97) {}
+};
+
+struct VCQualityCaseResult {
+  std::string id;
+  VCQualityScores scores;
+  bool passed;
+  std::string failure;  // empty when passed
+};
+
+struct VCQualityReport {
+  std::vector<VCQualityCaseResult> cases;
+  size_t failures = 0;
+
+  bool passed() const { return failures == 0; }
+
+  // Ids and failure text (which carries exception messages) go through the
+  // router's JSON string escaper.
+  std::string toJSON() const {
+    auto quoted = [](const std::string& s) {
+      std::string out;
+      vc_vlig::VCJsonWriter w(out, s.size() + 2);
+      w.string(s);
+      w.finish();
+      return out;
+    };
+    std::ostringstream os;
+    os << "{\"passed\":" << (passed() ? "true" : "false")
+       << ",\"failures\":" << failures << ",\"cases\":[";
+    for (size_t i = 0; i < cases.size(); ++i) {
+      const VCQualityCaseResult& c = cases[i];
+      if (i) os << ",";
+      os << "{\"id\":" << quoted(c.id) << ",\"psnr\":" << c.scores.psnr
+         << ",\"ssim\":" << c.scores.ssim << ",\"ms_ssim\":" << c.scores.msssim
+         << ",\"passed\":" << (c.passed ? "true" : "false")
+         << ",\"failure\":" << quoted(c.failure) << "}";
+    }
+    os << "]}";
+    return os.str();
+  }
+};
+
+// A pipeline variant: encoded bytes in, decoded RGB out
+// (e.g. a VCDecodeResizePipeline configured with a new resize path).
+using VCImageVariant =
+    std::function<VCDecodedImage(const std::vector<uint8_t>& encoded)>;
+
+// Binary PPM (P6) is used for golden outputs: lossless, trivial to parse and
+// viewable with standard tools, without requiring OpenCV in the harness.
+static void VCWritePPM(const std::string& path, const VCDecodedImage& img) {
+  std::ofstream f(path, std::ios::binary);
+  if (!f) throw std::runtime_error("Cannot write golden image: " + path);
+  f << "P6\n" << img.width << " " << img.height << "\n255\n";
+  f.write(reinterpret_cast<const char*>(img.data.data()),
+          static_cast<std::streamsize>(img.data.size()));
+}
+
+static VCDecodedImage VCReadPPM(const std::string& path) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) throw std::runtime_error("Cannot read golden image: " + path);
+  std::string magic;
+  int maxVal = 0;
+  VCDecodedImage img;
+  f >> magic >> img.width >> img.height >> maxVal;
+  f.get();
+  if (magic != "P6" || maxVal != 255 || img.width <= 0 || img.height <= 0) {
+    throw std::runtime_error("Unsupported golden image format: " + path);
+  }
+  img.data.resize(static_cast<size_t>(img.width) * img.height * 3);
+  f.read(reinterpret_cast<char*>(img.data.data()),
+         static_cast<std::streamsize>(img.data.size()));
+  if (!f) throw std::runtime_error("Truncated golden image: " + path);
+  return img;
+}
+
+class VCQualityRegressionHarness {
+ public:
+  explicit VCQualityRegressionHarness(
+      const VCQualityThresholds& thresholds = VCQualityThresholds(),
+      int threads = 0)
+      : thresholds_(thresholds), metrics_(threads) {}
+
+  void addCase(const std::string& id,
+               std::vector<uint8_t> encoded,
+               VCDecodedImage golden) {
+    cases_.push_back(Case{id, std::move(encoded), std::move(golden)});
+  }
+
+  // Record goldens by running the current reference pipeline once.
+  void addCaseFromReference(const std::string& id,
+                            std::vector<uint8_t> encoded,
+                            const VCImageVariant& reference) {
+    VCDecodedImage golden = reference(encoded);
+    addCase(id, std::move(encoded), std::move(golden));
+  }
+
+  // Persist goldens as <dir>/<id>.golden.ppm; encoded inputs stay in the
+  // caller's corpus and are passed back in through loadGolden().
+  void saveGoldens(const std::string& dir) const {
+    for (const Case& c : cases_) VCWritePPM(dir + "/" + c.id + ".golden.ppm", c.golden);
+  }
+
+  void loadGolden(const std::string& id,
+                  std::vector<uint8_t> encoded,
+                  const std::string& dir) {
+    addCase(id, std::move(encoded), VCReadPPM(dir + "/" + id + ".golden.ppm"));
+  }
+
+  VCQualityReport run(const VCImageVariant& candidate) const {
+    VCQualityReport report;
+    for (const Case& c : cases_) {
+      VCQualityCaseResult r;
+      r.id = c.id;
+      r.scores = VCQualityScores{0.0, 0.0, 0.0};
+      r.passed = false;
+      try {
+        const VCDecodedImage out = candidate(c.encoded);
+        if (out.width != c.golden.width || out.height != c.golden.height) {
+          r.failure = "dimension mismatch";
+        } else {
+          r.scores = metrics_.all(VCViewOf(c.golden), VCViewOf(out));
+          r.failure = thresholdFailure(r.scores);
+          r.passed = r.failure.empty();
+        }
+      } catch (const std::exception& e) {
+        r.failure = std::string("variant threw: ") + e.what();
+      }
+      if (!r.passed) ++report.failures;
+      report.cases.push_back(std::move(r));
+    }
+    return report;
+  }
+
+ private:
+  struct Case {
+    std::string id;
+    std::vector<uint8_t> encoded;
+    VCDecodedImage golden;
+  };
+
+  VCQualityThresholds thresholds_;
+  VCImageQualityMetrics metrics_;
+  std::vector<Case> cases_;
+
+  std::string thresholdFailure(const VCQualityScores& s) const {
+    char buf[96];
+    if (s.psnr < thresholds_.minPSNR) {
+      std::snprintf(buf, sizeof(buf), "psnr %.2f < %.2f", s.psnr, thresholds_.minPSNR);
+      return buf;
+    }
+    if (s.ssim < thresholds_.minSSIM) {
+      std::snprintf(buf, sizeof(buf), "ssim %.4f < %.4f", s.ssim, thresholds_.minSSIM);
+      return buf;
+    }
+    if (s.msssim < thresholds_.minMSSSIM) {
+      std::snprintf(buf, sizeof(buf), "ms-ssim %.4f < %.4f", s.msssim,
+                    thresholds_.minMSSSIM);
+      return buf;
+    }
+    return std::string();
+  }
+};
+
+#ifdef VC_IMAGE_QUALITY_HARNESS_DEMO
+#include <iostream>
+
+// Demo corpus: raw 512x512 RGB "encoded" inputs; the reference variant is a
+// 2x box downscale, the candidates are the same box path and a cheaper
+// nearest-neighbour path that should trip the thresholds.
+static VCDecodedImage vcDemoDecode(const std::vector<uint8_t>& raw, bool nearest) {
+  const int S = 512, D = 256;
+  VCDecodedImage out;
+  out.width = D;
+  out.height = D;
+  out.data.resize(static_cast<size_t>(D) * D * 3);
+  for (int y = 0; y < D; ++y) {
+    for (int x = 0; x < D; ++x) {
+      for (int c = 0; c < 3; ++c) {
+        const size_t i00 = (static_cast<size_t>(2 * y) * S + 2 * x) * 3 + c;
+        int v;
+        if (nearest) {
+          v = raw[i00];
+        } else {
+          v = (raw[i00] + raw[i00 + 3] + raw[i00 + S * 3] + raw[i00 + S * 3 + 3] + 2) / 4;
+        }
+        out.data[(static_cast<size_t>(y) * D + x) * 3 + c] = static_cast<uint8_t>(v);
+      }
+    }
+  }
+  return out;
+}
+
+int main() {
+  const int S = 512;
+  VCQualityRegressionHarness harness;
+  VCImageVariant reference = [](const std::vector<uint8_t>& e) {
+    return vcDemoDecode(e, false);
+  };
+  for (int n = 0; n < 4; ++n) {
+    std::vector<uint8_t> raw(static_cast<size_t>(S) * S * 3);
+    for (int y = 0; y < S; ++y) {
+      for (int x = 0; x < S; ++x) {
+        for (int c = 0; c < 3; ++c) {
+          // Fine stripes plus a smooth gradient: aliasing-sensitive content.
+          const int stripe = ((x + y * (n + 1)) & 1) ? 40 : 0;
+          raw[(static_cast<size_t>(y) * S + x) * 3 + c] =
+              static_cast<uint8_t>((x / 3 + y / 5 + c * 30 + stripe) & 0xFF);
+        }
+      }
+    }
+    harness.addCaseFromReference("case" + std::to_string(n), std::move(raw), reference);
+  }
+
+  const VCQualityReport same = harness.run(reference);
+  const VCQualityReport fast = harness.run([](const std::vector<uint8_t>& e) {
+    return vcDemoDecode(e, true);
+  });
+  std::cout << "box variant:     " << same.toJSON() << "\n";
+  std::cout << "nearest variant: " << fast.toJSON() << "\n";
+  bool ok = same.passed();  // the reference-equivalent variant must not regress
+
+  // Exception text with quotes and a backslash stays valid JSON.
+  const VCQualityReport threw = harness.run([](const std::vector<uint8_t>&) -> VCDecodedImage {
+    throw std::runtime_error("decoder \"jpeg\" failed at C:\\corpus");
+  });
+  const std::string json = threw.toJSON();
+  if (json.find("variant threw: decoder \\\"jpeg\\\" failed at C:\\\\corpus") ==
+      std::string::npos) {
+    std::cout << "FAIL: failure text not escaped: " << json << "\n";
+    ok = false;
+  }
+
+  // RGBA input (IImageDecoder output) scores the same as RGB: alpha is ignored.
+  std::vector<uint8_t> encoded(static_cast<size_t>(S) * S * 3);
+  for (size_t i = 0; i < encoded.size(); ++i) encoded[i] = static_cast<uint8_t>(i * 7 + i / 1531);
+  const VCDecodedImage a = vcDemoDecode(encoded, false);
+  const VCDecodedImage b = vcDemoDecode(encoded, true);
+  auto toRGBA = [](const VCDecodedImage& img) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(img.width) * img.height * 4);
+    for (size_t p = 0; p < static_cast<size_t>(img.width) * img.height; ++p) {
+      std::memcpy(&rgba[p * 4], &img.data[p * 3], 3);
+      rgba[p * 4 + 3] = static_cast<uint8_t>(p);  // varying alpha must not count
+    }
+    return rgba;
+  };
+  const VCImageQualityMetrics metrics;
+  const VCQualityScores rgb = metrics.all(VCViewOf(a), VCViewOf(b));
+  const std::vector<uint8_t> ra = toRGBA(a), rb = toRGBA(b);
+  const VCQualityScores rgba = metrics.all(VCViewOfRGBA(ra, a.width, a.height),
+                                           VCViewOfRGBA(rb, b.width, b.height));
+  std::cout << "rgb psnr " << rgb.psnr << ", rgba psnr " << rgba.psnr << "\n";
+  if (std::fabs(rgb.psnr - rgba.psnr) > 1e-9 || std::fabs(rgb.ssim - rgba.ssim) > 1e-9 ||
+      std::fabs(rgb.msssim - rgba.msssim) > 1e-9) {
+    std::cout << "FAIL: RGBA scores differ from RGB\n";
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,487 @@
+// File: /visual-code/pipelines/cpp/perceptual_image_fingerprint.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS (NDK); SSE2 / NEON / scalar
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Perceptual fingerprints for VCDecodedImage that survive re-encoding,
+//   mild resizing, brightness shifts and noise (unlike a byte hash):
+//   - dHash: 9x8 luma grid, one bit per horizontal gradient sign.
+//   - pHash: 32x32 luma grid, low-frequency 8x8 DCT-II, one bit per
+//     coefficient above the AC median.
+//   - VCFingerprintIndex: Hamming-radius search via multi-index hashing
+//     (code split into four 16-bit chunks; by pigeonhole, any code within
+//     radius r matches at least one chunk within floor(r / 4)).
+//
+//   Throughput target is 10^4 images/s per core. Luma grids are built by
+//   sparse box sampling (a fixed number of taps per cell) instead of a full
+//   area resize, so cost is independent of the input resolution.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VC_FP_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VC_FP_NEON 1
+#endif
+
+#include "vc_decoded_image.hpp"
+
+struct VCImageFingerprint {
+  uint64_t dhash;
+  uint64_t phash;
+};
+
+struct VCFingerprintConfig {
+  // Sampling taps per cell along each axis (taps per cell = n * n).
+  int samplesPerCell;
+
+  VCFingerprintConfig() : samplesPerCell(4) {}
+};
+
+struct VCFingerprintMatch {
+  uint32_t id;
+  int distance;
+};
+
+static inline int VCHammingDistance64(uint64_t a, uint64_t b) {
+  const uint64_t x = a ^ b;
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(x);
+#else
+  uint64_t v = x - ((x >> 1) & 0x5555555555555555ULL);
+  v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+  v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast<int>((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// 32-wide float kernels used by the DCT (one pHash row is exactly 32 floats).
+// -----------------------------------------------------------------------------
+
+static inline void vcAxpy32(float a, const float* x, float* y) {
+#if defined(VC_FP_SSE2)
+  const __m128 va = _mm_set1_ps(a);
+  for (int i = 0; i < 32; i += 4) {
+    __m128 vy = _mm_loadu_ps(y + i);
+    vy = _mm_add_ps(vy, _mm_mul_ps(va, _mm_loadu_ps(x + i)));
+    _mm_storeu_ps(y + i, vy);
+  }
+#elif defined(VC_FP_NEON)
+  const float32x4_t va = vdupq_n_f32(a);
+  for (int i = 0; i < 32; i += 4) {
+    vst1q_f32(y + i, vmlaq_f32(vld1q_f32(y + i), va, vld1q_f32(x + i)));
+  }
+#else
+  for (int i = 0; i < 32; ++i) y[i] += a * x[i];
+#endif
+}
+
+static inline float vcDot32(const float* a, const float* b) {
+#if defined(VC_FP_SSE2)
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  for (int i = 0; i < 32; i += 8) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc1 = _mm_add_ps(acc1,
+                      _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(VC_FP_NEON)
+  float32x4_t acc = vdupq_n_f32(0.0f);
+  for (int i = 0; i < 32; i += 4) {
+    acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+  }
+  float lanes[4];
+  vst1q_f32(lanes, acc);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+  float acc = 0.0f;
+  for (int i = 0; i < 32; ++i) acc += a[i] * b[i];
+  return acc;
+#endif
+}
+
+class VCPerceptualFingerprinter {
+ public:
+  explicit VCPerceptualFingerprinter(
+      const VCFingerprintConfig& cfg = VCFingerprintConfig())
+      : config_(cfg) {
+    if (config_.samplesPerCell < 1 || config_.samplesPerCell > 16) {
+      throw std::invalid_argument("samplesPerCell must be in [1, 16]");
+    }
+  }
+
+  VCImageFingerprint compute(const VCDecodedImage& img) const {
+    validate(img);
+    VCImageFingerprint fp;
+    fp.dhash = dhashUnchecked(img);
+    fp.phash = phashUnchecked(img);
+    return fp;
+  }
+
+  uint64_t dhash(const VCDecodedImage& img) const {
+    validate(img);
+    return dhashUnchecked(img);
+  }
+
+  uint64_t phash(const VCDecodedImage& img) const {
+    validate(img);
+    return phashUnchecked(img);
+  }
+
+ private:
+  VCFingerprintConfig config_;
+
+  static constexpr int kDGridW = 9;
+  static constexpr int kDGridH = 8;
+  static constexpr int kPGrid = 32;
+  static constexpr int kPLow = 8;
+
+  struct DctTable {
+    // Orthonormal DCT-II basis rows for the first kPLow frequencies.
+    float c[kPLow][kPGrid];
+
+    DctTable() {
+      const double pi = 3.14159265358979323846;
+      for (int u = 0; u < kPLow; ++u) {
+        const double scale =
+            (u == 0) ? std::sqrt(1.0 / kPGrid) : std::sqrt(2.0 / kPGrid);
+        for (int x = 0; x < kPGrid; ++x) {
+          c[u][x] = static_cast<float>(
+              scale * std::cos(pi * (2.0 * x + 1.0) * u / (2.0 * kPGrid)));
+        }
+      }
+    }
+  };
+
+  static const DctTable& dctTable() {
+    static const DctTable table;
+    return table;
+  }
+
+  static void validate(const VCDecodedImage& img) {
+    if (img.width <= 0 || img.height <= 0) {
+      throw std::invalid_argument("Fingerprint: empty image");
+    }
+    const size_t need = static_cast<size_t>(img.width) *
+                        static_cast<size_t>(img.height) * 3;
+    if (img.data.size() < need) {
+      throw std::invalid_argument("Fingerprint: pixel buffer too small");
+    }
+  }
+
+  // Average luma of gridW x gridH cells, each from n x n evenly spread taps.
+  // Tap positions are sub-cell centres, so every cell has valid taps even
+  // when the image is smaller than the grid.
+  void sampleLumaGrid(const VCDecodedImage& img,
+                      int gridW,
+                      int gridH,
+                      float* out) const {
+    const int n = config_.samplesPerCell;
+    const int W = img.width;
+    const int H = img.height;
+    int xs[kPGrid * 16];
+    int ys[kPGrid * 16];
+    const int tapsX = gridW * n;
+    const int tapsY = gridH * n;
+    for (int i = 0; i < tapsX; ++i) {
+      xs[i] = static_cast<int>(
+          (static_cast<int64_t>(2 * i + 1) * W) / (2 * tapsX)) * 3;
+    }
+    for (int i = 0; i < tapsY; ++i) {
+      ys[i] = static_cast<int>((static_cast<int64_t>(2 * i + 1) * H) /
+                               (2 * tapsY));
+    }
+
+    const uint8_t* base = img.data.data();
+    const size_t rowBytes = static_cast<size_t>(W) * 3;
+    const float inv = 1.0f / static_cast<float>(n * n * 256);
+    for (int cy = 0; cy < gridH; ++cy) {
+      for (int cx = 0; cx < gridW; ++cx) {
+        uint32_t acc = 0;
+        for (int sy = 0; sy < n; ++sy) {
+          const uint8_t* row = base + ys[cy * n + sy] * rowBytes;
+          for (int sx = 0; sx < n; ++sx) {
+            const uint8_t* p = row + xs[cx * n + sx];
+            acc += 77u * p[0] + 150u * p[1] + 29u * p[2];
+          }
+        }
+        out[cy * gridW + cx] = static_cast<float>(acc) * inv;
+      }
+    }
+  }
+
+  uint64_t dhashUnchecked(const VCDecodedImage& img) const {
+    float g[kDGridW * kDGridH];
+    sampleLumaGrid(img, kDGridW, kDGridH, g);
+    uint64_t bits = 0;
+    int bit = 0;
+    for (int y = 0; y < kDGridH; ++y) {
+      const float* row = g + y * kDGridW;
+      for (int x = 0; x < kDGridW - 1; ++x, ++bit) {
+        if (row[x] > row[x + 1]) bits |= (uint64_t{1} << bit);
+      }
+    }
+    return bits;
+  }
+
+  uint64_t phashUnchecked(const VCDecodedImage& img) const {
+    alignas(16) float g[kPGrid * kPGrid];
+    sampleLumaGrid(img, kPGrid, kPGrid, g);
+
+    // Separable DCT restricted to the low 8x8 block:
+    //   T = C * G   (8x32, row-wise axpy)
+    //   P = T * C^T (8x8, dot products)
+    const DctTable& dct = dctTable();
+    alignas(16) float t[kPLow][kPGrid];
+    std::memset(t, 0, sizeof(t));
+    for (int u = 0; u < kPLow; ++u) {
+      for (int y = 0; y < kPGrid; ++y) {
+        vcAxpy32(dct.c[u][y], g + y * kPGrid, t[u]);
+      }
+    }
+    float coeffs[kPLow * kPLow];
+    for (int u = 0; u < kPLow; ++u) {
+      for (int v = 0; v < kPLow; ++v) {
+        coeffs[u * kPLow + v] = vcDot32(t[u], dct.c[v]);
+      }
+    }
+
+    // Median over the AC coefficients (DC only tracks mean brightness).
+    float ac[kPLow * kPLow - 1];
+    std::memcpy(ac, coeffs + 1, sizeof(ac));
+    const int mid = (kPLow * kPLow - 1) / 2;
+    std::nth_element(ac, ac + mid, ac + (kPLow * kPLow - 1));
+    const float median = ac[mid];
+
+    uint64_t bits = 0;
+    for (int i = 0; i < kPLow * kPLow; ++i) {
+      if (coeffs[i] > median) bits |= (uint64_t{1} << i);
+    }
+    return bits;
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Multi-index hashing over 64-bit codes.
+// -----------------------------------------------------------------------------
+
+class VCFingerprintIndex {
+ public:
+  static constexpr int kChunks = 4;
+  static constexpr int kMaxRadius = 15;  // per-chunk probe radius <= 3
+
+  uint32_t add(uint64_t code) {
+    const uint32_t id = static_cast<uint32_t>(codes_.size());
+    codes_.push_back(code);
+    for (int c = 0; c < kChunks; ++c) {
+      tables_[c][chunk(code, c)].push_back(id);
+    }
+    return id;
+  }
+
+  size_t size() const { return codes_.size(); }
+
+  uint64_t code(uint32_t id) const {
+    if (id >= codes_.size()) throw std::out_of_range("VCFingerprintIndex id");
+    return codes_[id];
+  }
+
+  // All stored codes within Hamming distance <= radius, sorted by distance.
+  // Const and allocation-local, so concurrent searches are safe as long as
+  // no add() runs at the same time.
+  void search(uint64_t query,
+              int radius,
+              std::vector<VCFingerprintMatch>& out) const {
+    if (radius < 0 || radius > kMaxRadius) {
+      throw std::invalid_argument("VCFingerprintIndex: radius out of range");
+    }
+    out.clear();
+    const int probe = radius / kChunks;
+
+    std::vector<uint32_t> candidates;
+    for (int c = 0; c < kChunks; ++c) {
+      const auto& table = tables_[c];
+      forEachWithin(chunk(query, c), probe, [&](uint16_t key) {
+        auto it = table.find(key);
+        if (it != table.end()) {
+          candidates.insert(candidates.end(), it->second.begin(),
+                            it->second.end());
+        }
+      });
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                     candidates.end());
+
+    for (uint32_t id : candidates) {
+      const int d = VCHammingDistance64(query, codes_[id]);
+      if (d <= radius) out.push_back(VCFingerprintMatch{id, d});
+    }
+    std::sort(out.begin(), out.end(),
+              [](const VCFingerprintMatch& a, const VCFingerprintMatch& b) {
+                return a.distance != b.distance ? a.distance < b.distance
+                                                : a.id < b.id;
+              });
+  }
+
+ private:
+  std::vector<uint64_t> codes_;
+  std::array<std::unordered_map<uint16_t, std::vector<uint32_t>>, kChunks>
+      tables_;
+
+  static uint16_t chunk(uint64_t code, int c) {
+    return static_cast<uint16_t>(code >> (16 * c));
+  }
+
+  // Enumerate every 16-bit key within Hamming distance <= r (r <= 3).
+  template <typename F>
+  static void forEachWithin(uint16_t key, int r, F&& f) {
+    f(key);
+    if (r < 1) return;
+    for (int i = 0; i < 16; ++i) {
+      const uint16_t k1 = static_cast<uint16_t>(key ^ (1u << i));
+      f(k1);
+      if (r < 2) continue;
+      for (int j = i + 1; j < 16; ++j) {
+        const uint16_t k2 = static_cast<uint16_t>(k1 ^ (1u << j));
+        f(k2);
+        if (r < 3) continue;
+        for (int k = j + 1; k < 16; ++k) {
+          f(static_cast<uint16_t>(k2 ^ (1u << k)));
+        }
+      }
+    }
+  }
+};
+
+#ifdef VC_PERCEPTUAL_FINGERPRINT_BENCH
+#include <chrono>
+#include <iostream>
+#include <random>
+
+// Near-duplicate benchmark on synthetic images: each base image gets a
+// degraded copy (brightness shift, noise, 2px crop + rescale), then every
+// copy is searched against the index of base images.
+static VCDecodedImage vcMakeSyntheticImage(std::mt19937& rng, int W, int H) {
+  // Gradient background plus a dozen random flat-coloured rectangles: crude,
+  // but gives each image its own low-frequency layout like real photos.
+  std::uniform_int_distribution<int> colour(0, 255);
+  std::uniform_int_distribution<int> px(0, W - 1);
+  std::uniform_int_distribution<int> py(0, H - 1);
+  VCDecodedImage img;
+  img.width = W;
+  img.height = H;
+  img.data.resize(static_cast<size_t>(W) * H * 3);
+  int from[3], to[3];
+  for (int c = 0; c < 3; ++c) {
+    from[c] = colour(rng);
+    to[c] = colour(rng);
+  }
+  for (int y = 0; y < H; ++y) {
+    for (int x = 0; x < W; ++x) {
+      for (int c = 0; c < 3; ++c) {
+        img.data[(static_cast<size_t>(y) * W + x) * 3 + c] =
+            static_cast<uint8_t>(from[c] + (to[c] - from[c]) * (x + y) / (W + H));
+      }
+    }
+  }
+  for (int r = 0; r < 12; ++r) {
+    int x0 = px(rng), x1 = px(rng), y0 = py(rng), y1 = py(rng);
+    if (x0 > x1) std::swap(x0, x1);
+    if (y0 > y1) std::swap(y0, y1);
+    const uint8_t rgb[3] = {static_cast<uint8_t>(colour(rng)),
+                            static_cast<uint8_t>(colour(rng)),
+                            static_cast<uint8_t>(colour(rng))};
+    for (int y = y0; y <= y1; ++y) {
+      for (int x = x0; x <= x1; ++x) {
+        std::memcpy(&img.data[(static_cast<size_t>(y) * W + x) * 3], rgb, 3);
+      }
+    }
+  }
+  return img;
+}
+
+static VCDecodedImage vcDegrade(const VCDecodedImage& src, std::mt19937& rng) {
+  std::uniform_int_distribution<int> noise(-6, 6);
+  const int crop = 2;
+  VCDecodedImage out;
+  out.width = src.width;
+  out.height = src.height;
+  out.data.resize(src.data.size());
+  for (int y = 0; y < out.height; ++y) {
+    const int sy = crop + y * (src.height - 2 * crop) / out.height;
+    for (int x = 0; x < out.width; ++x) {
+      const int sx = crop + x * (src.width - 2 * crop) / out.width;
+      for (int c = 0; c < 3; ++c) {
+        const int v = src.data[(static_cast<size_t>(sy) * src.width + sx) * 3 + c] +
+                      12 + noise(rng);
+        out.data[(static_cast<size_t>(y) * out.width + x) * 3 + c] =
+            static_cast<uint8_t>(std::min(255, std::max(0, v)));
+      }
+    }
+  }
+  return out;
+}
+
+int main() {
+  const int kImages = 2000;
+  const int kRadius = 10;
+  std::mt19937 rng(1234);
+
+  std::vector<VCDecodedImage> base, dups;
+  base.reserve(kImages);
+  dups.reserve(kImages);
+  for (int i = 0; i < kImages; ++i) {
+    base.push_back(vcMakeSyntheticImage(rng, 256, 256));
+    dups.push_back(vcDegrade(base.back(), rng));
+  }
+
+  VCPerceptualFingerprinter fp;
+  std::vector<VCImageFingerprint> baseFp(kImages), dupFp(kImages);
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kImages; ++i) {
+    baseFp[i] = fp.compute(base[i]);
+    dupFp[i] = fp.compute(dups[i]);
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const double secs = std::chrono::duration<double>(t1 - t0).count();
+
+  VCFingerprintIndex index;
+  for (const auto& f : baseFp) index.add(f.phash);
+
+  int truePositives = 0;
+  int falsePositives = 0;
+  std::vector<VCFingerprintMatch> matches;
+  const auto t2 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kImages; ++i) {
+    index.search(dupFp[i].phash, kRadius, matches);
+    for (const auto& m : matches) {
+      if (m.id == static_cast<uint32_t>(i)) ++truePositives;
+      else ++falsePositives;
+    }
+  }
+  const auto t3 = std::chrono::steady_clock::now();
+  const double qsecs = std::chrono::duration<double>(t3 - t2).count();
+
+  std::cout << "images fingerprinted: " << 2 * kImages << "\n"
+            << "fingerprint throughput: " << (2 * kImages) / secs
+            << " images/s (1 thread, dHash + pHash)\n"
+            << "search throughput: " << kImages / qsecs << " queries/s\n"
+            << "near-duplicate recall @r=" << kRadius << ": "
+            << static_cast<double>(truePositives) / kImages << "\n"
+            << "false positives: " << falsePositives << "\n";
+  return 0;
+}
+#endif
@@ -12,6 +12,8 @@
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include "vc_decoded_image.hpp"
+
 struct VCResizeConfig {
   int targetWidth;
   int targetHeight;
@@ -31,13 +33,6 @@ struct VCResizeConfig {
         minHeight(64) {}
 };
 
-struct VCDecodedImage {
-  int width;
-  int height;
-  // 8-bit RGB, HWC layout
-  std::vector<uint8_t> data;
-};
-
 class VCDecodeResizePipeline {
  public:
   explicit VCDecodeResizePipeline(const VCResizeConfig& cfg)
@@ -0,0 +1,19 @@
+// File: /visual-code/pipelines/cpp/vc_decoded_image.hpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS (NDK)
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Shared output type of VCDecodeResizePipeline, split out so CPU-only
+//   consumers (fingerprinting, palette extraction, quality metrics) can
+//   operate on decoded images without pulling in OpenCV.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct VCDecodedImage {
+  int width;
+  int height;
+  // 8-bit RGB, HWC layout
+  std::vector<uint8_t> data;
+};
@@ -0,0 +1,722 @@
+// File: /visual-code/runtime/vlig_backend_dispatcher.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS NDK
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Per-request routing of scene plans to generation backends. Before this,
+//   the router stopped at the control JSON. The dispatcher picks a backend
+//   for each plan, runs it, and returns the first result that arrives.
+//
+//   - Routing. Each backend declares the highest VCQualityPreset it serves
+//     and how many requests it runs in parallel. The dispatcher keeps an
+//     EWMA of each backend's latency. A plan goes to the eligible backend
+//     with the lowest expected latency: the EWMA, stretched by the queue
+//     that forms once its in-flight count reaches its concurrency.
+//     A backend that stops being picked gets no new samples. So while it
+//     sits idle, its EWMA decays back toward its prior, and one tail spike
+//     cannot starve it for good. Backends that fail `failureThreshold`
+//     times in a row are ejected for `ejectFor`.
+//   - Stable fallback. One backend is marked as the fallback. It serves
+//     plans no other healthy backend can take, and it retries a request
+//     whose attempts have all failed.
+//   - Hedging (optional). If the primary has not answered within its own
+//     recent latency percentile (P95 by default, from a window of the last
+//     256 completions), one duplicate goes to the next-best backend. The
+//     first success wins and the loser's token is cancelled. Hedges are
+//     capped at a fraction of requests, so a slow fleet is not doubled.
+//
+//   Latency statistics only count completed successes. Cancelled losers
+//   are censored rather than recorded as fast or slow, and failures feed
+//   the ejection counter instead. Attempts run on an executor (default: a
+//   detached thread each) and may outlive the dispatch call that started
+//   them.
+
+#ifndef VC_VLIG_BACKEND_DISPATCHER_CPP
+#define VC_VLIG_BACKEND_DISPATCHER_CPP
+
+#include "vlig_semantic_guided_router.cpp"
+#include "vlig_single_flight.cpp"
+
+#include <chrono>
+#include <optional>
+
+namespace vc_vlig {
+
+struct VCBackendSpec {
+    std::string name;
+    VCQualityPreset maxQuality = VCQualityPreset::Ultra;  // highest preset served
+    double priorLatencyMs = 1000.0;  // expectation before the first sample
+    unsigned concurrency = 1;        // requests served in parallel without queueing
+};
+
+struct VCDispatcherConfig {
+    double ewmaAlpha = 0.2;
+    std::chrono::milliseconds idleHalfLife{2000};  // EWMA decay toward the prior
+    std::size_t fallback = 0;        // index of the stable fallback backend
+    bool hedge = true;
+    double hedgePercentile = 0.95;   // of the primary's recent latency
+    double minHedgeDelayMs = 20.0;
+    std::size_t minSamples = 20;     // before the percentile is trusted
+    double maxHedgeFraction = 0.1;   // hedges per dispatched request
+    unsigned failureThreshold = 3;   // consecutive failures before ejection
+    std::chrono::milliseconds ejectFor{5000};
+};
+
+struct VCBackendStats {
+    std::string name;
+    double ewmaMs = 0.0;
+    double hedgeDelayMs = 0.0;  // current percentile-based hedge delay
+    uint64_t attempts = 0;      // primary, hedge and fallback launches
+    uint64_t wins = 0;          // attempts whose result was returned
+    uint64_t failures = 0;
+    uint64_t cancelled = 0;     // losers stopped after the other attempt won
+    std::size_t inFlight = 0;
+    bool ejected = false;
+};
+
+struct VCDispatcherStats {
+    uint64_t dispatched = 0;
+    uint64_t hedged = 0;      // requests that launched a duplicate
+    uint64_t hedgeWins = 0;   // ... where the duplicate answered first
+    uint64_t fallbacks = 0;   // routed to, or retried on, the fallback
+    uint64_t failed = 0;      // requests that threw
+};
+
+template <class Result>
+struct VCDispatchOutcome {
+    Result value;
+    std::size_t backend = 0;  // index of the backend that answered
+    bool hedged = false;
+    double latencyMs = 0.0;
+};
+
+template <class Result>
+class VCBackendDispatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Generate = std::function<Result(const VCSemanticIGResult &, uint64_t, const VCCancelToken &)>;
+    using Executor = std::function<void(std::function<void()>)>;
+
+    explicit VCBackendDispatcher(const VCDispatcherConfig &config = {}, Executor executor = {})
+        : shared_(std::make_shared<Shared>()), executor_(std::move(executor)) {
+        shared_->config = config;
+        if (!executor_)
+            executor_ = [](std::function<void()> job) { std::thread(std::move(job)).detach(); };
+    }
+
+    VCBackendDispatcher(const VCBackendDispatcher &) = delete;
+    VCBackendDispatcher &operator=(const VCBackendDispatcher &) = delete;
+
+    // Registers a backend and returns its index. Register every backend
+    // before the first dispatch.
+    std::size_t addBackend(const VCBackendSpec &spec, Generate generate) {
+        if (!generate)
+            throw std::invalid_argument("dispatcher: backend needs a generate function");
+        std::lock_guard<std::mutex> lock(shared_->mu);
+        auto b = std::make_unique<Backend>();
+        b->spec = spec;
+        b->spec.concurrency = std::max(1u, spec.concurrency);
+        b->generate = std::move(generate);
+        b->ewmaMs = spec.priorLatencyMs;
+        b->lastSample = Clock::now();
+        b->hedgeDelayMs = 2.0 * spec.priorLatencyMs;
+        shared_->backends.push_back(std::move(b));
+        return shared_->backends.size() - 1;
+    }
+
+    // Runs `spec` on the best backend for its quality preset and returns
+    // the first successful result. Throws VCCancelledError if `waiter` is
+    // cancelled first, or the last backend error if every attempt failed.
+    VCDispatchOutcome<Result> dispatch(const VCSemanticIGResult &spec, uint64_t seed,
+                                       const VCCancelToken &waiter = VCCancelToken()) {
+        if (waiter.cancelled()) throw VCCancelledError();
+        const auto start = Clock::now();
+        auto race = std::make_shared<Race>();
+        auto plan = std::make_shared<const VCSemanticIGResult>(spec);
+
+        std::size_t primary, hedgeTarget = kNone;
+        bool hedgePending = false;
+        double hedgeDelayMs = 0.0;
+        bool fallbackTried = false;
+        {
+            std::lock_guard<std::mutex> lock(shared_->mu);
+            if (shared_->backends.empty())
+                throw std::logic_error("dispatcher: no backends registered");
+            ++shared_->stats.dispatched;
+            const Clock::time_point now = start;
+            primary = pickLocked(plan->scene.quality, kNone, now);
+            if (primary == kNone) {
+                primary = fallbackLocked();
+                ++shared_->stats.fallbacks;
+            }
+            fallbackTried = primary == fallbackLocked();
+            if (shared_->config.hedge) {
+                hedgeTarget = pickLocked(plan->scene.quality, primary, now);
+                hedgePending = hedgeTarget != kNone;
+                hedgeDelayMs = std::max(shared_->config.minHedgeDelayMs,
+                                        shared_->backends[primary]->hedgeDelayMs);
+            }
+        }
+        launch(race, plan, seed, primary);
+
+        const uint64_t sub = waiter.subscribe([race] {
+            std::lock_guard<std::mutex> lock(race->mu);
+            race->cv.notify_all();
+        });
+        bool hedged = false;
+        auto hedgeAt = start + std::chrono::duration_cast<Clock::duration>(
+                                   std::chrono::duration<double, std::milli>(hedgeDelayMs));
+        std::unique_lock<std::mutex> lock(race->mu);
+        for (;;) {
+            auto ready = [&] { return race->done || race->pending == 0 || waiter.cancelled(); };
+            if (hedgePending) {
+                race->cv.wait_until(lock, hedgeAt, ready);
+            } else {
+                race->cv.wait(lock, ready);
+            }
+            if (race->done) {
+                VCDispatchOutcome<Result> out{std::move(*race->value), race->winner, hedged,
+                                              std::chrono::duration<double, std::milli>(Clock::now() - start).count()};
+                auto losers = race->tokens;
+                lock.unlock();
+                waiter.unsubscribe(sub);
+                for (auto &t : losers)
+                    t.cancel();
+                if (hedged && out.backend == hedgeTarget) {
+                    std::lock_guard<std::mutex> s(shared_->mu);
+                    ++shared_->stats.hedgeWins;
+                }
+                return out;
+            }
+            if (waiter.cancelled()) {
+                auto running = race->tokens;
+                lock.unlock();
+                waiter.unsubscribe(sub);
+                for (auto &t : running)
+                    t.cancel();
+                throw VCCancelledError();
+            }
+            if (race->pending == 0) {
+                // Every attempt failed: one retry on the fallback.
+                if (fallbackTried) {
+                    std::exception_ptr error = race->error;
+                    lock.unlock();
+                    waiter.unsubscribe(sub);
+                    {
+                        std::lock_guard<std::mutex> s(shared_->mu);
+                        ++shared_->stats.failed;
+                    }
+                    std::rethrow_exception(error);
+                }
+                fallbackTried = true;
+                hedgePending = false;
+                lock.unlock();
+                std::size_t fb;
+                {
+                    std::lock_guard<std::mutex> s(shared_->mu);
+                    ++shared_->stats.fallbacks;
+                    fb = fallbackLocked();
+                }
+                launch(race, plan, seed, fb);
+                lock.lock();
+                continue;
+            }
+            if (hedgePending && Clock::now() >= hedgeAt) {
+                hedgePending = false;
+                bool allowed;
+                {
+                    std::lock_guard<std::mutex> s(shared_->mu);
+                    const VCDispatcherStats &st = shared_->stats;
+                    allowed = double(st.hedged + 1) <= shared_->config.maxHedgeFraction * double(st.dispatched) &&
+                              !ejectedLocked(*shared_->backends[hedgeTarget], Clock::now());
+                    if (allowed) ++shared_->stats.hedged;
+                }
+                if (allowed) {
+                    lock.unlock();
+                    launch(race, plan, seed, hedgeTarget);
+                    lock.lock();
+                    hedged = true;
+                }
+            }
+        }
+    }
+
+    // Expected latency of backend `i` for a request arriving now.
+    double expectedLatencyMs(std::size_t i) const {
+        std::lock_guard<std::mutex> lock(shared_->mu);
+        return expectedLocked(*shared_->backends.at(i), Clock::now());
+    }
+
+    std::vector<VCBackendStats> backendStats() const {
+        std::lock_guard<std::mutex> lock(shared_->mu);
+        std::vector<VCBackendStats> out;
+        const auto now = Clock::now();
+        for (const auto &b : shared_->backends) {
+            VCBackendStats s = b->stats;
+            s.name = b->spec.name;
+            s.ewmaMs = decayedEwmaLocked(*b, now);
+            s.hedgeDelayMs = b->hedgeDelayMs;
+            s.inFlight = b->inFlight;
+            s.ejected = ejectedLocked(*b, now);
+            out.push_back(std::move(s));
+        }
+        return out;
+    }
+
+    VCDispatcherStats stats() const {
+        std::lock_guard<std::mutex> lock(shared_->mu);
+        return shared_->stats;
+    }
+
+private:
+    static constexpr std::size_t kNone = ~std::size_t(0);
+    static constexpr std::size_t kWindow = 256;
+    static constexpr std::size_t kRefreshEvery = 16;
+
+    struct Backend {
+        VCBackendSpec spec;
+        Generate generate;
+        double ewmaMs = 0.0;
+        double hedgeDelayMs = 0.0;
+        float window[kWindow] = {};
+        std::size_t head = 0, count = 0, sinceRefresh = 0;
+        std::size_t inFlight = 0;
+        Clock::time_point lastSample;
+        unsigned consecutiveFailures = 0;
+        Clock::time_point ejectedUntil{};
+        VCBackendStats stats;
+    };
+
+    struct Shared {
+        std::mutex mu;
+        VCDispatcherConfig config;
+        std::vector<std::unique_ptr<Backend>> backends;
+        VCDispatcherStats stats;
+        std::vector<float> scratch;  // guarded by mu
+    };
+
+    struct Race {
+        std::mutex mu;
+        std::condition_variable cv;
+        std::vector<VCCancelToken> tokens;  // one per launched attempt
+        unsigned pending = 0;
+        bool done = false;
+        std::optional<Result> value;
+        std::size_t winner = 0;
+        std::exception_ptr error;
+    };
+
+    std::shared_ptr<Shared> shared_;
+    Executor executor_;
+
+    std::size_t fallbackLocked() const {
+        return std::min(shared_->config.fallback, shared_->backends.size() - 1);
+    }
+
+    static bool ejectedLocked(const Backend &b, Clock::time_point now) { return now < b.ejectedUntil; }
+
+    double decayedEwmaLocked(const Backend &b, Clock::time_point now) const {
+        const double idle = std::chrono::duration<double>(now - b.lastSample).count();
+        const double halfLife = std::chrono::duration<double>(shared_->config.idleHalfLife).count();
+        if (idle <= 0.0 || halfLife <= 0.0) return b.ewmaMs;
+        const double prior = b.spec.priorLatencyMs;
+        return prior + (b.ewmaMs - prior) * std::exp2(-idle / halfLife);
+    }
+
+    // EWMA, stretched by the queue once in-flight work fills the backend.
+    double expectedLocked(const Backend &b, Clock::time_point now) const {
+        const double ewma = decayedEwmaLocked(b, now);
+        const unsigned c = b.spec.concurrency;
+        if (b.inFlight < c) return ewma;
+        return ewma * (1.0 + double(b.inFlight - c + 1) / double(c));
+    }
+
+    std::size_t pickLocked(VCQualityPreset quality, std::size_t exclude, Clock::time_point now) const {
+        std::size_t best = kNone;
+        double bestMs = 0.0;
+        for (std::size_t i = 0; i < shared_->backends.size(); ++i) {
+            const Backend &b = *shared_->backends[i];
+            if (i == exclude || ejectedLocked(b, now)) continue;
+            if (static_cast<int>(b.spec.maxQuality) < static_cast<int>(quality)) continue;
+            const double ms = expectedLocked(b, now);
+            if (best == kNone || ms < bestMs) {
+                best = i;
+                bestMs = ms;
+            }
+        }
+        return best;
+    }
+
+    void launch(const std::shared_ptr<Race> &race, const std::shared_ptr<const VCSemanticIGResult> &plan,
+                uint64_t seed, std::size_t index) {
+        VCCancelToken token;
+        {
+            std::lock_guard<std::mutex> lock(race->mu);
+            race->tokens.push_back(token);
+            ++race->pending;
+        }
+        Generate generate;
+        {
+            std::lock_guard<std::mutex> lock(shared_->mu);
+            Backend &b = *shared_->backends[index];
+            ++b.inFlight;
+            ++b.stats.attempts;
+            generate = b.generate;
+        }
+        std::shared_ptr<Shared> shared = shared_;
+        executor_([shared, race, plan, seed, index, token, generate = std::move(generate)] {
+            const auto t0 = Clock::now();
+            std::optional<Result> value;
+            std::exception_ptr error;
+            try {
+                value.emplace(generate(*plan, seed, token));
+            } catch (...) {
+                error = std::current_exception();
+            }
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+            // Stats are recorded before the waiter is woken, so a caller that
+            // reads them after dispatch() returns sees this attempt counted.
+            std::lock_guard<std::mutex> lock(race->mu);
+            --race->pending;
+            bool won = false;
+            if (value && !race->done) {
+                race->done = true;
+                race->value = std::move(value);
+                race->winner = index;
+                won = true;
+            } else if (error && !race->done) {
+                race->error = error;
+            }
+            recordAttempt(*shared, index, ms, won, !error, error && token.cancelled());
+            race->cv.notify_all();
+        });
+    }
+
+    static void recordAttempt(Shared &s, std::size_t index, double ms, bool won, bool ok, bool cancelled) {
+        std::lock_guard<std::mutex> lock(s.mu);
+        Backend &b = *s.backends[index];
+        --b.inFlight;
+        if (won) ++b.stats.wins;
+        if (cancelled) {
+            ++b.stats.cancelled;
+            return;
+        }
+        if (!ok) {
+            ++b.stats.failures;
+            if (++b.consecutiveFailures >= s.config.failureThreshold) {
+                b.ejectedUntil = Clock::now() + s.config.ejectFor;
+                b.consecutiveFailures = 0;
+            }
+            return;
+        }
+        b.consecutiveFailures = 0;
+        const auto now = Clock::now();
+        const double idle = std::chrono::duration<double>(now - b.lastSample).count();
+        const double halfLife = std::chrono::duration<double>(s.config.idleHalfLife).count();
+        if (idle > 0.0 && halfLife > 0.0)
+            b.ewmaMs = b.spec.priorLatencyMs + (b.ewmaMs - b.spec.priorLatencyMs) * std::exp2(-idle / halfLife);
+        b.lastSample = now;
+        b.ewmaMs += s.config.ewmaAlpha * (ms - b.ewmaMs);
+        b.window[b.head] = static_cast<float>(ms);
+        b.head = (b.head + 1) % kWindow;
+        b.count = std::min(b.count + 1, kWindow);
+        if (b.count >= s.config.minSamples && ++b.sinceRefresh >= kRefreshEvery) {
+            b.sinceRefresh = 0;
+            s.scratch.assign(b.window, b.window + b.count);
+            const double q = std::min(std::max(s.config.hedgePercentile, 0.0), 1.0);
+            const std::size_t k = std::min(b.count - 1, static_cast<std::size_t>(q * double(b.count)));
+            std::nth_element(s.scratch.begin(), s.scratch.begin() + k, s.scratch.end());
+            b.hedgeDelayMs = s.scratch[k];
+        }
+    }
+};
+
+// Plans `userPrompt` and dispatches the plan.
+template <class Result>
+static VCDispatchOutcome<Result>
+BuildAndDispatch(VCBackendDispatcher<Result> &dispatcher, const std::string &userPrompt,
+                 VCIGMode mode, VCSafetyProfile safety, VCQualityPreset quality, uint64_t seed,
+                 const VCCancelToken &waiter = VCCancelToken()) {
+    return dispatcher.dispatch(BuildSemanticIGSpec(userPrompt, mode, safety, quality), seed, waiter);
+}
+
+} // namespace vc_vlig
+
+#ifdef VC_VLIG_BACKEND_DISPATCHER_DEMO
+#include <random>
+
+// First, scripted stub backends check fallback, hedge timing, loser
+// cancellation and error propagation; any failed check makes the exit code
+// non-zero. Then local stubs with injected latency distributions (log-normal
+// body plus a heavy tail) and bounded concurrency run two passes over the
+// same request mix, comparing routing alone with routing plus hedging.
+// During the hedged pass, "gpu-a" fails for a while to show ejection and
+// fallback.
+int main() {
+    using namespace vc_vlig;
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+    struct Image {
+        std::string backend;
+        uint64_t seed;
+    };
+
+    bool ok = true;
+    auto check = [&ok](bool cond, const char *what) {
+        std::cout << (cond ? "  ok   " : "  FAIL ") << what << "\n";
+        ok = ok && cond;
+    };
+    // Waits for attempts that outlive their dispatch (cancelled losers).
+    auto drain = [](const VCBackendDispatcher<Image> &d) {
+        for (int i = 0; i < 2000; ++i) {
+            std::size_t inFlight = 0;
+            for (const VCBackendStats &b : d.backendStats()) inFlight += b.inFlight;
+            if (inFlight == 0) return;
+            std::this_thread::sleep_for(1ms);
+        }
+    };
+    using Generate = VCBackendDispatcher<Image>::Generate;
+    auto answer = [](const char *name, std::chrono::milliseconds after) -> Generate {
+        return [name, after](const VCSemanticIGResult &, uint64_t seed, const VCCancelToken &) {
+            std::this_thread::sleep_for(after);
+            return Image{name, seed};
+        };
+    };
+    auto fail = [](const char *message) -> Generate {
+        return [message](const VCSemanticIGResult &, uint64_t, const VCCancelToken &) -> Image {
+            throw std::runtime_error(message);
+        };
+    };
+    const VCSemanticIGResult spec = BuildSemanticIGSpec(
+        "a red fox in a foggy forest, watercolor", VCIGMode::TextToImage, VCSafetyProfile::Safe,
+        VCQualityPreset::Standard);
+
+    std::cout << "scripted checks:\n";
+    {
+        // The primary (lowest prior) fails, so the request is retried on the fallback.
+        VCDispatcherConfig config;
+        config.hedge = false;
+        VCBackendDispatcher<Image> d(config);
+        d.addBackend({"fallback", VCQualityPreset::Ultra, 50.0, 1}, answer("fallback", 0ms));
+        d.addBackend({"primary", VCQualityPreset::Ultra, 5.0, 1}, fail("primary: device lost"));
+        std::optional<VCDispatchOutcome<Image>> out;
+        try {
+            out = d.dispatch(spec, 1);
+        } catch (const std::exception &) {
+        }
+        const std::vector<VCBackendStats> b = d.backendStats();
+        check(out && out->backend == 0 && out->value.backend == "fallback" && !out->hedged,
+              "failing primary falls back to the stable backend");
+        check(b[1].attempts == 1 && b[1].failures == 1 && d.stats().fallbacks == 1,
+              "primary attempted once, one fallback counted");
+    }
+    {
+        // The primary answers before the hedge delay, so no duplicate is sent.
+        VCDispatcherConfig config;
+        config.minHedgeDelayMs = 40.0;
+        config.maxHedgeFraction = 1.0;
+        VCBackendDispatcher<Image> d(config);
+        d.addBackend({"fallback", VCQualityPreset::Ultra, 1000.0, 1}, answer("fallback", 0ms));
+        d.addBackend({"primary", VCQualityPreset::Ultra, 10.0, 1}, answer("primary", 5ms));
+        d.addBackend({"hedge", VCQualityPreset::Ultra, 20.0, 1}, answer("hedge", 0ms));
+        const auto out = d.dispatch(spec, 2);
+        drain(d);
+        check(out.backend == 1 && !out.hedged && d.stats().hedged == 0 &&
+                  d.backendStats()[2].attempts == 0,
+              "no hedge when the primary answers within the delay");
+    }
+    {
+        // The primary hangs until cancelled; the hedge must start no earlier
+        // than the delay, win, and get the primary cancelled.
+        VCDispatcherConfig config;
+        config.minHedgeDelayMs = 40.0;
+        config.maxHedgeFraction = 1.0;
+        VCBackendDispatcher<Image> d(config);
+        auto primaryCancelled = std::make_shared<std::atomic<bool>>(false);
+        auto hedgeStarted = std::make_shared<std::atomic<Clock::rep>>(0);
+        d.addBackend({"fallback", VCQualityPreset::Ultra, 1000.0, 1}, answer("fallback", 0ms));
+        d.addBackend({"primary", VCQualityPreset::Ultra, 10.0, 1},
+                     [primaryCancelled](const VCSemanticIGResult &, uint64_t seed,
+                                        const VCCancelToken &token) {
+                         const auto giveUp = Clock::now() + 2s;
+                         while (Clock::now() < giveUp) {
+                             if (token.cancelled()) {
+                                 primaryCancelled->store(true);
+                                 throw VCCancelledError();
+                             }
+                             std::this_thread::sleep_for(1ms);
+                         }
+                         return Image{"primary", seed};
+                     });
+        d.addBackend({"hedge", VCQualityPreset::Ultra, 20.0, 1},
+                     [hedgeStarted](const VCSemanticIGResult &, uint64_t seed, const VCCancelToken &) {
+                         hedgeStarted->store(Clock::now().time_since_epoch().count());
+                         return Image{"hedge", seed};
+                     });
+        const auto t0 = Clock::now();
+        const auto out = d.dispatch(spec, 3);
+        drain(d);
+        const double hedgeAfterMs = std::chrono::duration<double, std::milli>(
+            Clock::time_point(Clock::duration(hedgeStarted->load())) - t0).count();
+        const std::vector<VCBackendStats> b = d.backendStats();
+        std::cout << "  hedge launched after " << hedgeAfterMs << " ms (delay 40 ms)\n";
+        check(hedgeStarted->load() != 0 && hedgeAfterMs >= 40.0,
+              "hedge fires, and only after the configured delay");
+        check(out.backend == 2 && out.hedged && d.stats().hedged == 1 && d.stats().hedgeWins == 1,
+              "hedge wins the race");
+        check(primaryCancelled->load() && b[1].cancelled == 1 && b[1].failures == 0,
+              "losing primary is cancelled and not counted as a failure");
+    }
+    {
+        // Primary and fallback both fail: the error reaches the caller.
+        VCDispatcherConfig config;
+        config.hedge = false;
+        VCBackendDispatcher<Image> d(config);
+        d.addBackend({"fallback", VCQualityPreset::Ultra, 50.0, 1}, fail("fallback: out of memory"));
+        d.addBackend({"primary", VCQualityPreset::Ultra, 5.0, 1}, fail("primary: device lost"));
+        std::string error;
+        try {
+            d.dispatch(spec, 4);
+        } catch (const std::runtime_error &e) {
+            error = e.what();
+        }
+        check(error == "fallback: out of memory" && d.stats().failed == 1 &&
+                  d.backendStats()[0].attempts == 1 && d.backendStats()[1].attempts == 1,
+              "whole chain failing surfaces the last backend error");
+    }
+    struct Stub {
+        const char *name;
+        VCQualityPreset maxQuality;
+        double medianMs, sigma, tailProb, tailFactor;
+        unsigned concurrency;
+    };
+    const Stub stubs[] = {
+        {"stable-fallback", VCQualityPreset::Ultra, 60.0, 0.10, 0.00, 1.0, 2},
+        {"turbo-draft", VCQualityPreset::Standard, 12.0, 0.25, 0.03, 6.0, 4},
+        {"gpu-a", VCQualityPreset::High, 25.0, 0.30, 0.05, 8.0, 4},
+        {"gpu-b", VCQualityPreset::Ultra, 35.0, 0.30, 0.04, 6.0, 4},
+    };
+    std::atomic<bool> gpuAFailing{false};
+
+    struct Slots {
+        std::mutex mu;
+        std::condition_variable cv;
+        unsigned free = 0;
+    };
+
+    auto run = [&](bool hedge) {
+        VCDispatcherConfig config;
+        config.hedge = hedge;
+        config.ejectFor = 300ms;
+        VCBackendDispatcher<Image> dispatcher(config);
+        std::vector<std::shared_ptr<Slots>> slots;
+        for (const Stub &s : stubs) {
+            auto slot = std::make_shared<Slots>();
+            slot->free = s.concurrency;
+            slots.push_back(slot);
+            auto rng = std::make_shared<std::pair<std::mutex, std::mt19937>>();
+            rng->second.seed(static_cast<unsigned>(slots.size()));
+            const bool failable = std::string(s.name) == "gpu-a";
+            dispatcher.addBackend(
+                {s.name, s.maxQuality, s.medianMs, s.concurrency},
+                [s, slot, rng, failable, &gpuAFailing](const VCSemanticIGResult &, uint64_t seed,
+                                                       const VCCancelToken &token) {
+                    double ms;
+                    {
+                        std::lock_guard<std::mutex> lock(rng->first);
+                        std::lognormal_distribution<double> body(std::log(s.medianMs), s.sigma);
+                        ms = body(rng->second);
+                        if (std::uniform_real_distribution<double>(0, 1)(rng->second) < s.tailProb)
+                            ms *= s.tailFactor;
+                    }
+                    {
+                        std::unique_lock<std::mutex> lock(slot->mu);
+                        while (slot->free == 0) {
+                            if (token.cancelled()) throw VCCancelledError();
+                            slot->cv.wait_for(lock, 1ms);
+                        }
+                        --slot->free;
+                    }
+                    auto release = [&] {
+                        std::lock_guard<std::mutex> lock(slot->mu);
+                        ++slot->free;
+                        slot->cv.notify_one();
+                    };
+                    if (failable && gpuAFailing.load()) {
+                        std::this_thread::sleep_for(2ms);
+                        release();
+                        throw std::runtime_error("gpu-a: device lost");
+                    }
+                    const auto end = std::chrono::steady_clock::now() +
+                                     std::chrono::duration<double, std::milli>(ms);
+                    while (std::chrono::steady_clock::now() < end) {
+                        if (token.cancelled()) {
+                            release();
+                            throw VCCancelledError();
+                        }
+                        std::this_thread::sleep_for(1ms);
+                    }
+                    release();
+                    return Image{s.name, seed};
+                });
+        }
+
+        const VCQualityPreset presets[] = {VCQualityPreset::Draft, VCQualityPreset::Standard,
+                                           VCQualityPreset::High, VCQualityPreset::Ultra};
+        const char *prompts[] = {"a red fox in a foggy forest, watercolor",
+                                 "cinematic 16:9 shot of a lighthouse at dawn",
+                                 "anime style portrait of a samurai, soft lighting",
+                                 "isometric low poly tiny house, pastel tones"};
+        std::vector<VCSemanticIGResult> plans;
+        for (int i = 0; i < 16; ++i)
+            plans.push_back(BuildSemanticIGSpec(prompts[i % 4], VCIGMode::TextToImage,
+                                                VCSafetyProfile::Safe, presets[(i / 4) % 4]));
+
+        const int clients = 6, perClient = 100;
+        std::vector<double> latency;
+        std::mutex latencyMu;
+        std::atomic<int> errors{0};
+        std::vector<std::thread> pool;
+        for (int c = 0; c < clients; ++c) {
+            pool.emplace_back([&, c] {
+                for (int i = 0; i < perClient; ++i) {
+                    if (hedge && c == 0) gpuAFailing.store(i >= 40 && i < 55);
+                    try {
+                        auto out = dispatcher.dispatch(plans[(c * 7 + i) % plans.size()],
+                                                       uint64_t(c) * 1000 + i);
+                        std::lock_guard<std::mutex> lock(latencyMu);
+                        latency.push_back(out.latencyMs);
+                    } catch (const std::exception &) {
+                        errors.fetch_add(1);
+                    }
+                }
+            });
+        }
+        for (std::thread &t : pool) t.join();
+        gpuAFailing.store(false);
+        check(errors.load() == 0, hedge ? "hedged pass: every request served (gpu-a outage "
+                                          "absorbed by fallback)"
+                                        : "routing pass: every request served");
+
+        std::sort(latency.begin(), latency.end());
+        auto pct = [&](double p) {
+            return latency.empty() ? 0.0 : latency[std::min(latency.size() - 1, std::size_t(p * latency.size()))];
+        };
+        const VCDispatcherStats st = dispatcher.stats();
+        std::cout << (hedge ? "routing + hedging" : "routing only") << ": " << latency.size()
+                  << " served, " << errors.load() << " failed; P50 " << pct(0.50) << " ms, P95 "
+                  << pct(0.95) << " ms, P99 " << pct(0.99) << " ms; hedged " << st.hedged << " (won "
+                  << st.hedgeWins << "), fallbacks " << st.fallbacks << "\n";
+        for (const VCBackendStats &b : dispatcher.backendStats())
+            std::cout << "  " << b.name << ": attempts " << b.attempts << ", wins " << b.wins
+                      << ", failures " << b.failures << ", cancelled " << b.cancelled << ", ewma "
+                      << b.ewmaMs << " ms, hedge delay " << b.hedgeDelayMs << " ms\n";
+        // Let cancelled losers drain before the stubs go out of scope.
+        drain(dispatcher);
+    };
+    run(false);
+    run(true);
+    return ok ? 0 : 1;
+}
+#endif
+
+#endif // VC_VLIG_BACKEND_DISPATCHER_CPP
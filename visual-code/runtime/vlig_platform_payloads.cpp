@@ -0,0 +1,544 @@
+// File: /visual-code/runtime/vlig_platform_payloads.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS NDK
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Request bodies for each VCPlatform backend, rendered straight from a
+//   VCScenePlan. The canonical control JSON is never built, parsed back into
+//   a tree and re-mapped. A payload template is compiled once from a
+//   skeleton with {{slot}} placeholders into literal runs and slot ids.
+//   Rendering copies each run and writes each slot's value from the plan:
+//     - strings go through VCJsonWriter's escaper;
+//     - enums use their fixed names;
+//     - numbers are formatted with std::to_chars.
+//
+//   Shapes follow vcCallVLIG in unified_vl_ig_router.js field for field:
+//     - Gemini: the generic image payload (vcBuildGenericImagePayload),
+//       POSTed to the image model's :generateContent endpoint;
+//     - Copilot and Grok: the generic image payload for image-generate, and
+//       for image-edit the OpenAI-style chat payload with the vision model;
+//     - Vondy: the generic image payload;
+//     - CustomHTTP: the generic-json payload.
+//   Text-to-image plans use the JS mode "image-generate" and the other
+//   VCIGModes use "image-edit". Style hints are the plan's art style, colour
+//   tone, lighting and palette hint. Empty entries are left out, as
+//   vcSanitizeStringList does. Steps, guidance and size come from the plan's
+//   (possibly downgraded) preset via qualityLimitsFor. At High and Ultra that
+//   equals vcBuildQualityConfig; Draft and Standard also shrink the size. A
+//   deployment with its own request shape compiles its own VCPayloadTemplate;
+//   {{control_json}} embeds the canonical control JSON there.
+
+#ifndef VC_VLIG_PLATFORM_PAYLOADS_CPP
+#define VC_VLIG_PLATFORM_PAYLOADS_CPP
+
+#include "vlig_semantic_guided_router.cpp"
+#include "vlig_quality_controller.cpp"
+
+#include <charconv>
+
+namespace vc_vlig {
+
+static constexpr const char* toString(VCPlatform p) {
+    switch (p) {
+        case VCPlatform::Gemini:     return "gemini";
+        case VCPlatform::Copilot:    return "copilot";
+        case VCPlatform::Vondy:      return "vondy";
+        case VCPlatform::Grok:       return "grok";
+        case VCPlatform::CustomHTTP: return "custom-http";
+    }
+    return "custom-http";
+}
+
+enum class VCPayloadSlot : uint8_t {
+    Prompt,          // core prompt
+    NegativePrompt,  // visual artifacts, then content exclusions
+    Subject,
+    Environment,
+    TimeOfDay,
+    Weather,
+    PaletteHint,
+    EraHint,
+    ArtStyle,
+    ColorTone,
+    Lighting,
+    CameraAngle,
+    Composition,
+    AspectRatio,
+    Mode,            // JS mode id: "image-generate" / "image-edit"
+    Quality,
+    Safety,
+    BlockNSFW,       // true/false
+    Width,
+    Height,
+    Size,            // "WxH"
+    Steps,
+    Guidance,
+    Seed,
+    Model,
+    RequestId,
+    ControlJson,     // the canonical control JSON object
+    SystemDirectives,
+    StyleHints,
+    NegativePrompts, // array form of NegativePrompt
+    Layout,
+    SourceImageUrl,  // string, or null without one
+    Messages         // OpenAI-style chat messages array
+};
+
+static constexpr const char *kPayloadSlotNames[] = {
+    "prompt", "negative_prompt", "subject", "environment", "time_of_day", "weather",
+    "palette_hint", "era_hint", "art_style", "color_tone", "lighting", "camera_angle",
+    "composition", "aspect_ratio", "mode", "quality", "safety", "block_nsfw", "width",
+    "height", "size", "steps", "guidance", "seed", "model", "request_id", "control_json",
+    "system_directives", "style_hints", "negative_prompts", "layout", "source_image_url",
+    "messages"};
+
+static_assert(sizeof(kPayloadSlotNames) / sizeof(kPayloadSlotNames[0]) ==
+                  static_cast<std::size_t>(VCPayloadSlot::Messages) + 1,
+              "kPayloadSlotNames must list every VCPayloadSlot");
+
+// vcBuildUnifiedPrompt's default system directives.
+static constexpr const char *kPayloadSystemDirectives[] = {
+    "You must produce safe-for-work, non-violent, non-hateful content only.",
+    "All outputs must be visually coherent, high-quality, and respectful."};
+
+static constexpr const char *payloadModeId(VCIGMode m) {
+    return m == VCIGMode::TextToImage ? "image-generate" : "image-edit";
+}
+
+// Layout names of vcBuildQualityConfig.
+static constexpr const char *payloadLayout(VCAspectRatio r) {
+    switch (r) {
+        case VCAspectRatio::Ratio_1_1:  return "square";
+        case VCAspectRatio::Ratio_16_9: return "landscape";
+        case VCAspectRatio::Ratio_9_16: return "story";
+        case VCAspectRatio::Ratio_4_3:  return "landscape";
+        case VCAspectRatio::Ratio_3_4:  return "portrait";
+        case VCAspectRatio::Ratio_21_9: return "cinematic";
+    }
+    return "square";
+}
+
+// Per-request values that are not part of the plan.
+struct VCPayloadOptions {
+    std::string_view model;           // empty: the platform's default model
+    std::string_view requestId;
+    std::string_view sourceImageUrl;  // image to edit; empty for none
+    std::string_view apiKey;          // Gemini only, goes in the endpoint URL
+    uint64_t seed = 0;
+};
+
+class VCPayloadTemplate {
+public:
+    // `skeleton` is the payload text with {{slot}} placeholders standing
+    // for whole JSON values (strings come out quoted). Throws
+    // std::invalid_argument on an unknown or unterminated placeholder.
+    VCPayloadTemplate(std::string_view skeleton, std::string_view defaultModel)
+        : defaultModel_(defaultModel) {
+        std::size_t pos = 0;
+        for (;;) {
+            const std::size_t open = skeleton.find("{{", pos);
+            const std::size_t litEnd = open == std::string_view::npos ? skeleton.size() : open;
+            Segment seg;
+            seg.litBegin = static_cast<uint32_t>(literals_.size());
+            literals_.append(skeleton.data() + pos, litEnd - pos);
+            seg.litLen = static_cast<uint32_t>(litEnd - pos);
+            if (open == std::string_view::npos) {
+                tail_ = seg;
+                break;
+            }
+            const std::size_t close = skeleton.find("}}", open + 2);
+            if (close == std::string_view::npos)
+                throw std::invalid_argument("payload template: unterminated {{ placeholder");
+            seg.slot = slotByName(skeleton.substr(open + 2, close - open - 2));
+            segments_.push_back(seg);
+            pos = close + 2;
+        }
+    }
+
+    // Appends the payload for `plan` to `out`.
+    template <class Plan>
+    void render(const Plan &plan, const VCPayloadOptions &opt, std::string &out) const {
+        const VCQualityLimits limits = qualityLimitsFor(plan.quality, plan.aspectRatio);
+        out.reserve(out.size() + literals_.size() + 2 * plan.corePrompt.size() + 256);
+        for (const Segment &seg : segments_) {
+            out.append(literals_.data() + seg.litBegin, seg.litLen);
+            writeSlot(seg.slot, plan, limits, opt, out);
+        }
+        out.append(literals_.data() + tail_.litBegin, tail_.litLen);
+    }
+
+    std::size_t slotCount() const { return segments_.size(); }
+
+private:
+    struct Segment {
+        uint32_t litBegin = 0;  // literal run before the slot
+        uint32_t litLen = 0;
+        VCPayloadSlot slot = VCPayloadSlot::Prompt;
+    };
+
+    std::string literals_;
+    std::vector<Segment> segments_;
+    Segment tail_;
+    std::string defaultModel_;
+
+    static VCPayloadSlot slotByName(std::string_view name) {
+        for (std::size_t i = 0; i < sizeof(kPayloadSlotNames) / sizeof(kPayloadSlotNames[0]); ++i)
+            if (name == kPayloadSlotNames[i])
+                return static_cast<VCPayloadSlot>(i);
+        throw std::invalid_argument("payload template: unknown slot {{" + std::string(name) + "}}");
+    }
+
+    static void appendUnsigned(uint64_t v, std::string &out) {
+        char buf[24];
+        const auto r = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, static_cast<std::size_t>(r.ptr - buf));
+    }
+
+    static void appendQuoted(const char *s, std::string &out) {
+        out.push_back('"');
+        out.append(s);
+        out.push_back('"');
+    }
+
+    template <class Plan>
+    void writeSlot(VCPayloadSlot slot, const Plan &p, const VCQualityLimits &l,
+                   const VCPayloadOptions &opt, std::string &out) const {
+        auto text = [&out](std::string_view s) {
+            VCJsonWriter w(out, s.size() + 2 + 16);
+            w.string(s);
+            w.finish();
+        };
+        // JSON array of the non-empty entries.
+        auto list = [&](std::initializer_list<std::string_view> items) {
+            out.push_back('[');
+            bool first = true;
+            for (std::string_view s : items) {
+                if (s.empty()) continue;
+                if (!first) out.push_back(',');
+                first = false;
+                text(s);
+            }
+            out.push_back(']');
+        };
+        switch (slot) {
+            case VCPayloadSlot::Prompt:      text(p.corePrompt); break;
+            case VCPayloadSlot::NegativePrompt: {
+                std::string_view a = p.negatives.visualArtifacts;
+                std::string_view b = p.negatives.contentExclusions;
+                if (a.empty() || b.empty()) {
+                    text(a.empty() ? b : a);
+                } else {
+                    thread_local std::string joined;
+                    joined.assign(a.data(), a.size());
+                    joined.append(", ");
+                    joined.append(b.data(), b.size());
+                    text(joined);
+                }
+                break;
+            }
+            case VCPayloadSlot::Subject:     text(p.primarySubject.name); break;
+            case VCPayloadSlot::Environment: text(p.background.environment); break;
+            case VCPayloadSlot::TimeOfDay:   text(p.background.timeOfDay); break;
+            case VCPayloadSlot::Weather:     text(p.background.weather); break;
+            case VCPayloadSlot::PaletteHint: text(p.colorLighting.paletteHint); break;
+            case VCPayloadSlot::EraHint:     text(p.artStyle.eraHint); break;
+            case VCPayloadSlot::ArtStyle:    appendQuoted(toString(p.artStyle.style), out); break;
+            case VCPayloadSlot::ColorTone:   appendQuoted(toString(p.colorLighting.colorTone), out); break;
+            case VCPayloadSlot::Lighting:    appendQuoted(toString(p.colorLighting.lighting), out); break;
+            case VCPayloadSlot::CameraAngle: appendQuoted(toString(p.camera.angle), out); break;
+            case VCPayloadSlot::Composition: appendQuoted(toString(p.composition.rule), out); break;
+            case VCPayloadSlot::AspectRatio: appendQuoted(toString(p.aspectRatio), out); break;
+            case VCPayloadSlot::Mode:        appendQuoted(payloadModeId(p.mode), out); break;
+            case VCPayloadSlot::Quality:     appendQuoted(toString(l.preset), out); break;
+            case VCPayloadSlot::Safety:      appendQuoted(toString(p.safety), out); break;
+            case VCPayloadSlot::BlockNSFW:
+                out.append(p.safety == VCSafetyProfile::Safe ? "true" : "false");
+                break;
+            case VCPayloadSlot::Width:       appendUnsigned(l.maxWidth, out); break;
+            case VCPayloadSlot::Height:      appendUnsigned(l.maxHeight, out); break;
+            case VCPayloadSlot::Size:
+                out.push_back('"');
+                appendUnsigned(l.maxWidth, out);
+                out.push_back('x');
+                appendUnsigned(l.maxHeight, out);
+                out.push_back('"');
+                break;
+            case VCPayloadSlot::Steps:       appendUnsigned(l.maxSteps, out); break;
+            case VCPayloadSlot::Guidance: {
+                // Presets use tenths; printed the way JSON.stringify does
+                // ("7.5", "8"), not as "%f" text.
+                const unsigned tenths = static_cast<unsigned>(l.guidance * 10.0f + 0.5f);
+                appendUnsigned(tenths / 10, out);
+                if (tenths % 10 != 0) {
+                    out.push_back('.');
+                    out.push_back(static_cast<char>('0' + tenths % 10));
+                }
+                break;
+            }
+            case VCPayloadSlot::Seed:        appendUnsigned(opt.seed, out); break;
+            case VCPayloadSlot::Model:
+                text(opt.model.empty() ? std::string_view(defaultModel_) : opt.model);
+                break;
+            case VCPayloadSlot::RequestId:   text(opt.requestId); break;
+            case VCPayloadSlot::ControlJson: appendScenePlanJSON(p, out); break;
+            case VCPayloadSlot::SystemDirectives:
+                list({kPayloadSystemDirectives[0], kPayloadSystemDirectives[1]});
+                break;
+            case VCPayloadSlot::StyleHints:
+                list({toString(p.artStyle.style), toString(p.colorLighting.colorTone),
+                      toString(p.colorLighting.lighting), p.colorLighting.paletteHint});
+                break;
+            case VCPayloadSlot::NegativePrompts:
+                list({p.negatives.visualArtifacts, p.negatives.contentExclusions});
+                break;
+            case VCPayloadSlot::Layout:      appendQuoted(payloadLayout(p.aspectRatio), out); break;
+            case VCPayloadSlot::SourceImageUrl:
+                if (opt.sourceImageUrl.empty())
+                    out.append("null");
+                else
+                    text(opt.sourceImageUrl);
+                break;
+            case VCPayloadSlot::Messages:
+                // vcBuildOpenAIStyleMessages: one system message per
+                // directive, then the user text and the image to look at.
+                out.push_back('[');
+                for (const char *d : kPayloadSystemDirectives) {
+                    out.append("{\"role\":\"system\",\"content\":");
+                    text(d);
+                    out.append("},");
+                }
+                out.append("{\"role\":\"user\",\"content\":[");
+                if (!std::string_view(p.corePrompt).empty()) {
+                    out.append("{\"type\":\"text\",\"text\":");
+                    text(p.corePrompt);
+                    out.push_back('}');
+                }
+                if (!opt.sourceImageUrl.empty()) {
+                    if (!std::string_view(p.corePrompt).empty())
+                        out.push_back(',');
+                    out.append("{\"type\":\"image_url\",\"image_url\":{\"url\":");
+                    text(opt.sourceImageUrl);
+                    out.append(",\"detail\":\"high\"}}");
+                }
+                out.append("]}]");
+                break;
+        }
+    }
+};
+
+// vcBuildGenericImagePayload.
+static constexpr const char kGenericImagePayloadSkeleton[] =
+    "{\"prompt\":{{prompt}},\"system_directives\":{{system_directives}},"
+    "\"style_hints\":{{style_hints}},\"negative_prompts\":{{negative_prompts}},"
+    "\"width\":{{width}},\"height\":{{height}},\"steps\":{{steps}},"
+    "\"guidance\":{{guidance}},\"seed\":{{seed}},\"format\":\"png\","
+    "\"ratio\":{{aspect_ratio}},\"layout\":{{layout}},\"safety\":{\"profile\":{{safety}},"
+    "\"block_nsfw\":{{block_nsfw}},\"block_graphic_violence\":true,\"block_hate\":true,"
+    "\"block_harassment\":true,\"block_self_harm\":true},"
+    "\"source_image_url\":{{source_image_url}},\"mode\":{{mode}},\"extra\":{}}";
+
+// vcCallVLIG's OpenAI-compatible chat payload (Copilot/Grok image-edit).
+static constexpr const char kChatPayloadSkeleton[] =
+    "{\"model\":{{model}},\"messages\":{{messages}},\"temperature\":0.4,"
+    "\"max_tokens\":512,\"seed\":{{seed}},"
+    "\"metadata\":{\"visual_code_request_id\":{{request_id}}}}";
+
+// vcCallVLIG's generic-json payload (custom-http).
+static constexpr const char kGenericJsonPayloadSkeleton[] =
+    "{\"request_id\":{{request_id}},\"mode\":{{mode}},\"text\":{{prompt}},"
+    "\"system_directives\":{{system_directives}},\"style_hints\":{{style_hints}},"
+    "\"negative_prompts\":{{negative_prompts}},"
+    "\"quality\":{\"preset\":{{quality}},\"steps\":{{steps}},\"guidance\":{{guidance}},"
+    "\"seed\":{{seed}},\"width\":{{width}},\"height\":{{height}},"
+    "\"ratio\":{{aspect_ratio}},\"format\":\"png\",\"layout\":{{layout}}},"
+    "\"safety\":{\"profile\":{{safety}},\"blockNSFW\":{{block_nsfw}},"
+    "\"blockGraphicViolence\":true,\"blockHate\":true,\"blockHarassment\":true,"
+    "\"blockSelfHarm\":true},\"input_image_url\":{{source_image_url}},\"extra\":{}}";
+
+// Default skeleton for `platform` and `mode`. Models are those of the JS
+// platform registry: the vision model for chat payloads, the image model in
+// the Gemini URL.
+static const VCPayloadTemplate &platformPayloadTemplate(VCPlatform platform, VCIGMode mode) {
+    static const VCPayloadTemplate generic(kGenericImagePayloadSkeleton, "");
+    static const VCPayloadTemplate copilotChat(kChatPayloadSkeleton, "gpt-4.1-mini");
+    static const VCPayloadTemplate grokChat(kChatPayloadSkeleton, "grok-2-vision-latest");
+    static const VCPayloadTemplate genericJson(kGenericJsonPayloadSkeleton, "");
+    const bool generate = mode == VCIGMode::TextToImage;
+    switch (platform) {
+        case VCPlatform::Gemini:     return generic;
+        case VCPlatform::Copilot:    return generate ? generic : copilotChat;
+        case VCPlatform::Vondy:      return generic;
+        case VCPlatform::Grok:       return generate ? generic : grokChat;
+        case VCPlatform::CustomHTTP: return genericJson;
+    }
+    return genericJson;
+}
+
+// Appends the URL vcCallVLIG posts `platform`'s payload to. Gemini goes to
+// the image model's :generateContent with the API key in the query; the
+// other platforms use their registry endpoint and take the key as a bearer
+// header, which is the transport's job.
+static void appendPlatformEndpoint(VCPlatform platform, const VCPayloadOptions &opt,
+                                   std::string &out) {
+    // encodeURIComponent
+    auto component = [&out](std::string_view s) {
+        static constexpr char kHex[] = "0123456789ABCDEF";
+        for (char ch : s) {
+            const unsigned char c = static_cast<unsigned char>(ch);
+            if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                (c != 0 && std::strchr("-_.!~*'()", c) != nullptr)) {
+                out.push_back(ch);
+            } else {
+                out.push_back('%');
+                out.push_back(kHex[c >> 4]);
+                out.push_back(kHex[c & 15]);
+            }
+        }
+    };
+    switch (platform) {
+        case VCPlatform::Gemini:
+            out.append("https://generativelanguage.googleapis.com/v1beta/models/");
+            component(opt.model.empty() ? std::string_view("imagen-3.0-generate-001") : opt.model);
+            out.append(":generateContent?key=");
+            component(opt.apiKey);
+            return;
+        case VCPlatform::Copilot:
+            out.append("https://api.githubcopilot.com/v1/openai/chat/completions");
+            return;
+        case VCPlatform::Vondy:
+            out.append("https://api.vondy.com/v1/image/generate");
+            return;
+        case VCPlatform::Grok:
+            out.append("https://api.x.ai/v1/chat/completions");
+            return;
+        case VCPlatform::CustomHTTP:
+            out.append("https://your.custom.vl-ig-endpoint/v1/infer");
+            return;
+    }
+}
+
+// Appends `platform`'s request body for `plan` to `out`.
+template <class Plan>
+static void renderPlatformPayload(VCPlatform platform, const Plan &plan,
+                                  const VCPayloadOptions &opt, std::string &out) {
+    platformPayloadTemplate(platform, plan.mode).render(plan, opt, out);
+}
+
+} // namespace vc_vlig
+
+#ifdef VC_VLIG_PLATFORM_PAYLOADS_DEMO
+#include <chrono>
+
+// Golden requests captured from vcCallVLIG (unified_vl_ig_router.js) with a
+// stub fetch, Math.random fixed at 0.5 (seed 550000000) and Date.now at
+// 1700000000000, fed the prompt, ratio (9:16), style hints and negatives of
+// the plans below, plus an input image URL for image-edit.
+static const char kGoldenGenericGenerate[] =
+    R"({"prompt":"Ultra-detailed cinematic portrait of a lone astronaut standing in a foggy forest at sunset, teal and orange color grade, soft lighting, shot on a 50mm lens, \"hero\" shot, 16:9.","system_directives":["You must produce safe-for-work, non-violent, non-hateful content only.","All outputs must be visually coherent, high-quality, and respectful."],"style_hints":["unspecified","warm","soft"],"negative_prompts":["blurry, extra limbs, distorted faces, text artifacts","no gore, no real-world logos"],"width":720,"height":1280,"steps":28,"guidance":7.5,"seed":550000000,"format":"png","ratio":"9:16","layout":"story","safety":{"profile":"safe","block_nsfw":true,"block_graphic_violence":true,"block_hate":true,"block_harassment":true,"block_self_harm":true},"source_image_url":null,"mode":"image-generate","extra":{}})";
+static const char kGoldenGenericEdit[] =
+    R"({"prompt":"Ultra-detailed cinematic portrait of a lone astronaut standing in a foggy forest at sunset, teal and orange color grade, soft lighting, shot on a 50mm lens, \"hero\" shot, 16:9.","system_directives":["You must produce safe-for-work, non-violent, non-hateful content only.","All outputs must be visually coherent, high-quality, and respectful."],"style_hints":["unspecified","warm","soft","#1c8084, #f48024, #14245a"],"negative_prompts":["blurry, extra limbs, distorted faces, text artifacts","no gore, no real-world logos"],"width":720,"height":1280,"steps":28,"guidance":7.5,"seed":550000000,"format":"png","ratio":"9:16","layout":"story","safety":{"profile":"safe","block_nsfw":true,"block_graphic_violence":true,"block_hate":true,"block_harassment":true,"block_self_harm":true},"source_image_url":"https://cdn.example.com/in/ref 1.png","mode":"image-edit","extra":{}})";
+static const char kGoldenCopilotChat[] =
+    R"({"model":"gpt-4.1-mini","messages":[{"role":"system","content":"You must produce safe-for-work, non-violent, non-hateful content only."},{"role":"system","content":"All outputs must be visually coherent, high-quality, and respectful."},{"role":"user","content":[{"type":"text","text":"Ultra-detailed cinematic portrait of a lone astronaut standing in a foggy forest at sunset, teal and orange color grade, soft lighting, shot on a 50mm lens, \"hero\" shot, 16:9."},{"type":"image_url","image_url":{"url":"https://cdn.example.com/in/ref 1.png","detail":"high"}}]}],"temperature":0.4,"max_tokens":512,"seed":550000000,"metadata":{"visual_code_request_id":"VCREQ-18bcfe56800-7fffffff"}})";
+static const char kGoldenGrokChat[] =
+    R"({"model":"grok-2-vision-latest","messages":[{"role":"system","content":"You must produce safe-for-work, non-violent, non-hateful content only."},{"role":"system","content":"All outputs must be visually coherent, high-quality, and respectful."},{"role":"user","content":[{"type":"text","text":"Ultra-detailed cinematic portrait of a lone astronaut standing in a foggy forest at sunset, teal and orange color grade, soft lighting, shot on a 50mm lens, \"hero\" shot, 16:9."},{"type":"image_url","image_url":{"url":"https://cdn.example.com/in/ref 1.png","detail":"high"}}]}],"temperature":0.4,"max_tokens":512,"seed":550000000,"metadata":{"visual_code_request_id":"VCREQ-18bcfe56800-7fffffff"}})";
+static const char kGoldenCustomGenerate[] =
+    R"({"request_id":"VCREQ-18bcfe56800-7fffffff","mode":"image-generate","text":"Ultra-detailed cinematic portrait of a lone astronaut standing in a foggy forest at sunset, teal and orange color grade, soft lighting, shot on a 50mm lens, \"hero\" shot, 16:9.","system_directives":["You must produce safe-for-work, non-violent, non-hateful content only.","All outputs must be visually coherent, high-quality, and respectful."],"style_hints":["unspecified","warm","soft"],"negative_prompts":["blurry, extra limbs, distorted faces, text artifacts","no gore, no real-world logos"],"quality":{"preset":"high","steps":28,"guidance":7.5,"seed":550000000,"width":720,"height":1280,"ratio":"9:16","format":"png","layout":"story"},"safety":{"profile":"safe","blockNSFW":true,"blockGraphicViolence":true,"blockHate":true,"blockHarassment":true,"blockSelfHarm":true},"input_image_url":null,"extra":{}})";
+static const char kGoldenCustomEdit[] =
+    R"({"request_id":"VCREQ-18bcfe56800-7fffffff","mode":"image-edit","text":"Ultra-detailed cinematic portrait of a lone astronaut standing in a foggy forest at sunset, teal and orange color grade, soft lighting, shot on a 50mm lens, \"hero\" shot, 16:9.","system_directives":["You must produce safe-for-work, non-violent, non-hateful content only.","All outputs must be visually coherent, high-quality, and respectful."],"style_hints":["unspecified","warm","soft","#1c8084, #f48024, #14245a"],"negative_prompts":["blurry, extra limbs, distorted faces, text artifacts","no gore, no real-world logos"],"quality":{"preset":"high","steps":28,"guidance":7.5,"seed":550000000,"width":720,"height":1280,"ratio":"9:16","format":"png","layout":"story"},"safety":{"profile":"safe","blockNSFW":true,"blockGraphicViolence":true,"blockHate":true,"blockHarassment":true,"blockSelfHarm":true},"input_image_url":"https://cdn.example.com/in/ref 1.png","extra":{}})";
+
+int main() {
+    using namespace vc_vlig;
+    const std::string prompt =
+        "Ultra-detailed cinematic portrait of a lone astronaut standing in a foggy forest at "
+        "sunset, teal and orange color grade, soft lighting, shot on a 50mm lens, \"hero\" shot, 16:9.";
+    const VCSemanticIGResult generate = BuildSemanticIGSpec(
+        prompt, VCIGMode::TextToImage, VCSafetyProfile::Safe, VCQualityPreset::High);
+    const VCSemanticIGResult edit =
+        BuildSemanticIGSpec(prompt, VCIGMode::ImageToImage, VCSafetyProfile::Safe,
+                            VCQualityPreset::High, "#1c8084, #f48024, #14245a");
+    VCPayloadOptions opt;
+    opt.seed = 550000000;
+    opt.requestId = "VCREQ-18bcfe56800-7fffffff";
+    opt.apiKey = "test-key/1";
+
+    struct Golden {
+        VCPlatform platform;
+        bool edit;
+        const char *url;
+        const char *body;
+    };
+    const Golden golden[] = {
+        {VCPlatform::Gemini, false,
+         "https://generativelanguage.googleapis.com/v1beta/models/imagen-3.0-generate-001:generateContent?key=test-key%2F1",
+         kGoldenGenericGenerate},
+        {VCPlatform::Gemini, true,
+         "https://generativelanguage.googleapis.com/v1beta/models/imagen-3.0-generate-001:generateContent?key=test-key%2F1",
+         kGoldenGenericEdit},
+        {VCPlatform::Copilot, false,
+         "https://api.githubcopilot.com/v1/openai/chat/completions",
+         kGoldenGenericGenerate},
+        {VCPlatform::Copilot, true,
+         "https://api.githubcopilot.com/v1/openai/chat/completions",
+         kGoldenCopilotChat},
+        {VCPlatform::Vondy, false,
+         "https://api.vondy.com/v1/image/generate",
+         kGoldenGenericGenerate},
+        {VCPlatform::Vondy, true,
+         "https://api.vondy.com/v1/image/generate",
+         kGoldenGenericEdit},
+        {VCPlatform::Grok, false,
+         "https://api.x.ai/v1/chat/completions",
+         kGoldenGenericGenerate},
+        {VCPlatform::Grok, true,
+         "https://api.x.ai/v1/chat/completions",
+         kGoldenGrokChat},
+        {VCPlatform::CustomHTTP, false,
+         "https://your.custom.vl-ig-endpoint/v1/infer",
+         kGoldenCustomGenerate},
+        {VCPlatform::CustomHTTP, true,
+         "https://your.custom.vl-ig-endpoint/v1/infer",
+         kGoldenCustomEdit},
+    };
+    bool ok = true;
+    std::string url, body;
+    for (const Golden &g : golden) {
+        opt.sourceImageUrl = g.edit ? "https://cdn.example.com/in/ref 1.png" : "";
+        url.clear();
+        body.clear();
+        appendPlatformEndpoint(g.platform, opt, url);
+        renderPlatformPayload(g.platform, (g.edit ? edit : generate).scene, opt, body);
+        const bool same = url == g.url && body == g.body;
+        ok = ok && same;
+        std::cout << toString(g.platform) << (g.edit ? " image-edit: " : " image-generate: ")
+                  << body.size() << " bytes, " << (same ? "matches JS" : "DIFFERS") << "\n";
+        if (!same)
+            std::cout << "  got      " << url << "\n  " << body << "\n  expected " << g.url
+                      << "\n  " << g.body << "\n";
+    }
+
+    const VCPlatform platforms[] = {VCPlatform::Gemini, VCPlatform::Copilot, VCPlatform::Vondy,
+                                    VCPlatform::Grok, VCPlatform::CustomHTTP};
+    opt.sourceImageUrl = "";
+    const int iters = 200000;
+    std::size_t sink = 0;
+    for (VCPlatform pf : platforms) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iters; ++i) {
+            body.clear();
+            opt.seed = static_cast<uint64_t>(i);
+            renderPlatformPayload(pf, generate.scene, opt, body);
+            sink += body.size();
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        const double sec = std::chrono::duration<double>(t1 - t0).count();
+        std::cout << toString(pf) << ": " << iters / sec / 1e6 << " M renders/s ("
+                  << sec / iters * 1e9 << " ns, "
+                  << platformPayloadTemplate(pf, VCIGMode::TextToImage).slotCount()
+                  << " slots)\n";
+    }
+    std::cout << "(" << sink % 10 << ")\n";
+    return ok ? 0 : 1;
+}
+#endif
+
+#endif // VC_VLIG_PLATFORM_PAYLOADS_CPP
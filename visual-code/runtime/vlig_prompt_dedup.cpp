@@ -0,0 +1,545 @@
+// File: /visual-code/runtime/vlig_prompt_dedup.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS NDK; AVX2 / SSE2 / NEON / scalar
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Near-duplicate detection for prompt logs and dataset prompt.clean_text
+//   fields. It streams millions of prompts and flags each one that is a
+//   near copy of a prompt already seen, so duplicates stop skewing training
+//   sets and wasting generation capacity.
+//
+//   1) Canonical text. The router's cleaning pass (cleanPromptText) folds
+//      typographic punctuation, Unicode spaces and control characters. Then
+//      ASCII is lowercased and every run of non-alphanumerics becomes one
+//      space, so casing, punctuation and spacing edits do not count.
+//   2) Shingles. Character k-grams (default 5) of the canonical text, each
+//      hashed to 32 bits; texts shorter than k are one shingle.
+//   3) MinHash. K (default 128) hash functions h_i(x) = fmix32(x ^ seed_i).
+//      The signature is the minimum of each over the shingles. The loop
+//      keeps a block of lanes in one register and streams the shingle
+//      hashes through it (AVX2: 8 lanes, SSE2 / NEON: 4).
+//   4) Banded LSH. The signature splits into b bands of r rows, and two
+//      prompts become candidates if any band matches exactly: probability
+//      1 - (1 - s^r)^b at Jaccard s. With the default 16 x 8 that is ~95% at
+//      s = 0.8, ~61% at 0.7 and ~6% at 0.5. Edited copies of a prompt
+//      mostly sit above 0.8 while prompts that only share a template sit
+//      near 0.3-0.5. Candidates are confirmed against stored 1-byte-per-hash
+//      (b-bit) signatures, with the estimator corrected for chance byte
+//      matches.
+//
+//   Memory per indexed prompt: K bytes of b-bit signature plus 16 bytes per
+//   band entry, with bucket heads on top (~400-750 bytes with the
+//   defaults). Each band table is flat arrays with chained buckets, with
+//   no per-entry allocations. Single writer: callers that shard the stream
+//   run one index per shard.
+
+#ifndef VC_VLIG_PROMPT_DEDUP_CPP
+#define VC_VLIG_PROMPT_DEDUP_CPP
+
+#include "vlig_semantic_guided_router.cpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VC_VLIG_AVX2 1
+#endif
+
+namespace vc_vlig {
+
+struct VCMinHashConfig {
+    std::size_t numHashes = 128;  // K; multiple of 8
+    std::size_t shingleSize = 5;  // characters per shingle
+    uint32_t seed = 0x3C6EF372u;
+};
+
+static inline uint32_t fmix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+#if defined(VC_VLIG_SSE2) && !defined(VC_VLIG_AVX2)
+// SSE2 has neither a 32-bit low multiply nor an unsigned 32-bit min.
+static inline __m128i mullo32SSE2(__m128i a, __m128i b) {
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i fmix32SSE2(__m128i h) {
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+    h = mullo32SSE2(h, _mm_set1_epi32(static_cast<int>(0x85EBCA6Bu)));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 13));
+    h = mullo32SSE2(h, _mm_set1_epi32(static_cast<int>(0xC2B2AE35u)));
+    return _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+}
+#endif
+
+#if defined(VC_VLIG_SSE2)
+static inline unsigned popcount32(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_popcount(x));
+#else
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (x * 0x01010101u) >> 24;
+#endif
+}
+#endif
+
+class VCMinHasher {
+public:
+    explicit VCMinHasher(const VCMinHashConfig &config = {}) : config_(config) {
+        if (config_.numHashes == 0 || config_.numHashes % 8 != 0)
+            throw std::invalid_argument("MinHash: numHashes must be a positive multiple of 8");
+        if (config_.shingleSize == 0)
+            throw std::invalid_argument("MinHash: shingleSize must be positive");
+        seeds_.resize(config_.numHashes);
+        for (std::size_t i = 0; i < seeds_.size(); ++i)
+            seeds_[i] = fmix32(config_.seed + static_cast<uint32_t>(i) * 0x9E3779B9u);
+    }
+
+    std::size_t numHashes() const { return config_.numHashes; }
+
+    // Signature of a raw prompt; `sig` holds numHashes() values. Throws like
+    // cleanPromptText on an empty prompt.
+    void signature(const std::string &prompt, uint32_t *sig) const {
+        thread_local VCPromptBuffers buffers;
+        cleanPromptText(prompt, buffers);
+        signatureOfCleaned(buffers.text, sig);
+    }
+
+    // Signature of text that has already been through cleanPromptText
+    // (e.g. dataset clean_text fields).
+    void signatureOfCleaned(std::string_view text, uint32_t *sig) const {
+        thread_local std::string canon;
+        thread_local std::vector<uint32_t> shingles;
+        canonicalize(text, canon);
+        shingles.clear();
+        const std::size_t k = config_.shingleSize;
+        if (canon.size() <= k) {
+            shingles.push_back(hashShingle(canon.data(), canon.size()));
+        } else {
+            for (std::size_t i = 0; i + k <= canon.size(); ++i)
+                shingles.push_back(hashShingle(canon.data() + i, k));
+        }
+        minHash(shingles.data(), shingles.size(), sig);
+    }
+
+private:
+    VCMinHashConfig config_;
+    std::vector<uint32_t> seeds_;
+
+    static void canonicalize(std::string_view text, std::string &out) {
+        out.clear();
+        bool space = true;  // drop leading separators
+        for (char c : text) {
+            const unsigned char u = static_cast<unsigned char>(c);
+            if (u >= 0x80 || (u >= '0' && u <= '9') || (u >= 'a' && u <= 'z')) {
+                out.push_back(c);
+                space = false;
+            } else if (u >= 'A' && u <= 'Z') {
+                out.push_back(static_cast<char>(u + 32));
+                space = false;
+            } else if (!space) {
+                out.push_back(' ');
+                space = true;
+            }
+        }
+        if (!out.empty() && out.back() == ' ')
+            out.pop_back();
+    }
+
+    uint32_t hashShingle(const char *s, std::size_t n) const {
+        uint64_t h = 0xCBF29CE484222325ull ^ config_.seed;
+        for (std::size_t i = 0; i < n; ++i) {
+            h ^= static_cast<unsigned char>(s[i]);
+            h *= 0x100000001B3ull;
+        }
+        return fmix32(static_cast<uint32_t>(h ^ (h >> 32)));
+    }
+
+    // Lane blocks outermost: each block's running minimum stays in a
+    // register while every shingle hash streams through it.
+    void minHash(const uint32_t *x, std::size_t n, uint32_t *sig) const {
+        const std::size_t K = config_.numHashes;
+        std::size_t i = 0;
+#if defined(VC_VLIG_AVX2)
+        for (; i + 8 <= K; i += 8) {
+            const __m256i seed = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&seeds_[i]));
+            const __m256i c1 = _mm256_set1_epi32(static_cast<int>(0x85EBCA6Bu));
+            const __m256i c2 = _mm256_set1_epi32(static_cast<int>(0xC2B2AE35u));
+            __m256i best = _mm256_set1_epi32(-1);
+            for (std::size_t s = 0; s < n; ++s) {
+                __m256i h = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int>(x[s])), seed);
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+                h = _mm256_mullo_epi32(h, c1);
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+                h = _mm256_mullo_epi32(h, c2);
+                h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+                best = _mm256_min_epu32(best, h);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(sig + i), best);
+        }
+#elif defined(VC_VLIG_SSE2)
+        // Unsigned min via the signed compare: values are kept with the
+        // sign bit flipped and flipped back on store.
+        const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+        for (; i + 4 <= K; i += 4) {
+            const __m128i seed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&seeds_[i]));
+            __m128i best = _mm_set1_epi32(0x7FFFFFFF);  // UINT32_MAX, biased
+            for (std::size_t s = 0; s < n; ++s) {
+                const __m128i h = _mm_xor_si128(
+                    fmix32SSE2(_mm_xor_si128(_mm_set1_epi32(static_cast<int>(x[s])), seed)), bias);
+                const __m128i lt = _mm_cmplt_epi32(h, best);
+                best = _mm_or_si128(_mm_and_si128(lt, h), _mm_andnot_si128(lt, best));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(sig + i), _mm_xor_si128(best, bias));
+        }
+#elif defined(VC_VLIG_NEON)
+        for (; i + 4 <= K; i += 4) {
+            const uint32x4_t seed = vld1q_u32(&seeds_[i]);
+            const uint32x4_t c1 = vdupq_n_u32(0x85EBCA6Bu);
+            const uint32x4_t c2 = vdupq_n_u32(0xC2B2AE35u);
+            uint32x4_t best = vdupq_n_u32(0xFFFFFFFFu);
+            for (std::size_t s = 0; s < n; ++s) {
+                uint32x4_t h = veorq_u32(vdupq_n_u32(x[s]), seed);
+                h = veorq_u32(h, vshrq_n_u32(h, 16));
+                h = vmulq_u32(h, c1);
+                h = veorq_u32(h, vshrq_n_u32(h, 13));
+                h = vmulq_u32(h, c2);
+                h = veorq_u32(h, vshrq_n_u32(h, 16));
+                best = vminq_u32(best, h);
+            }
+            vst1q_u32(sig + i, best);
+        }
+#endif
+        for (; i < K; ++i) {
+            uint32_t best = 0xFFFFFFFFu;
+            for (std::size_t s = 0; s < n; ++s)
+                best = std::min(best, fmix32(x[s] ^ seeds_[i]));
+            sig[i] = best;
+        }
+    }
+};
+
+struct VCNearDuplicate {
+    bool found = false;
+    uint32_t id = 0;          // earliest-inserted best match
+    float similarity = 0.0f;  // estimated Jaccard of the shingle sets
+};
+
+class VCPromptLSHIndex {
+public:
+    // bands * rows must equal the hasher's numHashes(); `threshold` is the
+    // estimated Jaccard a candidate needs to count as a near duplicate.
+    VCPromptLSHIndex(std::size_t bands = 16, std::size_t rows = 8, float threshold = 0.7f)
+        : bands_(bands), rows_(rows), threshold_(threshold), tables_(bands) {
+        if (bands == 0 || rows == 0)
+            throw std::invalid_argument("LSH index: bands and rows must be positive");
+        for (Table &t : tables_)
+            t.heads.assign(1024, kNil);
+    }
+
+    std::size_t numHashes() const { return bands_ * rows_; }
+    std::size_t size() const { return sigs_.size() / numHashes(); }
+
+    std::size_t memoryBytes() const {
+        std::size_t b = sigs_.capacity();
+        for (const Table &t : tables_)
+            b += t.heads.capacity() * sizeof(uint32_t) + t.entries.capacity() * sizeof(Entry);
+        return b;
+    }
+
+    // Best indexed match for `sig` at or above the threshold.
+    VCNearDuplicate find(const uint32_t *sig) const {
+        VCNearDuplicate best;
+        thread_local std::vector<uint32_t> seen;
+        seen.clear();
+        uint8_t packed[kMaxHashes];
+        pack(sig, packed);
+        for (std::size_t b = 0; b < bands_; ++b) {
+            const uint64_t key = bandKey(sig, b);
+            const Table &t = tables_[b];
+            const uint32_t fp = static_cast<uint32_t>(key >> 32);
+            for (uint32_t e = t.heads[key & (t.heads.size() - 1)]; e != kNil; e = t.entries[e].next) {
+                if (t.entries[e].key != fp) continue;
+                const uint32_t id = t.entries[e].id;
+                if (std::find(seen.begin(), seen.end(), id) != seen.end()) continue;
+                seen.push_back(id);
+                const float sim = estimate(packed, &sigs_[std::size_t(id) * numHashes()]);
+                if (sim >= threshold_ &&
+                    (!best.found || sim > best.similarity || (sim == best.similarity && id < best.id))) {
+                    best.found = true;
+                    best.id = id;
+                    best.similarity = sim;
+                }
+            }
+        }
+        return best;
+    }
+
+    // Adds `sig` and returns its id (insertion order, from 0).
+    uint32_t insert(const uint32_t *sig) {
+        const std::size_t K = numHashes();
+        if (size() >= 0xFFFFFFFEu)
+            throw std::length_error("LSH index full");
+        const uint32_t id = static_cast<uint32_t>(size());
+        sigs_.resize(sigs_.size() + K);
+        pack(sig, &sigs_[std::size_t(id) * K]);
+        for (std::size_t b = 0; b < bands_; ++b) {
+            Table &t = tables_[b];
+            if (t.entries.size() >= t.heads.size())
+                rehash(t, t.heads.size() * 2);
+            const uint64_t key = bandKey(sig, b);
+            const std::size_t slot = key & (t.heads.size() - 1);
+            t.entries.push_back(Entry{static_cast<uint32_t>(key >> 32), id, t.heads[slot],
+                                      static_cast<uint32_t>(key)});
+            t.heads[slot] = static_cast<uint32_t>(t.entries.size() - 1);
+        }
+        return id;
+    }
+
+private:
+    static constexpr uint32_t kNil = 0xFFFFFFFFu;
+    static constexpr std::size_t kMaxHashes = 1024;
+
+    struct Entry {
+        uint32_t key;   // high half of the band hash
+        uint32_t id;
+        uint32_t next;
+        uint32_t low;   // low half, for rehashing
+    };
+    struct Table {
+        std::vector<uint32_t> heads;
+        std::vector<Entry> entries;
+    };
+
+    std::size_t bands_;
+    std::size_t rows_;
+    float threshold_;
+    std::vector<Table> tables_;
+    std::vector<uint8_t> sigs_;  // b-bit (low byte) signatures, id-major
+
+    uint64_t bandKey(const uint32_t *sig, std::size_t band) const {
+        uint64_t h = 0x9E3779B97F4A7C15ull * (band + 1);
+        const uint32_t *v = sig + band * rows_;
+        for (std::size_t r = 0; r < rows_; ++r) {
+            h ^= v[r];
+            h *= 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        h *= 0xC4CEB9FE1A85EC53ull;
+        return h ^ (h >> 29);
+    }
+
+    void pack(const uint32_t *sig, uint8_t *out) const {
+        const std::size_t K = numHashes();
+        if (K > kMaxHashes)
+            throw std::invalid_argument("LSH index: at most 1024 hashes");
+        for (std::size_t i = 0; i < K; ++i)
+            out[i] = static_cast<uint8_t>(sig[i]);
+    }
+
+    // Matching low bytes, corrected for the 1/256 chance match.
+    float estimate(const uint8_t *a, const uint8_t *b) const {
+        const std::size_t K = numHashes();
+        std::size_t eq = 0, i = 0;
+#if defined(VC_VLIG_SSE2)
+        for (; i + 16 <= K; i += 16) {
+            const __m128i m = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+                                             _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+            eq += popcount32(static_cast<uint32_t>(_mm_movemask_epi8(m)));
+        }
+#elif defined(VC_VLIG_NEON)
+        for (; i + 16 <= K; i += 16) {
+            const uint8x16_t m = vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+            eq += vaddvq_u8(vshrq_n_u8(m, 7));
+        }
+#endif
+        for (; i < K; ++i)
+            eq += a[i] == b[i];
+        const float raw = static_cast<float>(eq) / static_cast<float>(K);
+        return std::max(0.0f, (raw - 1.0f / 256.0f) / (1.0f - 1.0f / 256.0f));
+    }
+
+    static void rehash(Table &t, std::size_t buckets) {
+        t.heads.assign(buckets, kNil);
+        for (std::size_t e = 0; e < t.entries.size(); ++e) {
+            const uint64_t key = (uint64_t{t.entries[e].key} << 32) | t.entries[e].low;
+            const std::size_t slot = key & (buckets - 1);
+            t.entries[e].next = t.heads[slot];
+            t.heads[slot] = static_cast<uint32_t>(e);
+        }
+    }
+};
+
+// Streaming detector: hasher plus index with matching shapes.
+class VCPromptNearDupDetector {
+public:
+    explicit VCPromptNearDupDetector(std::size_t bands = 16, std::size_t rows = 8,
+                                     float threshold = 0.7f, std::size_t shingleSize = 5)
+        : hasher_(makeConfig(bands * rows, shingleSize)), index_(bands, rows, threshold),
+          sig_(bands * rows) {}
+
+    // Returns the earlier near duplicate of `prompt`, if any, and indexes
+    // `prompt` either way; its id is written to `idOut` when given.
+    VCNearDuplicate checkAndAdd(const std::string &prompt, uint32_t *idOut = nullptr) {
+        hasher_.signature(prompt, sig_.data());
+        const VCNearDuplicate d = index_.find(sig_.data());
+        const uint32_t id = index_.insert(sig_.data());
+        if (idOut) *idOut = id;
+        return d;
+    }
+
+    VCNearDuplicate check(const std::string &prompt) {
+        hasher_.signature(prompt, sig_.data());
+        return index_.find(sig_.data());
+    }
+
+    const VCMinHasher &hasher() const { return hasher_; }
+    const VCPromptLSHIndex &index() const { return index_; }
+
+private:
+    VCMinHasher hasher_;
+    VCPromptLSHIndex index_;
+    std::vector<uint32_t> sig_;
+
+    static VCMinHashConfig makeConfig(std::size_t k, std::size_t shingle) {
+        VCMinHashConfig c;
+        c.numHashes = k;
+        c.shingleSize = shingle;
+        return c;
+    }
+};
+
+} // namespace vc_vlig
+
+#ifdef VC_VLIG_PROMPT_DEDUP_DEMO
+#include <chrono>
+#include <cstdlib>
+#include <random>
+
+// Labelled sample: clusters of one base prompt plus edited copies (case,
+// punctuation, spacing, a typo, a swapped or added word). Distinct clusters
+// come from the same templates and vocabulary, so unrelated prompts still
+// share much of their wording. A flag is correct when the matched prompt is
+// in the same cluster; recall counts every prompt whose cluster appeared
+// earlier in the stream.
+int main(int argc, char **argv) {
+    using namespace vc_vlig;
+    const std::size_t clusters = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::mt19937 rng(99);
+    const char *adjectives[] = {"tiny", "ancient", "gleaming", "weathered", "sleepy", "giant",
+                                "curious", "mechanical", "glass", "wooden", "floating", "lonely"};
+    const char *colors[] = {"crimson", "teal", "golden", "ivory", "violet", "emerald", "amber",
+                            "silver", "coral", "indigo"};
+    const char *subjects[] = {"astronaut", "fox", "lighthouse keeper", "teapot", "dragon",
+                              "cyclist", "sailor", "robot barista", "koi fish", "owl",
+                              "samurai", "ballerina", "house", "steam train", "jellyfish"};
+    const char *actions[] = {"reading a map", "drinking tea", "chasing fireflies", "playing violin",
+                             "watching the stars", "fixing a clock", "painting a mural",
+                             "riding a bicycle", "sleeping", "juggling lanterns"};
+    const char *places[] = {"in a foggy forest", "on a beach at dawn", "in a neon city at night",
+                            "in deep space", "on a snowy mountain", "in a flower field",
+                            "under the sea", "in a desert canyon", "inside a cozy library"};
+    const char *styles[] = {"watercolor", "cinematic 16:9", "anime style", "photorealistic",
+                            "low poly", "oil painting", "pixel art", "concept art", "pastel tones"};
+    const char *extras[] = {"soft lighting", "rule of thirds", "teal and orange", "dramatic light",
+                            "shallow depth of field", "golden hour", "wide shot", "close-up",
+                            "highly detailed", "8k", "film grain", "volumetric fog", "bokeh",
+                            "symmetrical", "muted palette", "high contrast", "rim light",
+                            "isometric", "overcast sky", "long exposure", "tilt-shift",
+                            "vignette", "backlit", "matte finish"};
+    auto pick = [&rng](auto &list) { return list[rng() % (sizeof(list) / sizeof(list[0]))]; };
+
+    auto base = [&]() {
+        std::string s = std::string("a ") + pick(adjectives) + " " + pick(colors) + " " +
+                        pick(subjects) + " " + pick(actions) + " " + pick(places) + ", " +
+                        pick(styles);
+        for (unsigned e = 2 + rng() % 3; e > 0; --e) s += std::string(", ") + pick(extras);
+        return s;
+    };
+    auto edit = [&](std::string s) {
+        switch (rng() % 6) {
+            case 0:  // shouting
+                for (char &c : s) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+                break;
+            case 1:  // punctuation
+                std::replace(s.begin(), s.end(), ',', ';');
+                s += "!!";
+                break;
+            case 2:  // spacing
+                s = "  " + s + "   \t";
+                for (std::size_t i = s.find(' ', 4); i != std::string::npos; i = s.find(' ', i + 3))
+                    s.insert(i, " ");
+                break;
+            case 3: {  // typo
+                const std::size_t i = 2 + rng() % (s.size() - 4);
+                std::swap(s[i], s[i + 1]);
+                break;
+            }
+            case 4:  // one more modifier
+                s += std::string(", ") + pick(extras);
+                break;
+            default: {  // inserted phrase
+                const std::size_t i = s.find(", ");
+                if (i != std::string::npos) s.insert(i, " with a cat");
+                break;
+            }
+        }
+        return s;
+    };
+
+    std::vector<std::pair<std::string, uint32_t>> stream;  // (prompt, cluster)
+    for (uint32_t c = 0; c < clusters; ++c) {
+        const std::string b = base();
+        stream.emplace_back(b, c);
+        if (rng() % 10 < 3)
+            for (unsigned k = 1 + rng() % 3; k > 0; --k) stream.emplace_back(edit(b), c);
+    }
+    std::shuffle(stream.begin(), stream.end(), rng);
+
+    VCPromptNearDupDetector detector;
+    std::vector<uint32_t> clusterOf;
+    clusterOf.reserve(stream.size());
+    std::vector<char> clusterSeen(clusters, 0);
+    std::size_t truePos = 0, falsePos = 0, expected = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (const auto &item : stream) {
+        const VCNearDuplicate d = detector.checkAndAdd(item.first);
+        clusterOf.push_back(item.second);
+        if (clusterSeen[item.second]) ++expected;
+        clusterSeen[item.second] = 1;
+        if (d.found) {
+            if (clusterOf[d.id] == item.second) ++truePos;
+            else ++falsePos;
+        }
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double sec = std::chrono::duration<double>(t1 - t0).count();
+    const double precision = truePos + falsePos ? double(truePos) / double(truePos + falsePos) : 1.0;
+    const double recall = expected ? double(truePos) / double(expected) : 1.0;
+    std::cout << stream.size() << " prompts (" << expected << " labelled near-duplicates): precision "
+              << precision << ", recall " << recall << " (" << truePos << " TP, " << falsePos
+              << " FP)\n";
+    std::cout << stream.size() / sec << " prompts/s streaming (signature + query + insert), "
+              << double(detector.index().memoryBytes()) / double(stream.size())
+              << " index bytes/prompt\n";
+
+    std::vector<uint32_t> sig(detector.hasher().numHashes());
+    const int iters = 200000;
+    const auto t2 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i)
+        detector.hasher().signature(stream[static_cast<std::size_t>(i) % stream.size()].first, sig.data());
+    const auto t3 = std::chrono::steady_clock::now();
+    std::cout << "signature: " << std::chrono::duration<double, std::nano>(t3 - t2).count() / iters
+              << " ns/prompt (" << sig[0] % 10 << ")\n";
+    return 0;
+}
+#endif
+
+#endif // VC_VLIG_PROMPT_DEDUP_CPP
@@ -0,0 +1,485 @@
+// File: /visual-code/runtime/vlig_router_bench.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS NDK
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Throughput benchmark for the semantic router over a realistic prompt
+//   corpus, for trend tracking in CI. Build with -DVC_VLIG_ROUTER_BENCH.
+//
+//   The corpus is generated deterministically, or loaded one prompt per
+//   line with --corpus. It has four variants:
+//     - short: a few words, the chat case;
+//     - long: paragraph-sized descriptions;
+//     - multilingual: CJK, Cyrillic, Arabic, accented Latin, emoji,
+//       typographic punctuation and fullwidth forms;
+//     - adversarial: control bytes, zero-width and bidi characters,
+//       malformed UTF-8, blocklist terms, keyword-prefix floods, quotes and
+//       backslashes that must be escaped, whitespace runs, and prompts past
+//       the 8000-byte cap.
+//
+//   Each stage is timed on its own over the whole variant (best of
+//   --repeats), with allocations per call from a counting operator new:
+//     - sanitize: sanitizeAndScanPrompt;
+//     - plan: the owning VCScenePlan, and the allocation-free view;
+//     - serialize: serializeScenePlanToJSON into a reused string;
+//     - end-to-end: BuildSemanticIGSpec.
+//   Multi-core scaling runs BuildSemanticIGSpec over the mixed corpus on
+//   1, 2, 4, ... hardware_concurrency threads. Results go to stdout as one
+//   JSON document (or to --out) and a readable summary to stderr.
+//
+//   Usage: vlig_router_bench [--prompts N] [--repeats N] [--max-threads N]
+//                            [--corpus FILE] [--out FILE]
+
+#ifndef VC_VLIG_ROUTER_BENCH_CPP
+#define VC_VLIG_ROUTER_BENCH_CPP
+
+#include "vlig_semantic_guided_router.cpp"
+
+#ifdef VC_VLIG_ROUTER_BENCH
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+#include <thread>
+
+// Allocation counting for the whole program; per thread, so the scaling
+// runs do not contend on it.
+static thread_local uint64_t tlAllocations = 0;
+
+void *operator new(std::size_t n) {
+    ++tlAllocations;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t n) { return operator new(n); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+namespace vc_vlig {
+namespace bench {
+
+struct Variant {
+    std::string name;
+    std::vector<std::string> prompts;
+    std::size_t bytes = 0;
+};
+
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(uint32_t seed) : rng_(seed) {}
+
+    std::string shortPrompt() {
+        std::string s = pick(kSubjects);
+        const unsigned extras = 1 + rng_() % 3;
+        for (unsigned i = 0; i < extras; ++i) {
+            s += i == 0 ? " " : ", ";
+            s += pick(kModifiers);
+        }
+        return s;
+    }
+
+    std::string longPrompt() {
+        std::string s = "A highly detailed scene of a " + std::string(pick(kSubjects));
+        const unsigned clauses = 20 + rng_() % 60;
+        for (unsigned i = 0; i < clauses; ++i) {
+            s += rng_() % 4 ? ", " : ". ";
+            s += pick(kModifiers);
+            if (rng_() % 3 == 0) {
+                s += " with ";
+                s += pick(kSubjects);
+            }
+        }
+        return s + ".";
+    }
+
+    std::string multilingualPrompt() {
+        std::string s;
+        const unsigned parts = 3 + rng_() % 6;
+        for (unsigned i = 0; i < parts; ++i) {
+            if (i) s += rng_() % 2 ? "\xE3\x80\x81" : " \xE2\x80\x94 ";  // 、 / em dash
+            s += rng_() % 3 ? pick(kForeign) : pick(kModifiers);
+        }
+        if (rng_() % 2) s += " \xE2\x80\x9C" "cinematic" "\xE2\x80\x9D";  // curly quotes
+        if (rng_() % 2) s += " \xEF\xBC\x91\xEF\xBC\x96:\xEF\xBC\x99";   // fullwidth 16:9
+        return s;
+    }
+
+    std::string adversarialPrompt() {
+        switch (rng_() % 9) {
+            case 0: {  // control bytes and zero-width / bidi characters
+                std::string s = shortPrompt();
+                for (std::size_t i = 1; i < s.size(); i += 3 + rng_() % 5) {
+                    static const char *junk[] = {"\x01", "\x7F", "\t\t", "\xE2\x80\x8B",
+                                                 "\xE2\x80\xAE", "\xEF\xBB\xBF"};
+                    s.insert(i, junk[rng_() % 6]);
+                }
+                return s;
+            }
+            case 1: {  // malformed UTF-8
+                std::string s = shortPrompt();
+                static const char *bad[] = {"\xC3", "\xE2\x82", "\xF0\x9F\x98", "\xFF", "\xC0\xAF"};
+                for (int k = 0; k < 4; ++k)
+                    s.insert(rng_() % s.size(), bad[rng_() % 5]);
+                return s;
+            }
+            case 2: {  // blocklist terms, also glued to other words
+                std::string s = shortPrompt();
+                s += " NSFW, explicitnude photo, not erotic-ish sexualized";
+                return s;
+            }
+            case 3: {  // keyword-prefix floods keep the automaton off the root
+                std::string s;
+                for (int k = 0; k < 60; ++k)
+                    s += rng_() % 2 ? "rule of thir" : "soft lightin";
+                return s + "rule of thirds";
+            }
+            case 4:  // characters the JSON writer must escape
+                return shortPrompt() + " \"quoted\" back\\slash \\\"both\\\" C:\\path\\to \"\"\"";
+            case 5: {  // whitespace runs
+                std::string s;
+                for (int k = 0; k < 40; ++k)
+                    s += std::string(1 + rng_() % 12, k % 2 ? ' ' : '\n') + pick(kModifiers);
+                return s;
+            }
+            case 6: {  // past the 8000-byte cap, ending mid multibyte sequence
+                std::string s;
+                while (s.size() < 9000)
+                    s += longPrompt() + " \xE6\x9C\x88\xE5\x85\x89 ";
+                return s;
+            }
+            case 7:  // sanitizes to nothing: counted as a rejected prompt
+                return std::string(8 + rng_() % 8, '\x02');
+            default: {  // one very long token
+                return std::string(2000 + rng_() % 4000, 'a') + " forest";
+            }
+        }
+    }
+
+private:
+    std::mt19937 rng_;
+
+    template <std::size_t N>
+    const char *pick(const char *const (&list)[N]) { return list[rng_() % N]; }
+
+    static constexpr const char *kSubjects[] = {
+        "astronaut", "red fox", "lighthouse", "teapot", "dragon", "cyclist", "old sailor",
+        "robot barista", "koi pond", "mountain village", "girl with an umbrella", "cat"};
+    static constexpr const char *kModifiers[] = {
+        "in a foggy forest", "at sunset", "teal and orange", "soft lighting", "rule of thirds",
+        "16:9", "watercolor", "anime style", "close-up", "top-down view", "neon city at night",
+        "dramatic lighting", "pastel colors", "low poly", "golden ratio", "wide shot",
+        "photorealistic", "shot on 50mm", "rainy street", "under the snow", "concept art",
+        "isometric", "high contrast noir", "on a beach at dawn", "vertical 9:16"};
+    static constexpr const char *kForeign[] = {
+        "\xE6\xA3\xAE\xE3\x81\xAE\xE4\xB8\xAD\xE3\x81\xAE\xE7\x8B\x90",  // 森の中の狐
+        "\xE5\xA4\x95\xE6\x97\xA5\xE3\x81\xAE\xE6\xB5\xB7",              // 夕日の海
+        "\xE8\xB5\x9B\xE5\x8D\x9A\xE6\x9C\x8B\xE5\x85\x8B\xE5\x9F\x8E\xE5\xB8\x82",  // 赛博朋克城市
+        "\xD0\xBA\xD0\xBE\xD1\x81\xD0\xBC\xD0\xBE\xD0\xBD\xD0\xB0\xD0\xB2\xD1\x82",  // космонавт
+        "\xD9\x85\xD8\xAF\xD9\x8A\xD9\x86\xD8\xA9 \xD9\x84\xD9\x8A\xD9\x84\xD8\xA7\xD9\x8B",  // مدينة ليلاً
+        "Stra\xC3\x9F" "enlaterne im Nebel",  // Straßenlaterne im Nebel
+        "caf\xC3\xA9 \xC3\xA0 l'aube",        // café à l'aube
+        "\xF0\x9F\x8C\x85 \xF0\x9F\xA6\x8A \xE2\x9C\xA8",  // emoji
+        "ni\xC3\xB1" "a con paraguas rojo",  // niña con paraguas rojo
+        "\xEA\xB3\xA0\xEC\x96\x91\xEC\x9D\xB4 \xEC\x88\x98\xEC\xB1\x84\xED\x99\x94"};  // 고양이 수채화
+};
+
+constexpr const char *CorpusGenerator::kSubjects[];
+constexpr const char *CorpusGenerator::kModifiers[];
+constexpr const char *CorpusGenerator::kForeign[];
+
+struct StageResult {
+    const char *name;
+    double nsPerCall = 0;
+    double mbPerSec = 0;       // input prompt bytes per second
+    double allocsPerCall = 0;
+};
+
+struct VariantResult {
+    std::string name;
+    std::size_t prompts = 0;
+    double avgBytes = 0;
+    std::size_t rejected = 0;
+    std::vector<StageResult> stages;
+};
+
+struct ScalingResult {
+    unsigned threads;
+    double promptsPerSec;
+    double speedup;
+};
+
+using BenchClock = std::chrono::steady_clock;
+
+// Stage results are stored here so the compiler cannot drop the timed work.
+static volatile std::size_t gBenchSink = 0;
+
+// Best-of-`repeats` time for body() over the variant, plus allocations per
+// call on the last run.
+template <class Body>
+static StageResult timeStage(const char *name, const Variant &v, unsigned repeats, Body &&body) {
+    StageResult r;
+    r.name = name;
+    double best = 1e300;
+    uint64_t allocs = 0;
+    for (unsigned rep = 0; rep < repeats; ++rep) {
+        const uint64_t a0 = tlAllocations;
+        const auto t0 = BenchClock::now();
+        body();
+        const auto t1 = BenchClock::now();
+        allocs = tlAllocations - a0;
+        best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+    }
+    const double n = static_cast<double>(v.prompts.size());
+    r.nsPerCall = best / n * 1e9;
+    r.mbPerSec = static_cast<double>(v.bytes) / best / 1e6;
+    r.allocsPerCall = static_cast<double>(allocs) / n;
+    return r;
+}
+
+static VariantResult runVariant(const Variant &v, unsigned repeats) {
+    VariantResult res;
+    res.name = v.name;
+    res.prompts = v.prompts.size();
+    res.avgBytes = static_cast<double>(v.bytes) / static_cast<double>(v.prompts.size());
+
+    const VCIGMode mode = VCIGMode::TextToImage;
+    const VCSafetyProfile safety = VCSafetyProfile::Safe;
+    const VCQualityPreset quality = VCQualityPreset::High;
+    const std::size_t n = v.prompts.size();
+    std::vector<VCSanitizedPrompt> sanitized(n);
+    std::vector<char> ok(n, 0);
+    std::vector<VCScenePlan> plans(n);
+    std::string json;
+    std::size_t sink = 0;
+
+    // Warm-up: sizes every buffer, so the timed runs measure steady state.
+    for (std::size_t i = 0; i < n; ++i) {
+        try {
+            sanitizeAndScanPrompt(v.prompts[i], sanitized[i]);
+            ok[i] = 1;
+            plans[i] = buildScenePlanFromSanitized(sanitized[i], mode, safety, quality);
+            serializeScenePlanToJSON(plans[i], json);
+        } catch (const std::exception &) {
+            ++res.rejected;
+        }
+    }
+
+    res.stages.push_back(timeStage("sanitize", v, repeats, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            try {
+                sanitizeAndScanPrompt(v.prompts[i], sanitized[i]);
+            } catch (const std::exception &) {
+            }
+        }
+    }));
+    res.stages.push_back(timeStage("plan", v, repeats, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+            if (ok[i]) plans[i] = buildScenePlanFromSanitized(sanitized[i], mode, safety, quality);
+    }));
+    res.stages.push_back(timeStage("plan_view", v, repeats, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+            if (ok[i]) sink += buildScenePlanView(sanitized[i], mode, safety, quality).corePrompt.size();
+    }));
+    res.stages.push_back(timeStage("serialize", v, repeats, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            if (!ok[i]) continue;
+            serializeScenePlanToJSON(plans[i], json);
+            sink += json.size();
+        }
+    }));
+    res.stages.push_back(timeStage("end_to_end", v, repeats, [&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            try {
+                sink += BuildSemanticIGSpec(v.prompts[i], mode, safety, quality).jsonControl.size();
+            } catch (const std::exception &) {
+            }
+        }
+    }));
+    gBenchSink = sink;
+    return res;
+}
+
+static std::vector<ScalingResult> runScaling(const std::vector<std::string> &corpus,
+                                             unsigned maxThreads, unsigned repeats) {
+    std::vector<ScalingResult> out;
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+
+    double base = 0;
+    for (unsigned threads : counts) {
+        double best = 1e300;
+        for (unsigned rep = 0; rep < repeats; ++rep) {
+            std::atomic<std::size_t> next{0};
+            auto worker = [&] {
+                const std::size_t chunk = 256;
+                for (;;) {
+                    const std::size_t first = next.fetch_add(chunk, std::memory_order_relaxed);
+                    if (first >= corpus.size()) break;
+                    const std::size_t last = std::min(corpus.size(), first + chunk);
+                    for (std::size_t i = first; i < last; ++i) {
+                        try {
+                            BuildSemanticIGSpec(corpus[i], VCIGMode::TextToImage,
+                                                VCSafetyProfile::Safe, VCQualityPreset::High);
+                        } catch (const std::exception &) {
+                        }
+                    }
+                }
+            };
+            const auto t0 = BenchClock::now();
+            std::vector<std::thread> pool;
+            for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+            worker();
+            for (std::thread &th : pool) th.join();
+            const auto t1 = BenchClock::now();
+            best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+        }
+        const double rate = static_cast<double>(corpus.size()) / best;
+        if (threads == 1) base = rate;
+        out.push_back(ScalingResult{threads, rate, base > 0 ? rate / base : 1.0});
+    }
+    return out;
+}
+
+static void appendf(std::string &out, const char *fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = std::vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > 0) out.append(buf, std::min<std::size_t>(static_cast<std::size_t>(n), sizeof(buf) - 1));
+}
+
+static std::string toJSON(const std::vector<VariantResult> &variants,
+                          const std::vector<ScalingResult> &scaling, unsigned repeats) {
+    std::string j;
+    appendf(j, "{\"benchmark\":\"vlig_semantic_router\",\"hardware_concurrency\":%u,"
+               "\"repeats\":%u,\"variants\":[",
+            std::thread::hardware_concurrency(), repeats);
+    for (std::size_t v = 0; v < variants.size(); ++v) {
+        const VariantResult &r = variants[v];
+        std::string name;
+        VCJsonWriter w(name, r.name.size() + 2);
+        w.string(r.name);
+        w.finish();
+        appendf(j, "%s{\"name\":%s,\"prompts\":%zu,\"avg_bytes\":%.1f,\"rejected\":%zu,\"stages\":{",
+                v ? "," : "", name.c_str(), r.prompts, r.avgBytes, r.rejected);
+        for (std::size_t s = 0; s < r.stages.size(); ++s) {
+            const StageResult &st = r.stages[s];
+            appendf(j, "%s\"%s\":{\"ns_per_call\":%.1f,\"mb_per_s\":%.2f,\"allocs_per_call\":%.3f}",
+                    s ? "," : "", st.name, st.nsPerCall, st.mbPerSec, st.allocsPerCall);
+        }
+        j += "}}";
+    }
+    j += "],\"scaling\":[";
+    for (std::size_t i = 0; i < scaling.size(); ++i)
+        appendf(j, "%s{\"threads\":%u,\"prompts_per_s\":%.0f,\"speedup\":%.3f}", i ? "," : "",
+                scaling[i].threads, scaling[i].promptsPerSec, scaling[i].speedup);
+    j += "]}\n";
+    return j;
+}
+
+} // namespace bench
+} // namespace vc_vlig
+
+int main(int argc, char **argv) {
+    using namespace vc_vlig;
+    using namespace vc_vlig::bench;
+    std::size_t perVariant = 20000;
+    unsigned repeats = 3;
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::string corpusPath, outPath;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (a == "--prompts" && val) { perVariant = std::strtoul(val, nullptr, 10); ++i; }
+        else if (a == "--repeats" && val) { repeats = static_cast<unsigned>(std::strtoul(val, nullptr, 10)); ++i; }
+        else if (a == "--max-threads" && val) { maxThreads = static_cast<unsigned>(std::strtoul(val, nullptr, 10)); ++i; }
+        else if (a == "--corpus" && val) { corpusPath = val; ++i; }
+        else if (a == "--out" && val) { outPath = val; ++i; }
+        else {
+            std::cerr << "usage: " << argv[0] << " [--prompts N] [--repeats N] [--max-threads N]"
+                      << " [--corpus FILE] [--out FILE]\n";
+            return 2;
+        }
+    }
+    perVariant = std::max<std::size_t>(perVariant, 1);
+    repeats = std::max(repeats, 1u);
+    maxThreads = std::max(maxThreads, 1u);
+
+    std::vector<Variant> variants;
+    if (!corpusPath.empty()) {
+        std::ifstream in(corpusPath, std::ios::binary);
+        if (!in) {
+            std::cerr << "cannot open corpus " << corpusPath << "\n";
+            return 1;
+        }
+        Variant v;
+        v.name = "file";
+        for (std::string line; std::getline(in, line);)
+            if (!line.empty()) v.prompts.push_back(line);
+        if (v.prompts.empty()) {
+            std::cerr << "corpus " << corpusPath << " has no prompts\n";
+            return 1;
+        }
+        variants.push_back(std::move(v));
+    } else {
+        CorpusGenerator gen(20240611);
+        const char *names[] = {"short", "long", "multilingual", "adversarial"};
+        for (int k = 0; k < 4; ++k) {
+            Variant v;
+            v.name = names[k];
+            v.prompts.reserve(perVariant);
+            for (std::size_t i = 0; i < perVariant; ++i) {
+                switch (k) {
+                    case 0: v.prompts.push_back(gen.shortPrompt()); break;
+                    case 1: v.prompts.push_back(gen.longPrompt()); break;
+                    case 2: v.prompts.push_back(gen.multilingualPrompt()); break;
+                    default: v.prompts.push_back(gen.adversarialPrompt()); break;
+                }
+            }
+            variants.push_back(std::move(v));
+        }
+    }
+    std::vector<std::string> mixed;
+    for (Variant &v : variants) {
+        for (const std::string &p : v.prompts) v.bytes += p.size();
+        mixed.insert(mixed.end(), v.prompts.begin(), v.prompts.end());
+    }
+
+    std::vector<VariantResult> results;
+    for (const Variant &v : variants) {
+        results.push_back(runVariant(v, repeats));
+        const VariantResult &r = results.back();
+        std::cerr << r.name << " (" << r.prompts << " prompts, " << r.avgBytes << " B avg, "
+                  << r.rejected << " rejected)\n";
+        for (const StageResult &s : r.stages)
+            std::cerr << "  " << s.name << ": " << s.nsPerCall << " ns/call, " << s.mbPerSec
+                      << " MB/s, " << s.allocsPerCall << " allocs/call\n";
+    }
+    const std::vector<ScalingResult> scaling = runScaling(mixed, maxThreads, repeats);
+    for (const ScalingResult &s : scaling)
+        std::cerr << "scaling " << s.threads << " thread(s): " << s.promptsPerSec
+                  << " prompts/s, " << s.speedup << "x\n";
+
+    const std::string json = toJSON(results, scaling, repeats);
+    if (outPath.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream out(outPath, std::ios::binary);
+        out << json;
+        if (!out) {
+            std::cerr << "cannot write " << outPath << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif // VC_VLIG_ROUTER_BENCH
+
+#endif // VC_VLIG_ROUTER_BENCH_CPP
@@ -0,0 +1,570 @@
+// File: /visual-code/runtime/vlig_router_rule_store.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS NDK
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Hot-reloadable router rule tables. The keyword patterns, the blocklist and
+//   the default negative constraints are read from a config file, compiled
+//   into the same byte-class Aho-Corasick DFA the built-in tables use
+//   (vcBuildKeywordDFA over a heap store) and published atomically.
+//
+//   Config format, one rule per line, '#' starts a comment line:
+//
+//     builtin = keywords              # start from the compiled-in keywords
+//     keyword rule_of_thirds = rule-of-thirds
+//     keyword forest = woodland
+//     block = gore
+//     negative.visual_artifacts = blurry, extra limbs, watermark
+//     negative.content_exclusions = no gore, no real-world logos
+//
+//   Keyword names are the VCKeyword values in snake_case (kKeywordNames).
+//   Patterns are matched against the sanitized lowercase prompt, so they are
+//   lowercased and their whitespace runs collapsed on load. Negatives not
+//   given keep the built-in text. The compiled-in NSFW blocklist stays in
+//   force unless the config says `builtin = no-blocklist`: a partial config
+//   must not turn off safety masking (`builtin = blocklist` is accepted and
+//   changes nothing).
+//
+//   Only paths given the store's rules see them: the store overload of
+//   BuildSemanticIGSpec below and BuildSemanticIGSpecBatch passed rules().
+//   The plan cache and the streaming planner always use the built-in tables.
+//
+//   Publication is RCU-style. Request threads bracket their use of a table
+//   with a ReadGuard, which stores the global epoch in a per-thread slot and
+//   loads the current pointer: no lock, no reference count, no shared write.
+//   A writer swaps the pointer, closes the epoch and retires the old table;
+//   it is freed once no reader slot still holds an epoch at or before the
+//   swap. A reader therefore always sees one complete table, old or new.
+
+#ifndef VC_VLIG_ROUTER_RULE_STORE_CPP
+#define VC_VLIG_ROUTER_RULE_STORE_CPP
+
+#include "vlig_semantic_guided_router.cpp"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace vc_vlig {
+
+// Config names of VCKeyword, in declaration order.
+static constexpr const char *kKeywordNames[] = {
+    "vertical", "portrait", "ratio_9_16", "cinematic", "wide", "ratio_16_9", "ratio_21_9",
+    "ratio_4_3", "ratio_3_4",
+    "photo", "photoreal", "realistic", "anime", "manga", "watercolor", "pixel", "line_art",
+    "sketch", "low_poly", "low_poly_hyphen", "concept_art", "key_art", "painting",
+    "digital_painting",
+    "soft_light", "soft_lighting", "dramatic", "cinematic_light", "studio", "three_point",
+    "hard_light",
+    "teal_and_orange", "warm", "sunset", "cool", "blueish", "pastel", "high_contrast", "noir",
+    "top_down_hyphen", "top_down", "birds_eye", "close_up_hyphen", "close_up", "portrait_shot",
+    "wide_shot", "wide_angle", "low_angle", "high_angle", "isometric",
+    "rule_of_thirds", "centered", "symmetrical", "symmetry", "golden_ratio", "leading_lines",
+    "symmetric",
+    "forest", "city", "space", "galaxy", "nebula", "beach", "ocean", "sea",
+    "night", "dawn", "sunrise",
+    "rain", "fog", "mist", "snow",
+};
+static_assert(sizeof(kKeywordNames) / sizeof(kKeywordNames[0]) ==
+                  static_cast<std::size_t>(VCKeyword::Count),
+              "kKeywordNames must name every VCKeyword");
+
+static constexpr auto kKeywordNameTable = vcMakePerfectHashTable<512>(kKeywordNames);
+
+// Heap-backed store for vcBuildKeywordDFA, for tables only known at runtime.
+struct VCRuntimeKeywordDFA {
+    uint8_t                    classOf[256] = {};
+    std::size_t                numClasses = 0;
+    std::vector<uint16_t>      nextTable;
+    std::vector<VCKeywordHits> outTable;
+    std::vector<uint8_t>       blockTable;
+    const VCKeywordPattern    *patterns = nullptr;
+    std::size_t                patternCount = 0;
+    bool                       blockNested = false;
+
+    uint16_t addState() {
+        const std::size_t s = outTable.size();
+        if (s >= 0xFFFF)  // 0xFFFF marks a missing edge during construction
+            throw std::runtime_error("router rules: too many automaton states");
+        nextTable.resize(nextTable.size() + numClasses, 0xFFFF);
+        outTable.emplace_back();
+        blockTable.push_back(0);
+        return static_cast<uint16_t>(s);
+    }
+    uint16_t &next(std::size_t i) { return nextTable[i]; }
+    VCKeywordHits &out(std::size_t s) { return outTable[s]; }
+    uint8_t &blockLen(std::size_t s) { return blockTable[s]; }
+
+    VCKeywordDFAView view() const {
+        return VCKeywordDFAView{classOf,           numClasses, nextTable.data(),
+                                outTable.data(),   blockTable.data(), patterns,
+                                patternCount,      blockNested};
+    }
+};
+
+// One immutable, compiled rule table. Never moved once built: rules() holds
+// pointers into it.
+class VCRouterRuleSet {
+public:
+    // The compiled-in tables.
+    VCRouterRuleSet() : rules_(kBuiltinRouterRules), patterns_(kRouterPatternCount) {}
+
+    VCRouterRuleSet(const VCRouterRuleSet &) = delete;
+    VCRouterRuleSet &operator=(const VCRouterRuleSet &) = delete;
+
+    // Parses and compiles a config (see the file header); throws
+    // std::runtime_error naming the offending line.
+    static std::unique_ptr<VCRouterRuleSet> compile(const std::string &config) {
+        std::unique_ptr<VCRouterRuleSet> set(new VCRouterRuleSet());
+        std::vector<std::string> texts;
+        std::vector<VCKeywordPattern> patterns;
+        std::string visual(kBuiltinRouterRules.visualArtifacts);
+        std::string content(kBuiltinRouterRules.contentExclusions);
+        bool builtinKeywords = false;
+        bool builtinBlocklist = true;
+        bool keepBlocklist = false;
+
+        std::istringstream in(config);
+        std::string line;
+        for (std::size_t ln = 1; std::getline(in, line); ++ln) {
+            const std::string_view l = trim(line);
+            if (l.empty() || l[0] == '#')
+                continue;
+            const std::size_t eq = l.find('=');
+            if (eq == std::string_view::npos)
+                fail(ln, "expected 'name = value'");
+            const std::string_view key = trim(l.substr(0, eq));
+            const std::string_view value = trim(l.substr(eq + 1));
+
+            if (key == "builtin") {
+                if (value == "keywords") builtinKeywords = true;
+                else if (value == "blocklist") keepBlocklist = true;
+                else if (value == "no-blocklist") builtinBlocklist = false;
+                else fail(ln, "builtin takes 'keywords', 'blocklist' or 'no-blocklist'");
+                if (keepBlocklist && !builtinBlocklist)
+                    fail(ln, "builtin blocklist both kept and dropped");
+            } else if (key == "block") {
+                texts.push_back(normalizePattern(value, ln));
+                patterns.push_back(VCKeywordPattern{nullptr, VCKeyword::Count, true});
+            } else if (key.substr(0, 8) == "keyword " || key.substr(0, 8) == "keyword\t") {
+                const std::string_view name = trim(key.substr(8));
+                const int k = kKeywordNameTable.find(name.data(), name.size());
+                if (k < 0)
+                    fail(ln, "unknown keyword '" + std::string(name) + "'");
+                texts.push_back(normalizePattern(value, ln));
+                patterns.push_back(VCKeywordPattern{nullptr, static_cast<VCKeyword>(k), false});
+            } else if (key == "negative.visual_artifacts") {
+                visual.assign(value.data(), value.size());
+            } else if (key == "negative.content_exclusions") {
+                content.assign(value.data(), value.size());
+            } else {
+                fail(ln, "unknown rule '" + std::string(key) + "'");
+            }
+        }
+
+        // The set keeps the pattern table: masking reads it (applyBlockSpans).
+        set->texts_ = std::move(texts);
+        std::vector<VCKeywordPattern> &all = set->table_;
+        all.reserve(patterns.size() + kRouterPatternCount);
+        for (const VCKeywordPattern &p : kRouterPatterns)
+            if (p.block ? builtinBlocklist : builtinKeywords)
+                all.push_back(p);
+        for (std::size_t i = 0; i < patterns.size(); ++i) {
+            patterns[i].text = set->texts_[i].c_str();
+            all.push_back(patterns[i]);
+        }
+
+        std::size_t bound = 1;  // trie states: at most one per pattern byte
+        for (const VCKeywordPattern &p : all)
+            bound += vcPatternLength(p.text);
+        std::vector<uint16_t> fail(bound), queue(bound);
+        vcBuildKeywordDFA(set->dfa_, all.data(), all.size(), fail.data(), queue.data());
+
+        set->visualArtifacts_ = std::move(visual);
+        set->contentExclusions_ = std::move(content);
+        set->rules_ = VCRouterRules{set->dfa_.view(), set->visualArtifacts_,
+                                    set->contentExclusions_};
+        set->patterns_ = all.size();
+        return set;
+    }
+
+    const VCRouterRules &rules() const { return rules_; }
+    uint64_t version() const { return version_; }    // 0 = built-in
+    std::size_t patternCount() const { return patterns_; }
+
+private:
+    friend class VCRouterRuleStore;
+
+    VCRuntimeKeywordDFA dfa_;
+    std::vector<std::string> texts_;
+    std::vector<VCKeywordPattern> table_;
+    std::string visualArtifacts_;
+    std::string contentExclusions_;
+    VCRouterRules rules_;
+    std::size_t patterns_;
+    uint64_t version_ = 0;
+
+    static std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t' || s.front() == '\r'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+            s.remove_suffix(1);
+        return s;
+    }
+
+    [[noreturn]] static void fail(std::size_t line, const std::string &what) {
+        throw std::runtime_error("router rules line " + std::to_string(line) + ": " + what);
+    }
+
+    static std::string normalizePattern(std::string_view value, std::size_t line) {
+        std::string out = normalizeKeywordPattern(value);
+        if (out.empty())
+            fail(line, "empty pattern");
+        if (out.size() > 255)
+            fail(line, "pattern longer than 255 bytes");
+        return out;
+    }
+};
+
+// Process-wide reader registry for epoch-based reclamation. Each reading
+// thread owns one cache-line slot, claimed on its first read and released
+// when the thread exits; a slot holds the epoch the thread entered in, or 0
+// while it is outside every read-side section.
+class VCEpochReaders {
+public:
+    static constexpr std::size_t kMaxReaders = 512;
+
+    static VCEpochReaders &instance() {
+        static VCEpochReaders readers;
+        return readers;
+    }
+
+    // Nestable within one thread.
+    void enter() {
+        ThreadSlot &t = threadSlot();
+        if (t.depth++ == 0)
+            t.slot->epoch.store(epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+
+    void leave() {
+        ThreadSlot &t = threadSlot();
+        if (--t.depth == 0)
+            t.slot->epoch.store(0, std::memory_order_release);
+    }
+
+    // Closes the current epoch and returns it: anything unpublished before
+    // this call may only be referenced by readers whose slot is <= the tag.
+    uint64_t advance() { return epoch_.fetch_add(1, std::memory_order_seq_cst); }
+
+    bool quiescent(uint64_t tag) const {
+        for (const Slot &s : slots_) {
+            const uint64_t e = s.epoch.load(std::memory_order_seq_cst);
+            if (e != 0 && e <= tag)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool>     owned{false};
+    };
+
+    struct ThreadSlot {
+        Slot *slot = nullptr;
+        unsigned depth = 0;
+        ~ThreadSlot() {
+            if (slot) {
+                slot->epoch.store(0, std::memory_order_release);
+                slot->owned.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    Slot slots_[kMaxReaders];
+    std::atomic<uint64_t> epoch_{1};
+
+    ThreadSlot &threadSlot() {
+        thread_local ThreadSlot t;
+        if (!t.slot) {
+            for (Slot &s : slots_) {
+                bool expected = false;
+                if (!s.owned.load(std::memory_order_relaxed) &&
+                    s.owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    t.slot = &s;
+                    break;
+                }
+            }
+            if (!t.slot)
+                throw std::runtime_error("router rules: more than kMaxReaders reader threads");
+        }
+        return t;
+    }
+};
+
+// Holds the active rule set. Reads are wait-free; publishing (and loading)
+// serializes on a writer mutex that readers never touch.
+class VCRouterRuleStore {
+public:
+    // Read-side section: the referenced table stays valid and unchanged until
+    // the guard is destroyed. Keep it short; it holds back reclamation.
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const VCRouterRuleStore &store) {
+            VCEpochReaders::instance().enter();
+            set_ = store.current_.load(std::memory_order_seq_cst);
+        }
+        ~ReadGuard() { VCEpochReaders::instance().leave(); }
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        const VCRouterRuleSet &operator*() const { return *set_; }
+        const VCRouterRuleSet *operator->() const { return set_; }
+
+    private:
+        const VCRouterRuleSet *set_;
+    };
+
+    // Starts with the compiled-in tables.
+    VCRouterRuleStore() : current_(new VCRouterRuleSet()) {}
+
+    VCRouterRuleStore(const VCRouterRuleStore &) = delete;
+    VCRouterRuleStore &operator=(const VCRouterRuleStore &) = delete;
+
+    // No reader may still be using the store.
+    ~VCRouterRuleStore() {
+        delete current_.load(std::memory_order_relaxed);
+        for (const Retired &r : retired_)
+            delete r.set;
+    }
+
+    ReadGuard read() const { return ReadGuard(*this); }
+
+    // Makes `next` the active table and returns its version.
+    uint64_t publish(std::unique_ptr<VCRouterRuleSet> next) {
+        std::lock_guard<std::mutex> lock(writeMu_);
+        next->version_ = ++version_;
+        const uint64_t v = version_;
+        VCRouterRuleSet *old = current_.exchange(next.release(), std::memory_order_seq_cst);
+        retired_.push_back(Retired{old, VCEpochReaders::instance().advance()});
+        reclaimLocked();
+        return v;
+    }
+
+    // Compile + publish; on a bad config throws and keeps the current table.
+    uint64_t loadString(const std::string &config) {
+        return publish(VCRouterRuleSet::compile(config));
+    }
+
+    uint64_t loadFile(const std::string &path) {
+        std::error_code ec;
+        const auto mtime = std::filesystem::last_write_time(path, ec);
+        std::ifstream f(path, std::ios::binary);
+        if (!f)
+            throw std::runtime_error("router rules: cannot open " + path);
+        std::ostringstream text;
+        text << f.rdbuf();
+        const uint64_t v = loadString(text.str());
+        std::lock_guard<std::mutex> lock(writeMu_);
+        path_ = path;
+        mtime_ = mtime;
+        return v;
+    }
+
+    // Reloads the last loadFile() path if its modification time changed.
+    // Returns false if unchanged or momentarily missing (editors that replace
+    // the file); a config error still throws.
+    bool reloadIfModified() {
+        std::string path;
+        std::filesystem::file_time_type seen;
+        {
+            std::lock_guard<std::mutex> lock(writeMu_);
+            path = path_;
+            seen = mtime_;
+        }
+        if (path.empty())
+            return false;
+        std::error_code ec;
+        const auto mtime = std::filesystem::last_write_time(path, ec);
+        if (ec || mtime == seen)
+            return false;
+        loadFile(path);
+        return true;
+    }
+
+    // Frees retired tables no reader can still see; returns how many remain.
+    // publish() does this too, so only needed after the last reload.
+    std::size_t reclaim() {
+        std::lock_guard<std::mutex> lock(writeMu_);
+        reclaimLocked();
+        return retired_.size();
+    }
+
+    uint64_t version() const { return current_.load(std::memory_order_acquire)->version(); }
+
+private:
+    struct Retired {
+        VCRouterRuleSet *set;
+        uint64_t epoch;  // readers that entered at or before it may hold `set`
+    };
+
+    std::atomic<VCRouterRuleSet *> current_;
+    std::mutex writeMu_;
+    std::vector<Retired> retired_;
+    uint64_t version_ = 0;
+    std::string path_;
+    std::filesystem::file_time_type mtime_{};
+
+    void reclaimLocked() {
+        const VCEpochReaders &readers = VCEpochReaders::instance();
+        std::size_t kept = 0;
+        for (const Retired &r : retired_) {
+            if (readers.quiescent(r.epoch))
+                delete r.set;
+            else
+                retired_[kept++] = r;
+        }
+        retired_.resize(kept);
+    }
+};
+
+// BuildSemanticIGSpec against the store's active rules.
+static VCSemanticIGResult BuildSemanticIGSpec(const std::string &userPrompt,
+                                              VCIGMode mode,
+                                              VCSafetyProfile safety,
+                                              VCQualityPreset quality,
+                                              const VCRouterRuleStore &store) {
+    thread_local VCSanitizedPrompt prompt;
+    VCSemanticIGResult result;
+    {
+        VCRouterRuleStore::ReadGuard rules = store.read();
+        sanitizeAndScanPrompt(userPrompt, prompt, rules->rules());
+        result.scene = toScenePlan(
+            buildScenePlanView(prompt, mode, safety, quality, rules->rules()));
+    }
+    serializeScenePlanToJSON(result.scene, result.jsonControl);
+    return result;
+}
+
+} // namespace vc_vlig
+
+#ifdef VC_VLIG_ROUTER_RULE_STORE_DEMO
+#include <chrono>
+
+int main() {
+    using namespace vc_vlig;
+    const std::string prompt =
+        "Ultra-detailed cinematic portrait of a lone astronaut standing in a "
+        "woodland at sunset, rule-of-thirds composition, gore, 16:9.";
+
+    VCRouterRuleStore store;
+    const std::string builtin = BuildSemanticIGSpec(prompt, VCIGMode::TextToImage,
+                                                    VCSafetyProfile::Safe, VCQualityPreset::High,
+                                                    store).jsonControl;
+    const bool builtinSame =
+        builtin == BuildSemanticIGSpec(prompt, VCIGMode::TextToImage, VCSafetyProfile::Safe,
+                                       VCQualityPreset::High).jsonControl;
+
+    std::string config =
+        "builtin = keywords\n"
+        "keyword forest = woodland\n"
+        "keyword rule_of_thirds = rule-of-thirds\n"
+        "block = gore\n"
+        "negative.visual_artifacts = blurry, extra limbs, watermark\n";
+    for (int i = 0; i < 500; ++i)  // a tenant-sized blocklist
+        config += "block = blocked term " + std::to_string(i) + "\n";
+
+    const std::string path = "vlig_router_rules_demo.conf";
+    {
+        std::ofstream(path) << config;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    store.loadFile(path);
+    auto t1 = std::chrono::steady_clock::now();
+    const std::string custom = BuildSemanticIGSpec(prompt, VCIGMode::TextToImage,
+                                                   VCSafetyProfile::Safe, VCQualityPreset::High,
+                                                   store).jsonControl;
+    std::cout << "built-in via store " << (builtinSame ? "matches" : "DIFFERS")
+              << "; compiled " << store.read()->patternCount() << " patterns in "
+              << std::chrono::duration<double, std::micro>(t1 - t0).count() << " us\n";
+    std::cout << "custom rules JSON:\n" << custom << "\n";
+
+    try {
+        store.loadString("keyword forrest = woods\n");
+    } catch (const std::exception &e) {
+        std::cout << "rejected: " << e.what() << " (still v" << store.version() << ")\n";
+    }
+
+    // Readers keep planning while a writer republishes.
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> reads{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                BuildSemanticIGSpec(prompt, VCIGMode::TextToImage, VCSafetyProfile::Safe,
+                                    VCQualityPreset::High, store);
+                reads.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    const int reloads = 200;
+    for (int i = 0; i < reloads; ++i)
+        store.loadString(i % 2 ? config : "builtin = keywords\n");
+    stop = true;
+    for (std::thread &t : readers)
+        t.join();
+    const std::size_t pending = store.reclaim();
+
+    const int iters = 200000;
+    std::size_t sink = 0;
+    auto t2 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i) {
+        VCRouterRuleStore::ReadGuard g = store.read();
+        sink += g->version();
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    std::cout << reloads << " reloads under " << reads.load() << " concurrent plans, "
+              << pending << " tables pending reclamation; read guard "
+              << std::chrono::duration<double, std::nano>(t3 - t2).count() / iters << " ns ("
+              << sink % 10 << ")\n";
+    std::remove(path.c_str());
+
+    bool ok = true;
+    auto check = [&ok](bool cond, const char *what) {
+        std::cout << (cond ? "  ok   " : "  FAIL ") << what << "\n";
+        ok = ok && cond;
+    };
+    auto planned = [&](const std::string &rules) {
+        VCRouterRuleStore s;
+        s.loadString(rules);
+        return BuildSemanticIGSpec("a nude figure study, gore, charcoal sketch", VCIGMode::TextToImage,
+                                   VCSafetyProfile::Safe, VCQualityPreset::High, s)
+            .scene.corePrompt;
+    };
+    auto has = [](const std::string &s, const char *term) { return s.find(term) != std::string::npos; };
+    const std::string partial = planned("block = gore\n");
+    const std::string optedOut = planned("builtin = no-blocklist\nblock = gore\n");
+    check(builtinSame, "built-in rules via the store match BuildSemanticIGSpec");
+    check(!has(custom, "gore, 16:9") && has(custom, "\"environment\":\"forest\""),
+          "loaded block and keyword rules apply");
+    check(!has(partial, "nude") && !has(partial, "gore"),
+          "config without builtin lines keeps the built-in blocklist");
+    check(has(optedOut, "nude") && !has(optedOut, "gore"),
+          "builtin = no-blocklist drops only the built-in blocklist");
+    bool conflict = false;
+    try {
+        store.loadString("builtin = blocklist\nbuiltin = no-blocklist\n");
+    } catch (const std::runtime_error &) {
+        conflict = true;
+    }
+    check(conflict, "keeping and dropping the built-in blocklist is rejected");
+    return ok ? 0 : 1;
+}
+#endif
+
+#endif // VC_VLIG_ROUTER_RULE_STORE_CPP
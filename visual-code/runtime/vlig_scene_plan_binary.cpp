@@ -0,0 +1,372 @@
+// File: /visual-code/runtime/vlig_scene_plan_binary.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS NDK
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Compact binary encoding of VCScenePlan for in-process adapters that
+//   would otherwise serialize the control spec to JSON and parse it straight
+//   back. JSON (serializeScenePlanToJSON) stays the external format.
+//
+//   Layout (version 1, all integers little-endian):
+//
+//     0   char[4]   magic "VCSP"
+//     4   u16       version
+//     6   u16       header size (32)
+//     8   u32       total size in bytes
+//     12  u8[10]    enums: aspect, mode, safety, quality, color tone,
+//                   lighting, camera angle, composition, art style, brush
+//     22  u8        flags: bit 0 depth of field, bit 1 allow cropping,
+//                   bit 2 center main subject
+//     23  u8        reserved (0)
+//     24  f32       focal length (IEEE-754 bits)
+//     28  u16       string count = 11 + 3 * secondary count
+//     30  u16       secondary subject count
+//     32  u32[n]    offset table: byte offset of each string record
+//     ..  records   u32 length + UTF-8 bytes, in table order
+//
+//   Enums travel as their declaration index; the static_asserts below pin
+//   every enum's size so a reorder or insertion fails the build instead of
+//   silently changing the wire format (append new values, bump the pin).
+//   VCScenePlanBinaryView validates the whole buffer once in open() and then
+//   hands out std::string_view fields pointing into it, with no copies.
+
+#ifndef VC_VLIG_SCENE_PLAN_BINARY_CPP
+#define VC_VLIG_SCENE_PLAN_BINARY_CPP
+
+#include "vlig_semantic_guided_router.cpp"
+
+#include <string_view>
+
+namespace vc_vlig {
+
+static_assert(static_cast<int>(VCIGMode::Outpaint) == 3, "VCIGMode wire values changed");
+static_assert(static_cast<int>(VCSafetyProfile::AllowNSFW) == 1, "VCSafetyProfile wire values changed");
+static_assert(static_cast<int>(VCQualityPreset::Ultra) == 3, "VCQualityPreset wire values changed");
+static_assert(static_cast<int>(VCColorTone::Pastel) == 4, "VCColorTone wire values changed");
+static_assert(static_cast<int>(VCLighting::Studio) == 4, "VCLighting wire values changed");
+static_assert(static_cast<int>(VCCameraAngle::WideShot) == 6, "VCCameraAngle wire values changed");
+static_assert(static_cast<int>(VCArtStyle::ConceptArt) == 8, "VCArtStyle wire values changed");
+static_assert(static_cast<int>(VCCompositionRule::LeadingLines) == 5, "VCCompositionRule wire values changed");
+static_assert(static_cast<int>(VCAspectRatio::Ratio_21_9) == 5, "VCAspectRatio wire values changed");
+static_assert(static_cast<int>(VCBrushDetail::Hyper) == 4, "VCBrushDetail wire values changed");
+
+static constexpr uint16_t kScenePlanBinaryVersion = 1;
+static constexpr std::size_t kScenePlanBinaryHeaderSize = 32;
+
+// Offset-table slots of the fixed string fields; secondary subject i uses
+// kCount + 3 * i + {0: name, 1: attributes, 2: position hint}.
+enum class VCPlanStringSlot : uint16_t {
+    CorePrompt,
+    PrimaryName,
+    PrimaryAttributes,
+    PrimaryPosition,
+    Environment,
+    TimeOfDay,
+    Weather,
+    PaletteHint,
+    EraHint,
+    VisualArtifacts,
+    ContentExclusions,
+    Count
+};
+
+static constexpr std::size_t kPlanFixedStrings = static_cast<std::size_t>(VCPlanStringSlot::Count);
+
+static inline void storeLE16(uint8_t *p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static inline void storeLE32(uint8_t *p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+static inline uint16_t loadLE16(const uint8_t *p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t loadLE32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static void collectPlanStrings(const VCScenePlan &p, std::vector<const std::string *> &out) {
+    out.clear();
+    out.push_back(&p.corePrompt);
+    out.push_back(&p.primarySubject.name);
+    out.push_back(&p.primarySubject.attributes);
+    out.push_back(&p.primarySubject.positionHint);
+    out.push_back(&p.background.environment);
+    out.push_back(&p.background.timeOfDay);
+    out.push_back(&p.background.weather);
+    out.push_back(&p.colorLighting.paletteHint);
+    out.push_back(&p.artStyle.eraHint);
+    out.push_back(&p.negatives.visualArtifacts);
+    out.push_back(&p.negatives.contentExclusions);
+    for (const auto &s : p.secondarySubjects) {
+        out.push_back(&s.name);
+        out.push_back(&s.attributes);
+        out.push_back(&s.positionHint);
+    }
+}
+
+// Encodes into `out`, replacing its contents; reuse the same vector across
+// calls to keep its capacity. The output size is computed exactly up front.
+static void encodeScenePlanBinary(const VCScenePlan &p, std::vector<uint8_t> &out) {
+    if (p.secondarySubjects.size() > (0xFFFFu - kPlanFixedStrings) / 3)
+        throw std::length_error("too many secondary subjects for binary plan");
+    thread_local std::vector<const std::string *> strings;
+    collectPlanStrings(p, strings);
+
+    std::size_t total = kScenePlanBinaryHeaderSize + 4 * strings.size();
+    for (const std::string *s : strings)
+        total += 4 + s->size();
+    if (total > 0xFFFFFFFFu)
+        throw std::length_error("binary plan exceeds 4 GiB");
+
+    out.resize(total);
+    uint8_t *b = out.data();
+    std::memcpy(b, "VCSP", 4);
+    storeLE16(b + 4, kScenePlanBinaryVersion);
+    storeLE16(b + 6, static_cast<uint16_t>(kScenePlanBinaryHeaderSize));
+    storeLE32(b + 8, static_cast<uint32_t>(total));
+    b[12] = static_cast<uint8_t>(p.aspectRatio);
+    b[13] = static_cast<uint8_t>(p.mode);
+    b[14] = static_cast<uint8_t>(p.safety);
+    b[15] = static_cast<uint8_t>(p.quality);
+    b[16] = static_cast<uint8_t>(p.colorLighting.colorTone);
+    b[17] = static_cast<uint8_t>(p.colorLighting.lighting);
+    b[18] = static_cast<uint8_t>(p.camera.angle);
+    b[19] = static_cast<uint8_t>(p.composition.rule);
+    b[20] = static_cast<uint8_t>(p.artStyle.style);
+    b[21] = static_cast<uint8_t>(p.artStyle.brushDetail);
+    b[22] = static_cast<uint8_t>((p.camera.depthOfField ? 1u : 0u) |
+                                 (p.composition.allowCropping ? 2u : 0u) |
+                                 (p.composition.centerMainSubject ? 4u : 0u));
+    b[23] = 0;
+    uint32_t focalBits;
+    static_assert(sizeof(float) == 4, "IEEE-754 single precision expected");
+    std::memcpy(&focalBits, &p.camera.focalLengthMM, 4);
+    storeLE32(b + 24, focalBits);
+    storeLE16(b + 28, static_cast<uint16_t>(strings.size()));
+    storeLE16(b + 30, static_cast<uint16_t>(p.secondarySubjects.size()));
+
+    uint8_t *table = b + kScenePlanBinaryHeaderSize;
+    std::size_t pos = kScenePlanBinaryHeaderSize + 4 * strings.size();
+    for (std::size_t i = 0; i < strings.size(); ++i) {
+        const std::string &s = *strings[i];
+        storeLE32(table + 4 * i, static_cast<uint32_t>(pos));
+        storeLE32(b + pos, static_cast<uint32_t>(s.size()));
+        if (!s.empty())
+            std::memcpy(b + pos + 4, s.data(), s.size());
+        pos += 4 + s.size();
+    }
+}
+
+static std::vector<uint8_t> encodeScenePlanBinary(const VCScenePlan &p) {
+    std::vector<uint8_t> out;
+    encodeScenePlanBinary(p, out);
+    return out;
+}
+
+struct VCSubjectBinaryView {
+    std::string_view name;
+    std::string_view attributes;
+    std::string_view positionHint;
+};
+
+// Zero-copy reader. The buffer must outlive the view and every string_view
+// taken from it.
+class VCScenePlanBinaryView {
+public:
+    // Validates header, enum ranges, table and every record against `size`;
+    // throws std::runtime_error on anything malformed.
+    static VCScenePlanBinaryView open(const void *data, std::size_t size) {
+        const uint8_t *b = static_cast<const uint8_t *>(data);
+        if (size < kScenePlanBinaryHeaderSize || std::memcmp(b, "VCSP", 4) != 0)
+            throw std::runtime_error("binary plan: bad magic");
+        if (loadLE16(b + 4) != kScenePlanBinaryVersion)
+            throw std::runtime_error("binary plan: unsupported version");
+        if (loadLE16(b + 6) != kScenePlanBinaryHeaderSize)
+            throw std::runtime_error("binary plan: bad header size");
+        if (loadLE32(b + 8) != size)
+            throw std::runtime_error("binary plan: size mismatch");
+
+        static const uint8_t kEnumMax[10] = {
+            static_cast<uint8_t>(VCAspectRatio::Ratio_21_9),
+            static_cast<uint8_t>(VCIGMode::Outpaint),
+            static_cast<uint8_t>(VCSafetyProfile::AllowNSFW),
+            static_cast<uint8_t>(VCQualityPreset::Ultra),
+            static_cast<uint8_t>(VCColorTone::Pastel),
+            static_cast<uint8_t>(VCLighting::Studio),
+            static_cast<uint8_t>(VCCameraAngle::WideShot),
+            static_cast<uint8_t>(VCCompositionRule::LeadingLines),
+            static_cast<uint8_t>(VCArtStyle::ConceptArt),
+            static_cast<uint8_t>(VCBrushDetail::Hyper)
+        };
+        for (int i = 0; i < 10; ++i) {
+            if (b[12 + i] > kEnumMax[i])
+                throw std::runtime_error("binary plan: enum out of range");
+        }
+        if ((b[22] & ~7u) != 0 || b[23] != 0)
+            throw std::runtime_error("binary plan: reserved bits set");
+
+        const std::size_t count = loadLE16(b + 28);
+        const std::size_t secondary = loadLE16(b + 30);
+        if (count != kPlanFixedStrings + 3 * secondary)
+            throw std::runtime_error("binary plan: bad string count");
+        const std::size_t tableEnd = kScenePlanBinaryHeaderSize + 4 * count;
+        if (tableEnd > size)
+            throw std::runtime_error("binary plan: truncated offset table");
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::size_t off = loadLE32(b + kScenePlanBinaryHeaderSize + 4 * i);
+            if (off < tableEnd || off > size - 4 || loadLE32(b + off) > size - 4 - off)
+                throw std::runtime_error("binary plan: string record out of bounds");
+        }
+        return VCScenePlanBinaryView(b, count, secondary);
+    }
+
+    VCAspectRatio aspectRatio() const { return static_cast<VCAspectRatio>(b_[12]); }
+    VCIGMode mode() const { return static_cast<VCIGMode>(b_[13]); }
+    VCSafetyProfile safety() const { return static_cast<VCSafetyProfile>(b_[14]); }
+    VCQualityPreset quality() const { return static_cast<VCQualityPreset>(b_[15]); }
+    VCColorTone colorTone() const { return static_cast<VCColorTone>(b_[16]); }
+    VCLighting lighting() const { return static_cast<VCLighting>(b_[17]); }
+    VCCameraAngle cameraAngle() const { return static_cast<VCCameraAngle>(b_[18]); }
+    VCCompositionRule compositionRule() const { return static_cast<VCCompositionRule>(b_[19]); }
+    VCArtStyle artStyle() const { return static_cast<VCArtStyle>(b_[20]); }
+    VCBrushDetail brushDetail() const { return static_cast<VCBrushDetail>(b_[21]); }
+    bool depthOfField() const { return (b_[22] & 1u) != 0; }
+    bool allowCropping() const { return (b_[22] & 2u) != 0; }
+    bool centerMainSubject() const { return (b_[22] & 4u) != 0; }
+
+    float focalLengthMM() const {
+        const uint32_t bits = loadLE32(b_ + 24);
+        float f;
+        std::memcpy(&f, &bits, 4);
+        return f;
+    }
+
+    std::string_view string(VCPlanStringSlot slot) const {
+        return stringAt(static_cast<std::size_t>(slot));
+    }
+
+    std::string_view corePrompt() const { return string(VCPlanStringSlot::CorePrompt); }
+
+    VCSubjectBinaryView primarySubject() const {
+        return {string(VCPlanStringSlot::PrimaryName), string(VCPlanStringSlot::PrimaryAttributes),
+                string(VCPlanStringSlot::PrimaryPosition)};
+    }
+
+    std::size_t secondaryCount() const { return secondary_; }
+
+    VCSubjectBinaryView secondarySubject(std::size_t i) const {
+        const std::size_t base = kPlanFixedStrings + 3 * i;
+        return {stringAt(base), stringAt(base + 1), stringAt(base + 2)};
+    }
+
+    // Materializes an owning plan (copies every string).
+    VCScenePlan toScenePlan() const {
+        VCScenePlan p;
+        p.corePrompt = std::string(corePrompt());
+        p.primarySubject = toSubject(primarySubject());
+        p.secondarySubjects.reserve(secondary_);
+        for (std::size_t i = 0; i < secondary_; ++i)
+            p.secondarySubjects.push_back(toSubject(secondarySubject(i)));
+        p.background.environment = std::string(string(VCPlanStringSlot::Environment));
+        p.background.timeOfDay = std::string(string(VCPlanStringSlot::TimeOfDay));
+        p.background.weather = std::string(string(VCPlanStringSlot::Weather));
+        p.colorLighting.colorTone = colorTone();
+        p.colorLighting.lighting = lighting();
+        p.colorLighting.paletteHint = std::string(string(VCPlanStringSlot::PaletteHint));
+        p.camera.angle = cameraAngle();
+        p.camera.focalLengthMM = focalLengthMM();
+        p.camera.depthOfField = depthOfField();
+        p.composition.rule = compositionRule();
+        p.composition.allowCropping = allowCropping();
+        p.composition.centerMainSubject = centerMainSubject();
+        p.artStyle.style = artStyle();
+        p.artStyle.brushDetail = brushDetail();
+        p.artStyle.eraHint = std::string(string(VCPlanStringSlot::EraHint));
+        p.negatives.visualArtifacts = std::string(string(VCPlanStringSlot::VisualArtifacts));
+        p.negatives.contentExclusions = std::string(string(VCPlanStringSlot::ContentExclusions));
+        p.aspectRatio = aspectRatio();
+        p.mode = mode();
+        p.safety = safety();
+        p.quality = quality();
+        return p;
+    }
+
+private:
+    const uint8_t *b_;
+    std::size_t count_;
+    std::size_t secondary_;
+
+    VCScenePlanBinaryView(const uint8_t *b, std::size_t count, std::size_t secondary)
+        : b_(b), count_(count), secondary_(secondary) {}
+
+    std::string_view stringAt(std::size_t i) const {
+        const std::size_t off = loadLE32(b_ + kScenePlanBinaryHeaderSize + 4 * i);
+        return std::string_view(reinterpret_cast<const char *>(b_ + off + 4), loadLE32(b_ + off));
+    }
+
+    static VCSubjectDescriptor toSubject(const VCSubjectBinaryView &v) {
+        VCSubjectDescriptor s;
+        s.name = std::string(v.name);
+        s.attributes = std::string(v.attributes);
+        s.positionHint = std::string(v.positionHint);
+        return s;
+    }
+};
+
+} // namespace vc_vlig
+
+#ifdef VC_VLIG_SCENE_PLAN_BINARY_DEMO
+#include <chrono>
+
+int main() {
+    using namespace vc_vlig;
+    VCSemanticIGResult res = BuildSemanticIGSpec(
+        "Ultra-detailed cinematic portrait of a lone astronaut standing in a "
+        "foggy forest at sunset, teal and orange color grade, soft lighting, "
+        "shot on a 50mm lens, rule of thirds composition, 16:9.",
+        VCIGMode::TextToImage, VCSafetyProfile::Safe, VCQualityPreset::High);
+
+    std::vector<uint8_t> bin;
+    std::string json;
+    const int iters = 200000;
+    std::size_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i) {
+        encodeScenePlanBinary(res.scene, bin);
+        VCScenePlanBinaryView v = VCScenePlanBinaryView::open(bin.data(), bin.size());
+        sink += v.corePrompt().size() + static_cast<std::size_t>(v.compositionRule());
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i) {
+        serializeScenePlanToJSON(res.scene, json);
+        sink += json.size();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    // Round trip through a fresh buffer; it must hold the same bytes as the
+    // reused one.
+    const std::vector<uint8_t> fresh = encodeScenePlanBinary(res.scene);
+    VCScenePlanBinaryView v = VCScenePlanBinaryView::open(fresh.data(), fresh.size());
+    std::string roundTrip;
+    serializeScenePlanToJSON(v.toScenePlan(), roundTrip);
+    const bool ok = fresh == bin && roundTrip == res.jsonControl;
+
+    const double binNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+    const double jsonNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / iters;
+    std::cout << "binary: " << bin.size() << " bytes, encode+open " << binNs << " ns\n";
+    std::cout << "json:   " << json.size() << " bytes, serialize " << jsonNs << " ns\n";
+    std::cout << "round trip " << (ok ? "matches" : "DIFFERS") << " (" << sink % 10 << ")\n";
+    return ok ? 0 : 1;
+}
+#endif
+
+#endif // VC_VLIG_SCENE_PLAN_BINARY_CPP
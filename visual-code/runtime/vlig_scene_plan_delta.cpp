@@ -0,0 +1,425 @@
+// File: /visual-code/runtime/vlig_scene_plan_delta.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS NDK
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Multi-turn refinement of a scene plan. A follow-up such as "make it
+//   night" or "wider" is not re-planned from scratch. It is sanitized and
+//   scanned on its own, and only the descriptors whose keywords it mentions
+//   are re-evaluated (time of day, aspect ratio, ...). Everything else
+//   carries over from the previous plan, including edits an earlier patch
+//   made. The follow-up text is appended to the core prompt so the
+//   generator still sees the wording.
+//
+//   The change goes downstream as a scene patch against the previous control
+//   JSON, not the whole spec. Format "vc-scene-patch/1":
+//   - the first member is "patch_format":"vc-scene-patch/1";
+//   - then the changed members only, under the canonical control JSON key
+//     names, nested objects only where one of their members changed, and
+//     secondary_subjects whole when it changed;
+//   - a core prompt that only grew at the end is sent as core_prompt_append
+//     with the added text. Any other change to it (for example the
+//     8000-byte cap cutting into it) sends core_prompt in full.
+//   Apart from core_prompt_append this is JSON Merge Patch (RFC 7396), but
+//   it is not one: a generic merge-patch applier would store
+//   core_prompt_append as a member and leave core_prompt stale. Resending the
+//   whole prompt instead would make the patch grow with the conversation.
+//   Receivers apply it with applyScenePlanPatch, which rejects a patch with
+//   a missing or different patch_format before changing anything, and
+//   parseScenePlanJSON rejects a scene patch passed as control JSON.
+
+#ifndef VC_VLIG_SCENE_PLAN_DELTA_CPP
+#define VC_VLIG_SCENE_PLAN_DELTA_CPP
+
+#include "vlig_semantic_guided_router.cpp"
+#include "vlig_scene_plan_json_parser.cpp"
+
+namespace vc_vlig {
+
+// Keywords each descriptor is derived from (see the guess* functions and
+// buildScenePlanView); a follow-up re-evaluates a descriptor only if it
+// hits one of them.
+static constexpr VCKeywordHits keywordMask(std::initializer_list<VCKeyword> ks) {
+    VCKeywordHits m;
+    for (VCKeyword k : ks)
+        m.set(k);
+    return m;
+}
+
+static constexpr bool hitsAny(const VCKeywordHits &a, const VCKeywordHits &b) {
+    return ((a.bits[0] & b.bits[0]) | (a.bits[1] & b.bits[1])) != 0;
+}
+
+static constexpr VCKeywordHits kAspectKeywords = keywordMask({
+    VCKeyword::Vertical, VCKeyword::Portrait, VCKeyword::Ratio_9_16, VCKeyword::Cinematic,
+    VCKeyword::Wide, VCKeyword::Ratio_16_9, VCKeyword::Ratio_21_9, VCKeyword::Ratio_4_3,
+    VCKeyword::Ratio_3_4});
+static constexpr VCKeywordHits kArtStyleKeywords = keywordMask({
+    VCKeyword::Photo, VCKeyword::Photoreal, VCKeyword::Realistic, VCKeyword::Anime,
+    VCKeyword::Manga, VCKeyword::Watercolor, VCKeyword::Pixel, VCKeyword::LineArt,
+    VCKeyword::Sketch, VCKeyword::LowPoly, VCKeyword::LowPolyHyphen, VCKeyword::ConceptArt,
+    VCKeyword::KeyArt, VCKeyword::Painting, VCKeyword::DigitalPainting});
+static constexpr VCKeywordHits kLightingKeywords = keywordMask({
+    VCKeyword::SoftLight, VCKeyword::SoftLighting, VCKeyword::Dramatic,
+    VCKeyword::CinematicLight, VCKeyword::Studio, VCKeyword::ThreePoint, VCKeyword::HardLight});
+static constexpr VCKeywordHits kColorToneKeywords = keywordMask({
+    VCKeyword::TealAndOrange, VCKeyword::Warm, VCKeyword::Sunset, VCKeyword::Cool,
+    VCKeyword::Blueish, VCKeyword::Pastel, VCKeyword::HighContrast, VCKeyword::Noir});
+static constexpr VCKeywordHits kCameraKeywords = keywordMask({
+    VCKeyword::TopDownHyphen, VCKeyword::TopDown, VCKeyword::BirdsEye, VCKeyword::CloseUpHyphen,
+    VCKeyword::CloseUp, VCKeyword::PortraitShot, VCKeyword::WideShot, VCKeyword::WideAngle,
+    VCKeyword::LowAngle, VCKeyword::HighAngle, VCKeyword::Isometric});
+static constexpr VCKeywordHits kCompositionKeywords = keywordMask({
+    VCKeyword::RuleOfThirds, VCKeyword::Centered, VCKeyword::Symmetrical, VCKeyword::Symmetry,
+    VCKeyword::GoldenRatio, VCKeyword::LeadingLines, VCKeyword::Symmetric});
+static constexpr VCKeywordHits kEnvironmentKeywords = keywordMask({
+    VCKeyword::Forest, VCKeyword::City, VCKeyword::Space, VCKeyword::Galaxy, VCKeyword::Nebula,
+    VCKeyword::Beach, VCKeyword::Ocean, VCKeyword::Sea});
+static constexpr VCKeywordHits kTimeOfDayKeywords = keywordMask({
+    VCKeyword::Sunset, VCKeyword::Night, VCKeyword::Dawn, VCKeyword::Sunrise});
+static constexpr VCKeywordHits kWeatherKeywords = keywordMask({
+    VCKeyword::Rain, VCKeyword::Fog, VCKeyword::Mist, VCKeyword::Snow});
+
+// Applies `followUp` to `prev`, writing the refined plan to `next`. Throws
+// like BuildSemanticIGSpec if the follow-up is empty after sanitizing.
+static void refineScenePlan(const VCScenePlan &prev, const std::string &followUp,
+                            VCScenePlan &next) {
+    thread_local VCSanitizedPrompt prompt;
+    sanitizeAndScanPrompt(followUp, prompt);
+    const VCKeywordHits &hits = prompt.hits;
+    // Descriptors are fixed strings, not views into the follow-up, so a
+    // view over it is a cheap way to reuse the planner's decisions.
+    const VCScenePlanView f = buildScenePlanView(prompt, prev.mode, prev.safety, prev.quality);
+
+    if (&next != &prev)
+        next = prev;
+
+    // Same cap and character-boundary rule as finishScannedPrompt.
+    std::string &core = next.corePrompt;
+    std::string_view add = prompt.buffers.text;
+    while (!add.empty() && add.front() == ' ')
+        add.remove_prefix(1);
+    if (!add.empty()) {
+        if (!core.empty())
+            core.append(", ");
+        core.append(add.data(), add.size());
+        if (core.size() > 8000) {
+            std::size_t cut = 8000;
+            while (cut > 0 && (static_cast<unsigned char>(core[cut]) & 0xC0) == 0x80)
+                --cut;
+            core.resize(cut);
+        }
+    }
+
+    if (hitsAny(hits, kAspectKeywords))
+        next.aspectRatio = f.aspectRatio;
+    if (hitsAny(hits, kArtStyleKeywords))
+        next.artStyle.style = f.artStyle.style;
+    if (hitsAny(hits, kLightingKeywords))
+        next.colorLighting.lighting = f.colorLighting.lighting;
+    if (hitsAny(hits, kColorToneKeywords))
+        next.colorLighting.colorTone = f.colorLighting.colorTone;
+    if (hitsAny(hits, kCameraKeywords))
+        next.camera = f.camera;
+    if (hitsAny(hits, kCompositionKeywords))
+        next.composition.rule = f.composition.rule;
+    if (hitsAny(hits, kEnvironmentKeywords))
+        next.background.environment.assign(f.background.environment.data(),
+                                           f.background.environment.size());
+    if (hitsAny(hits, kTimeOfDayKeywords))
+        next.background.timeOfDay.assign(f.background.timeOfDay.data(),
+                                         f.background.timeOfDay.size());
+    if (hitsAny(hits, kWeatherKeywords))
+        next.background.weather.assign(f.background.weather.data(),
+                                       f.background.weather.size());
+}
+
+// Writes object members with the canonical key names, opening nested
+// objects only once a member inside them is written.
+class VCScenePatchWriter {
+public:
+    explicit VCScenePatchWriter(VCJsonWriter &w) : w_(w) {}
+
+    void key(VCControlKey k) {
+        if (!first_)
+            w_.literal(",");
+        first_ = false;
+        ++written_;
+        w_.quoted(kControlKeyNames[static_cast<int>(k)]);
+        w_.literal(":");
+    }
+
+    void text(VCControlKey k, const std::string &a, const std::string &b) {
+        if (a == b) return;
+        key(k);
+        w_.string(b);
+    }
+
+    template <class E>
+    void enumeration(VCControlKey k, E a, E b) {
+        if (a == b) return;
+        key(k);
+        w_.quoted(toString(b));
+    }
+
+    void boolean(VCControlKey k, bool a, bool b) {
+        if (a == b) return;
+        key(k);
+        w_.boolean(b);
+    }
+
+    void number(VCControlKey k, float a, float b) {
+        if (a == b) return;
+        key(k);
+        w_.number(b);
+    }
+
+    // Runs body() inside "k":{...} if `any`.
+    template <class Body>
+    void object(VCControlKey k, bool any, Body &&body) {
+        if (!any) return;
+        key(k);
+        w_.literal("{");
+        first_ = true;
+        body();
+        w_.literal("}");
+        first_ = false;
+    }
+
+    // Members written so far, nested ones included.
+    std::size_t written() const { return written_; }
+
+private:
+    VCJsonWriter &w_;
+    bool first_ = true;
+    std::size_t written_ = 0;
+};
+
+static bool sameSubject(const VCSubjectDescriptor &a, const VCSubjectDescriptor &b) {
+    return a.name == b.name && a.attributes == b.attributes && a.positionHint == b.positionHint;
+}
+
+// Appends the scene patch that turns `from`'s control JSON into `to`'s; just
+// the patch_format member if they are equal. Returns false for the empty
+// patch.
+static bool appendScenePlanPatch(const VCScenePlan &from, const VCScenePlan &to,
+                                      std::string &out) {
+    using K = VCControlKey;
+    VCJsonWriter w(out, 256 + to.corePrompt.size() + to.corePrompt.size() / 8);
+    VCScenePatchWriter m(w);
+    w.literal("{");
+    m.key(K::PatchFormat);
+    w.quoted(kScenePatchFormat);
+    const std::string &fromCore = from.corePrompt, &toCore = to.corePrompt;
+    if (toCore.size() > fromCore.size() && toCore.compare(0, fromCore.size(), fromCore) == 0) {
+        m.key(K::CorePromptAppend);
+        w.string(std::string_view(toCore).substr(fromCore.size()));
+    } else {
+        m.text(K::CorePrompt, fromCore, toCore);
+    }
+    m.enumeration(K::Mode, from.mode, to.mode);
+    m.enumeration(K::SafetyProfile, from.safety, to.safety);
+    m.enumeration(K::QualityPreset, from.quality, to.quality);
+    m.enumeration(K::AspectRatio, from.aspectRatio, to.aspectRatio);
+
+    const VCSubjectDescriptor &ps = from.primarySubject, &pt = to.primarySubject;
+    m.object(K::PrimarySubject, !sameSubject(ps, pt), [&] {
+        m.text(K::Name, ps.name, pt.name);
+        m.text(K::Attributes, ps.attributes, pt.attributes);
+        m.text(K::PositionHint, ps.positionHint, pt.positionHint);
+    });
+
+    bool subjectsChanged = from.secondarySubjects.size() != to.secondarySubjects.size();
+    for (std::size_t i = 0; !subjectsChanged && i < to.secondarySubjects.size(); ++i)
+        subjectsChanged = !sameSubject(from.secondarySubjects[i], to.secondarySubjects[i]);
+    if (subjectsChanged) {
+        m.key(K::SecondarySubjects);
+        w.literal("[");
+        for (std::size_t i = 0; i < to.secondarySubjects.size(); ++i) {
+            if (i != 0)
+                w.literal(",");
+            writeSubjectJSON(w, to.secondarySubjects[i]);
+        }
+        w.literal("]");
+    }
+
+    const VCBackgroundDescriptor &bs = from.background, &bt = to.background;
+    m.object(K::Background,
+             bs.environment != bt.environment || bs.timeOfDay != bt.timeOfDay ||
+                 bs.weather != bt.weather,
+             [&] {
+                 m.text(K::Environment, bs.environment, bt.environment);
+                 m.text(K::TimeOfDay, bs.timeOfDay, bt.timeOfDay);
+                 m.text(K::Weather, bs.weather, bt.weather);
+             });
+
+    const VCColorLightingDescriptor &cs = from.colorLighting, &ct = to.colorLighting;
+    m.object(K::ColorLighting,
+             cs.colorTone != ct.colorTone || cs.lighting != ct.lighting ||
+                 cs.paletteHint != ct.paletteHint,
+             [&] {
+                 m.enumeration(K::ColorTone, cs.colorTone, ct.colorTone);
+                 m.enumeration(K::Lighting, cs.lighting, ct.lighting);
+                 m.text(K::PaletteHint, cs.paletteHint, ct.paletteHint);
+             });
+
+    const VCCameraDescriptor &as = from.camera, &at = to.camera;
+    m.object(K::Camera,
+             as.angle != at.angle || as.focalLengthMM != at.focalLengthMM ||
+                 as.depthOfField != at.depthOfField,
+             [&] {
+                 m.enumeration(K::Angle, as.angle, at.angle);
+                 m.number(K::FocalLengthMM, as.focalLengthMM, at.focalLengthMM);
+                 m.boolean(K::DepthOfField, as.depthOfField, at.depthOfField);
+             });
+
+    const VCCompositionDescriptor &os = from.composition, &ot = to.composition;
+    m.object(K::Composition,
+             os.rule != ot.rule || os.allowCropping != ot.allowCropping ||
+                 os.centerMainSubject != ot.centerMainSubject,
+             [&] {
+                 m.enumeration(K::Rule, os.rule, ot.rule);
+                 m.boolean(K::AllowCropping, os.allowCropping, ot.allowCropping);
+                 m.boolean(K::CenterMainSubject, os.centerMainSubject, ot.centerMainSubject);
+             });
+
+    const VCArtStyleDescriptor &ss = from.artStyle, &st = to.artStyle;
+    m.object(K::ArtStyle,
+             ss.style != st.style || ss.brushDetail != st.brushDetail || ss.eraHint != st.eraHint,
+             [&] {
+                 m.enumeration(K::Style, ss.style, st.style);
+                 m.enumeration(K::BrushDetail, ss.brushDetail, st.brushDetail);
+                 m.text(K::EraHint, ss.eraHint, st.eraHint);
+             });
+
+    const VCNegativeConstraints &ns = from.negatives, &nt = to.negatives;
+    m.object(K::NegativeConstraints,
+             ns.visualArtifacts != nt.visualArtifacts ||
+                 ns.contentExclusions != nt.contentExclusions,
+             [&] {
+                 m.text(K::VisualArtifacts, ns.visualArtifacts, nt.visualArtifacts);
+                 m.text(K::ContentExclusions, ns.contentExclusions, nt.contentExclusions);
+             });
+
+    const bool changed = m.written() > 1;
+    w.literal("}");
+    w.finish();
+    return changed;
+}
+
+// Receiver side: applies a patch from appendScenePlanPatch to `plan` in
+// place.
+static void applyScenePlanPatch(VCScenePlan &plan, const std::string &patch) {
+    parseScenePlanPatch(patch.data(), patch.size(), plan);
+}
+
+struct VCScenePlanRefinement {
+    VCScenePlan scene;
+    std::string jsonPatch;  // vc-scene-patch/1 from the previous control JSON
+};
+
+static VCScenePlanRefinement RefineSemanticIGSpec(const VCScenePlan &previous,
+                                                  const std::string &followUp) {
+    VCScenePlanRefinement r;
+    refineScenePlan(previous, followUp, r.scene);
+    appendScenePlanPatch(previous, r.scene, r.jsonPatch);
+    return r;
+}
+
+} // namespace vc_vlig
+
+#ifdef VC_VLIG_SCENE_PLAN_DELTA_DEMO
+#include <chrono>
+
+int main() {
+    using namespace vc_vlig;
+    VCSemanticIGResult first = BuildSemanticIGSpec(
+        "Ultra-detailed cinematic portrait of a lone astronaut standing in a foggy forest at "
+        "sunset, teal and orange color grade, soft lighting, rule of thirds, 16:9.",
+        VCIGMode::TextToImage, VCSafetyProfile::Safe, VCQualityPreset::High);
+    std::cout << "turn 1: full spec " << first.jsonControl.size() << " bytes\n";
+
+    const char *followUps[] = {"make it night", "wider", "now in watercolor, with snow",
+                               "close-up on the helmet"};
+    VCScenePlan sender = first.scene;    // gateway's copy
+    VCScenePlan receiver = parseScenePlanJSON(first.jsonControl);  // adapter's copy
+    bool ok = true;
+    int turn = 2;
+    std::string full, got;
+    for (const char *f : followUps) {
+        VCScenePlanRefinement r = RefineSemanticIGSpec(sender, f);
+        applyScenePlanPatch(receiver, r.jsonPatch);
+        serializeScenePlanToJSON(r.scene, full);
+        serializeScenePlanToJSON(receiver, got);
+        const bool same = got == full;
+        ok = ok && same;
+        std::cout << "turn " << turn++ << " \"" << f << "\": patch " << r.jsonPatch.size()
+                  << " bytes vs full " << full.size() << (same ? "" : "  RECEIVER DIFFERS")
+                  << "\n  " << r.jsonPatch << "\n";
+        sender = std::move(r.scene);
+    }
+
+    // The patch must not grow with the conversation: over many turns it stays
+    // within a fixed bound while the full spec keeps growing.
+    const std::size_t kPatchBound = 256;
+    std::size_t maxPatch = 0;
+    for (int i = 0; i < 64; ++i) {
+        const char *f = followUps[i % 4];
+        VCScenePlanRefinement r = RefineSemanticIGSpec(sender, f);
+        applyScenePlanPatch(receiver, r.jsonPatch);
+        serializeScenePlanToJSON(r.scene, full);
+        serializeScenePlanToJSON(receiver, got);
+        ok = ok && got == full;
+        maxPatch = std::max(maxPatch, r.jsonPatch.size());
+        sender = std::move(r.scene);
+    }
+    const bool bounded = maxPatch <= kPatchBound;
+    ok = ok && bounded;
+    std::cout << "64 more turns: largest patch " << maxPatch << " bytes (bound " << kPatchBound
+              << "), full spec now " << full.size() << " bytes"
+              << (bounded ? "" : "  PATCH UNBOUNDED") << "\n";
+
+    // A receiver that cannot read the patch must reject it, not apply part of it.
+    auto rejected = [&](auto &&apply) {
+        const VCScenePlan before = receiver;
+        try {
+            apply();
+        } catch (const std::runtime_error &e) {
+            std::cout << "  rejected: " << e.what() << "\n";
+            serializeScenePlanToJSON(before, full);
+            serializeScenePlanToJSON(receiver, got);
+            return got == full;
+        }
+        return false;
+    };
+    const std::string patch = RefineSemanticIGSpec(sender, "make it night").jsonPatch;
+    const std::size_t body = patch.find(',');
+    const std::string unversioned = "{" + patch.substr(body + 1);
+    const std::string future = "{\"patch_format\":\"vc-scene-patch/2\"" + patch.substr(body);
+    const bool strict =
+        rejected([&] { applyScenePlanPatch(receiver, unversioned); }) &&
+        rejected([&] { applyScenePlanPatch(receiver, future); }) &&
+        rejected([&] { parseScenePlanJSON(patch.data(), patch.size(), receiver); });
+    ok = ok && strict;
+    std::cout << "patches without vc-scene-patch/1 "
+              << (strict ? "rejected, plan untouched" : "NOT REJECTED") << "\n";
+
+    const int iters = 200000;
+    std::size_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i)
+        sink += RefineSemanticIGSpec(first.scene, "make it night").jsonPatch.size();
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; ++i)
+        sink += BuildSemanticIGSpec(first.scene.corePrompt + ", make it night",
+                                    VCIGMode::TextToImage, VCSafetyProfile::Safe,
+                                    VCQualityPreset::High).jsonControl.size();
+    auto t2 = std::chrono::steady_clock::now();
+    std::cout << "refine + patch: " << std::chrono::duration<double, std::nano>(t1 - t0).count() / iters
+              << " ns; re-plan + full JSON: "
+              << std::chrono::duration<double, std::nano>(t2 - t1).count() / iters << " ns ("
+              << sink % 10 << ")\n";
+    return ok ? 0 : 1;
+}
+#endif
+
+#endif // VC_VLIG_SCENE_PLAN_DELTA_CPP
@@ -0,0 +1,890 @@
+// File: /visual-code/runtime/vlig_scene_plan_json_parser.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS NDK; SSE2 / NEON / scalar
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Parser for the canonical control JSON (serializeScenePlanToJSON) back
+//   into a VCScenePlan, for gateways that receive specs from other services.
+//
+//   Two stages, after simdjson:
+//   1) Structural index. 64 bytes at a time the input is classified into
+//      bitmasks (quotes, backslashes, operators, whitespace, control bytes);
+//      escaped quotes are removed, a prefix-XOR turns the quote mask into an
+//      in-string mask, and the positions of every operator outside strings,
+//      every unescaped quote and every scalar start are written to an index.
+//   2) A recursive-descent walk over that index. Strings are the span
+//      between two consecutive quote entries, handed out as string_views
+//      into the input (escaped strings are decoded into a scratch buffer);
+//      keys and enum names resolve through compile-time perfect hashes built
+//      from the router's own toString tables.
+//
+//   Keys present overwrite the matching plan members, null resets a member
+//   to its default, unknown keys are skipped. parseScenePlanPatch applies a
+//   scene patch (vlig_scene_plan_delta.cpp) the same way; a patch must open
+//   with "patch_format":"vc-scene-patch/1" and may carry core_prompt_append,
+//   and control JSON carrying either key is rejected rather than half
+//   applied. Malformed input (bad UTF-8, control bytes, unterminated strings,
+//   bad escapes or numbers, unknown enum names) throws std::runtime_error
+//   with the byte offset.
+
+#ifndef VC_VLIG_SCENE_PLAN_JSON_PARSER_CPP
+#define VC_VLIG_SCENE_PLAN_JSON_PARSER_CPP
+
+#include "vlig_semantic_guided_router.cpp"
+
+#include <cstdlib>
+#include <string_view>
+
+#if defined(__PCLMUL__) && defined(VC_VLIG_SSE2)
+#include <wmmintrin.h>
+#define VC_VLIG_PCLMUL 1
+#endif
+
+namespace vc_vlig {
+
+// -----------------------------------------------------------------------------
+// Name tables
+// -----------------------------------------------------------------------------
+
+enum class VCControlKey : int {
+    CorePrompt,
+    Mode,
+    SafetyProfile,
+    QualityPreset,
+    AspectRatio,
+    PrimarySubject,
+    SecondarySubjects,
+    Background,
+    ColorLighting,
+    Camera,
+    Composition,
+    ArtStyle,
+    NegativeConstraints,
+    Name,
+    Attributes,
+    PositionHint,
+    Environment,
+    TimeOfDay,
+    Weather,
+    ColorTone,
+    Lighting,
+    PaletteHint,
+    Angle,
+    FocalLengthMM,
+    DepthOfField,
+    Rule,
+    AllowCropping,
+    CenterMainSubject,
+    Style,
+    BrushDetail,
+    EraHint,
+    VisualArtifacts,
+    ContentExclusions,
+    CorePromptAppend,  // scene patch only, see vlig_scene_plan_delta.cpp
+    PatchFormat,       // scene patch only
+    Count
+};
+
+// In VCControlKey order; spelled as serializeScenePlanToJSON writes them.
+static constexpr const char *kControlKeyNames[] = {
+    "core_prompt", "mode", "safety_profile", "quality_preset", "aspect_ratio",
+    "primary_subject", "secondary_subjects", "background", "color_lighting", "camera",
+    "composition", "art_style", "negative_constraints", "name", "attributes",
+    "position_hint", "environment", "time_of_day", "weather", "color_tone", "lighting",
+    "palette_hint", "angle", "focal_length_mm", "depth_of_field", "rule", "allow_cropping",
+    "center_main_subject", "style", "brush_detail", "era_hint", "visual_artifacts",
+    "content_exclusions", "core_prompt_append", "patch_format"
+};
+static_assert(sizeof(kControlKeyNames) / sizeof(kControlKeyNames[0]) ==
+                  static_cast<std::size_t>(VCControlKey::Count),
+              "kControlKeyNames out of sync with VCControlKey");
+
+static constexpr auto kControlKeyTable = vcMakePerfectHashTable<128>(kControlKeyNames);
+
+// Format and version a scene patch names in its leading patch_format member.
+static constexpr const char kScenePatchFormat[] = "vc-scene-patch/1";
+
+template <typename E, std::size_t N, std::size_t Slots>
+constexpr VCPerfectHashTable<N, Slots> vcEnumNameTable() {
+    const char *names[N] = {};
+    for (std::size_t i = 0; i < N; ++i)
+        names[i] = toString(static_cast<E>(i));
+    return vcMakePerfectHashTable<Slots>(names);
+}
+
+#define VC_VLIG_ENUM_TABLE(Enum, Last) \
+    vcEnumNameTable<Enum, static_cast<std::size_t>(Enum::Last) + 1, 16>()
+
+static constexpr auto kAspectRatioNames = VC_VLIG_ENUM_TABLE(VCAspectRatio, Ratio_21_9);
+static constexpr auto kIGModeNames = VC_VLIG_ENUM_TABLE(VCIGMode, Outpaint);
+static constexpr auto kSafetyProfileNames = VC_VLIG_ENUM_TABLE(VCSafetyProfile, AllowNSFW);
+static constexpr auto kQualityPresetNames = VC_VLIG_ENUM_TABLE(VCQualityPreset, Ultra);
+static constexpr auto kColorToneNames = VC_VLIG_ENUM_TABLE(VCColorTone, Pastel);
+static constexpr auto kLightingNames = VC_VLIG_ENUM_TABLE(VCLighting, Studio);
+static constexpr auto kCameraAngleNames = VC_VLIG_ENUM_TABLE(VCCameraAngle, WideShot);
+static constexpr auto kCompositionRuleNames = VC_VLIG_ENUM_TABLE(VCCompositionRule, LeadingLines);
+static constexpr auto kArtStyleNames = VC_VLIG_ENUM_TABLE(VCArtStyle, ConceptArt);
+static constexpr auto kBrushDetailNames = VC_VLIG_ENUM_TABLE(VCBrushDetail, Hyper);
+
+#undef VC_VLIG_ENUM_TABLE
+
+// -----------------------------------------------------------------------------
+// Stage 1: structural index
+// -----------------------------------------------------------------------------
+
+struct VCJsonBlockMasks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;         // { } [ ] : ,
+    uint64_t space;      // ' ' \t \n \r
+    uint64_t control;    // bytes < 0x20
+};
+
+#if defined(VC_VLIG_NEON)
+static inline uint64_t neonMask64(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d) {
+    static const uint8_t kBits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t bits = vld1q_u8(kBits);
+    uint8x16_t s0 = vpaddq_u8(vandq_u8(a, bits), vandq_u8(b, bits));
+    uint8x16_t s1 = vpaddq_u8(vandq_u8(c, bits), vandq_u8(d, bits));
+    s0 = vpaddq_u8(s0, s1);
+    s0 = vpaddq_u8(s0, s0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+#endif
+
+static inline void classifyJsonBlock(const char *p, VCJsonBlockMasks &m) {
+#if defined(VC_VLIG_SSE2)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i braceOpen = _mm_set1_epi8('{');    // '[' | 0x20 == '{'
+    const __m128i braceClose = _mm_set1_epi8('}');   // ']' | 0x20 == '}'
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i ctl = _mm_set1_epi8(0x1F);
+    m = VCJsonBlockMasks{0, 0, 0, 0, 0};
+    for (int q = 0; q < 4; ++q) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * q));
+        const __m128i folded = _mm_or_si128(v, caseBit);
+        const __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, braceOpen), _mm_cmpeq_epi8(folded, braceClose)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+        const __m128i space = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, cr)));
+        const int shift = 16 * q;
+        m.quote |= static_cast<uint64_t>(static_cast<uint32_t>(
+                       _mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+        m.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(
+                           _mm_movemask_epi8(_mm_cmpeq_epi8(v, bslash)))) << shift;
+        m.op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(op))) << shift;
+        m.space |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(space))) << shift;
+        m.control |= static_cast<uint64_t>(static_cast<uint32_t>(
+                         _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v)))) << shift;
+    }
+#elif defined(VC_VLIG_NEON)
+    uint8x16_t v[4];
+    for (int q = 0; q < 4; ++q)
+        v[q] = vld1q_u8(reinterpret_cast<const uint8_t *>(p + 16 * q));
+    uint8x16_t qm[4], bm[4], om[4], sm[4], cm[4];
+    for (int q = 0; q < 4; ++q) {
+        const uint8x16_t folded = vorrq_u8(v[q], vdupq_n_u8(0x20));
+        qm[q] = vceqq_u8(v[q], vdupq_n_u8('"'));
+        bm[q] = vceqq_u8(v[q], vdupq_n_u8('\\'));
+        om[q] = vorrq_u8(vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')),
+                                  vceqq_u8(folded, vdupq_n_u8('}'))),
+                         vorrq_u8(vceqq_u8(v[q], vdupq_n_u8(':')),
+                                  vceqq_u8(v[q], vdupq_n_u8(','))));
+        sm[q] = vorrq_u8(vorrq_u8(vceqq_u8(v[q], vdupq_n_u8(' ')), vceqq_u8(v[q], vdupq_n_u8('\t'))),
+                         vorrq_u8(vceqq_u8(v[q], vdupq_n_u8('\n')), vceqq_u8(v[q], vdupq_n_u8('\r'))));
+        cm[q] = vcltq_u8(v[q], vdupq_n_u8(0x20));
+    }
+    m.quote = neonMask64(qm[0], qm[1], qm[2], qm[3]);
+    m.backslash = neonMask64(bm[0], bm[1], bm[2], bm[3]);
+    m.op = neonMask64(om[0], om[1], om[2], om[3]);
+    m.space = neonMask64(sm[0], sm[1], sm[2], sm[3]);
+    m.control = neonMask64(cm[0], cm[1], cm[2], cm[3]);
+#else
+    m = VCJsonBlockMasks{0, 0, 0, 0, 0};
+    for (int i = 0; i < 64; ++i) {
+        const unsigned char c = static_cast<unsigned char>(p[i]);
+        const uint64_t bit = uint64_t{1} << i;
+        if (c == '"') m.quote |= bit;
+        if (c == '\\') m.backslash |= bit;
+        if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') m.op |= bit;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') m.space |= bit;
+        if (c < 0x20) m.control |= bit;
+    }
+#endif
+}
+
+// Bit i set if byte i (or any byte before it in this block) toggles: each
+// set bit flips the state for everything after it.
+static inline uint64_t prefixXor(uint64_t x) {
+#if defined(VC_VLIG_PCLMUL)
+    const __m128i r = _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<long long>(x)),
+                                           _mm_set1_epi8(static_cast<char>(0xFF)), 0);
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(r));
+#else
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+#endif
+}
+
+// Bytes escaped by an odd-length backslash run. `prevEscaped` carries a run
+// that ends exactly at the block boundary.
+static inline uint64_t findEscaped(uint64_t backslash, uint64_t &prevEscaped) {
+    const uint64_t evenBits = 0x5555555555555555ull;
+    backslash &= ~prevEscaped;
+    const uint64_t followsEscape = (backslash << 1) | prevEscaped;
+    const uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+    const uint64_t sum = oddStarts + backslash;
+    prevEscaped = sum < oddStarts ? 1u : 0u;
+    const uint64_t invertMask = sum << 1;
+    return (evenBits ^ invertMask) & followsEscape;
+}
+
+// Writes the structural positions of [data, data + len) into idx (resized as
+// needed, capacity kept across calls); returns how many there are.
+// `hasEscapes` reports whether any backslash occurs, so stage 2 can skip
+// per-string escape scanning for the common escape-free document.
+static std::size_t buildJsonStructuralIndex(const char *data, std::size_t len,
+                                            std::vector<uint32_t> &idx, bool &hasEscapes) {
+    if (len >= 0xFFFFFFFFu)
+        throw std::runtime_error("control JSON: document too large");
+    if (idx.size() < len + 1)
+        idx.resize(len + 1);
+    uint32_t *out = idx.data();
+    uint64_t prevEscaped = 0;
+    uint64_t prevInString = 0;
+    uint64_t prevScalar = 0;
+    uint64_t errors = 0;
+    uint64_t backslashes = 0;
+    char tail[64];
+    for (std::size_t base = 0; base < len; base += 64) {
+        const char *p = data + base;
+        if (len - base < 64) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, p, len - base);
+            p = tail;
+        }
+        VCJsonBlockMasks m;
+        classifyJsonBlock(p, m);
+        backslashes |= m.backslash;
+        const uint64_t quote = m.quote & ~findEscaped(m.backslash, prevEscaped);
+        const uint64_t inString = prefixXor(quote) ^ prevInString;
+        prevInString = 0 - (inString >> 63);
+        // Raw control bytes are invalid inside strings and, apart from
+        // whitespace, outside them.
+        errors |= m.control & (inString | ~m.space);
+        const uint64_t scalar = ~(m.op | m.space | quote) & ~inString;
+        const uint64_t scalarStart = scalar & ~((scalar << 1) | prevScalar);
+        prevScalar = scalar >> 63;
+        uint64_t s = (m.op & ~inString) | quote | scalarStart;
+        const uint32_t b32 = static_cast<uint32_t>(base);
+        while (s != 0) {
+            *out++ = b32 + countTrailingZeros64(s);
+            s &= s - 1;
+        }
+    }
+    if (prevInString != 0)
+        throw std::runtime_error("control JSON: unterminated string");
+    if (errors != 0)
+        throw std::runtime_error("control JSON: raw control character");
+    hasEscapes = backslashes != 0;
+    return static_cast<std::size_t>(out - idx.data());
+}
+
+// -----------------------------------------------------------------------------
+// Stage 2: index walk
+// -----------------------------------------------------------------------------
+
+class VCControlJSONParser {
+public:
+    VCControlJSONParser(const char *data, std::size_t len, const uint32_t *idx,
+                        std::size_t count, bool hasEscapes, std::string &scratch)
+        : d_(data), len_(len), idx_(idx), n_(count), hasEscapes_(hasEscapes), scratch_(scratch) {}
+
+    // `patch` selects scene patch input: patch_format first, then any
+    // control JSON key or core_prompt_append.
+    void parse(VCScenePlan &p, bool patch = false) {
+        if (peek() != '{')
+            fail("expected object");
+        patch_ = patch;
+        object(patch ? VCControlKey::PatchFormat : VCControlKey::CorePrompt,
+               [&](int key) { topLevel(key, p); });
+        if (patch_ && !formatSeen_)
+            fail("scene patch without patch_format");
+        if (k_ != n_)
+            fail("trailing content");
+    }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    const char *d_;
+    std::size_t len_;
+    const uint32_t *idx_;
+    std::size_t n_;
+    bool hasEscapes_;
+    std::string &scratch_;
+    std::size_t k_ = 0;
+    int depth_ = 0;
+    bool patch_ = false;
+    bool formatSeen_ = false;
+
+    [[noreturn]] void fail(const char *what) const {
+        const std::size_t at = k_ < n_ ? idx_[k_] : len_;
+        throw std::runtime_error(std::string("control JSON: ") + what + " at byte " +
+                                 std::to_string(at));
+    }
+
+    char peek() const { return k_ < n_ ? d_[idx_[k_]] : '\0'; }
+
+    void expect(char c, const char *what) {
+        if (peek() != c)
+            fail(what);
+        ++k_;
+    }
+
+    bool consumeIf(char c) {
+        if (peek() != c)
+            return false;
+        ++k_;
+        return true;
+    }
+
+    static bool isJsonSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    // String at the cursor. Views into the input unless it has escapes, in
+    // which case it views the scratch buffer (valid until the next escaped
+    // string).
+    std::string_view string() {
+        if (peek() != '"')
+            fail("expected string");
+        const std::size_t open = idx_[k_];
+        const std::size_t close = idx_[k_ + 1];  // stage 1 pairs every quote
+        k_ += 2;
+        const char *s = d_ + open + 1;
+        const std::size_t n = close - open - 1;
+        if (!hasEscapes_ || std::memchr(s, '\\', n) == nullptr)
+            return std::string_view(s, n);
+        return unescape(s, n);
+    }
+
+    // Scalar (number / true / false / null) at the cursor, whitespace trimmed.
+    std::string_view atom() {
+        const char c = peek();
+        if (c == '\0' || c == '"' || c == '{' || c == '}' || c == '[' || c == ']' ||
+            c == ':' || c == ',')
+            fail("expected value");
+        const std::size_t b = idx_[k_];
+        std::size_t e = k_ + 1 < n_ ? idx_[k_ + 1] : len_;
+        ++k_;
+        while (e > b && isJsonSpace(d_[e - 1]))
+            --e;
+        return std::string_view(d_ + b, e - b);
+    }
+
+    bool consumeNull() {
+        if (peek() != 'n')
+            return false;
+        if (atom() != "null")
+            fail("invalid literal");
+        return true;
+    }
+
+    // Canonical documents list keys in VCControlKey order, so each key is
+    // first compared against the one after its predecessor (`first` for the
+    // opening key) and only hashed on a miss.
+    template <typename F>
+    void object(VCControlKey first, F &&onKey) {
+        if (++depth_ > kMaxDepth)
+            fail("nesting too deep");
+        expect('{', "expected '{'");
+        if (!consumeIf('}')) {
+            int expected = static_cast<int>(first);
+            do {
+                const std::string_view key = string();
+                int id = -1;
+                if (expected < static_cast<int>(VCControlKey::Count) &&
+                    kControlKeyTable.lens[expected] == key.size() &&
+                    std::memcmp(kControlKeyNames[expected], key.data(), key.size()) == 0)
+                    id = expected;
+                else
+                    id = kControlKeyTable.find(key.data(), key.size());
+                expected = id + 1;
+                expect(':', "expected ':'");
+                onKey(id);
+            } while (consumeIf(','));
+            expect('}', "expected ',' or '}'");
+        }
+        --depth_;
+    }
+
+    template <typename F>
+    void array(F &&onElement) {
+        if (++depth_ > kMaxDepth)
+            fail("nesting too deep");
+        expect('[', "expected '['");
+        if (!consumeIf(']')) {
+            do {
+                onElement();
+            } while (consumeIf(','));
+            expect(']', "expected ',' or ']'");
+        }
+        --depth_;
+    }
+
+    void skipValue() {
+        const char c = peek();
+        if (c == '{') {
+            object(VCControlKey::Count, [&](int) { skipValue(); });
+        } else if (c == '[') {
+            array([&] { skipValue(); });
+        } else if (c == '"') {
+            string();
+        } else {
+            const std::string_view a = atom();
+            if (a != "true" && a != "false" && a != "null")
+                parseNumber(a);
+        }
+    }
+
+    void readString(std::string &dst) {
+        if (consumeNull()) {
+            dst.clear();
+            return;
+        }
+        const std::string_view s = string();
+        dst.assign(s.data(), s.size());
+    }
+
+    template <typename E, typename Table>
+    void readEnum(const Table &names, E &dst, const char *what) {
+        if (consumeNull()) {
+            dst = E{};
+            return;
+        }
+        const std::string_view s = string();
+        const int v = names.find(s.data(), s.size());
+        if (v < 0) {
+            k_ -= 2;  // report the offending string
+            fail(what);
+        }
+        dst = static_cast<E>(v);
+    }
+
+    void readBool(bool &dst) {
+        const std::string_view a = atom();
+        if (a == "true") dst = true;
+        else if (a == "false" || a == "null") dst = false;
+        else fail("expected boolean");
+    }
+
+    void readFloat(float &dst) {
+        const std::string_view a = atom();
+        dst = a == "null" ? 0.0f : static_cast<float>(parseNumber(a));
+    }
+
+    void readSubject(VCSubjectDescriptor &s) {
+        if (consumeNull()) {
+            s = VCSubjectDescriptor{};
+            return;
+        }
+        object(VCControlKey::Name, [&](int key) {
+            switch (static_cast<VCControlKey>(key)) {
+                case VCControlKey::Name:         readString(s.name); break;
+                case VCControlKey::Attributes:   readString(s.attributes); break;
+                case VCControlKey::PositionHint: readString(s.positionHint); break;
+                default:                         skipValue(); break;
+            }
+        });
+    }
+
+    void topLevel(int key, VCScenePlan &p) {
+        // Checked before anything is applied, so a patch this parser cannot
+        // read leaves the plan untouched.
+        if (patch_ && !formatSeen_) {
+            if (key != static_cast<int>(VCControlKey::PatchFormat))
+                fail("scene patch must start with patch_format");
+            if (string() != kScenePatchFormat) {
+                k_ -= 2;
+                fail("unsupported patch_format");
+            }
+            formatSeen_ = true;
+            return;
+        }
+        switch (static_cast<VCControlKey>(key)) {
+            case VCControlKey::CorePrompt:
+                readString(p.corePrompt);
+                break;
+            case VCControlKey::PatchFormat:
+                fail(patch_ ? "duplicate patch_format" : "scene patch passed as control JSON");
+            case VCControlKey::CorePromptAppend:
+                if (!patch_)
+                    fail("scene patch passed as control JSON");
+                if (!consumeNull()) {
+                    const std::string_view s = string();
+                    p.corePrompt.append(s.data(), s.size());
+                }
+                break;
+            case VCControlKey::Mode:
+                readEnum(kIGModeNames, p.mode, "unknown mode");
+                break;
+            case VCControlKey::SafetyProfile:
+                readEnum(kSafetyProfileNames, p.safety, "unknown safety_profile");
+                break;
+            case VCControlKey::QualityPreset:
+                readEnum(kQualityPresetNames, p.quality, "unknown quality_preset");
+                break;
+            case VCControlKey::AspectRatio:
+                readEnum(kAspectRatioNames, p.aspectRatio, "unknown aspect_ratio");
+                break;
+            case VCControlKey::PrimarySubject:
+                readSubject(p.primarySubject);
+                break;
+            case VCControlKey::SecondarySubjects:
+                p.secondarySubjects.clear();
+                if (!consumeNull()) {
+                    array([&] {
+                        p.secondarySubjects.emplace_back();
+                        readSubject(p.secondarySubjects.back());
+                    });
+                }
+                break;
+            case VCControlKey::Background:
+                if (consumeNull()) {
+                    p.background = VCBackgroundDescriptor{};
+                    break;
+                }
+                object(VCControlKey::Environment, [&](int k) {
+                    switch (static_cast<VCControlKey>(k)) {
+                        case VCControlKey::Environment: readString(p.background.environment); break;
+                        case VCControlKey::TimeOfDay:   readString(p.background.timeOfDay); break;
+                        case VCControlKey::Weather:     readString(p.background.weather); break;
+                        default:                        skipValue(); break;
+                    }
+                });
+                break;
+            case VCControlKey::ColorLighting:
+                if (consumeNull()) {
+                    p.colorLighting = VCColorLightingDescriptor{};
+                    break;
+                }
+                object(VCControlKey::ColorTone, [&](int k) {
+                    switch (static_cast<VCControlKey>(k)) {
+                        case VCControlKey::ColorTone:
+                            readEnum(kColorToneNames, p.colorLighting.colorTone, "unknown color_tone");
+                            break;
+                        case VCControlKey::Lighting:
+                            readEnum(kLightingNames, p.colorLighting.lighting, "unknown lighting");
+                            break;
+                        case VCControlKey::PaletteHint:
+                            readString(p.colorLighting.paletteHint);
+                            break;
+                        default:
+                            skipValue();
+                            break;
+                    }
+                });
+                break;
+            case VCControlKey::Camera:
+                if (consumeNull()) {
+                    p.camera = VCCameraDescriptor{};
+                    break;
+                }
+                object(VCControlKey::Angle, [&](int k) {
+                    switch (static_cast<VCControlKey>(k)) {
+                        case VCControlKey::Angle:
+                            readEnum(kCameraAngleNames, p.camera.angle, "unknown camera angle");
+                            break;
+                        case VCControlKey::FocalLengthMM: readFloat(p.camera.focalLengthMM); break;
+                        case VCControlKey::DepthOfField:  readBool(p.camera.depthOfField); break;
+                        default:                          skipValue(); break;
+                    }
+                });
+                break;
+            case VCControlKey::Composition:
+                if (consumeNull()) {
+                    p.composition = VCCompositionDescriptor{};
+                    break;
+                }
+                object(VCControlKey::Rule, [&](int k) {
+                    switch (static_cast<VCControlKey>(k)) {
+                        case VCControlKey::Rule:
+                            readEnum(kCompositionRuleNames, p.composition.rule,
+                                     "unknown composition rule");
+                            break;
+                        case VCControlKey::AllowCropping:
+                            readBool(p.composition.allowCropping);
+                            break;
+                        case VCControlKey::CenterMainSubject:
+                            readBool(p.composition.centerMainSubject);
+                            break;
+                        default:
+                            skipValue();
+                            break;
+                    }
+                });
+                break;
+            case VCControlKey::ArtStyle:
+                if (consumeNull()) {
+                    p.artStyle = VCArtStyleDescriptor{};
+                    break;
+                }
+                object(VCControlKey::Style, [&](int k) {
+                    switch (static_cast<VCControlKey>(k)) {
+                        case VCControlKey::Style:
+                            readEnum(kArtStyleNames, p.artStyle.style, "unknown art style");
+                            break;
+                        case VCControlKey::BrushDetail:
+                            readEnum(kBrushDetailNames, p.artStyle.brushDetail,
+                                     "unknown brush_detail");
+                            break;
+                        case VCControlKey::EraHint:
+                            readString(p.artStyle.eraHint);
+                            break;
+                        default:
+                            skipValue();
+                            break;
+                    }
+                });
+                break;
+            case VCControlKey::NegativeConstraints:
+                if (consumeNull()) {
+                    p.negatives = VCNegativeConstraints{};
+                    break;
+                }
+                object(VCControlKey::VisualArtifacts, [&](int k) {
+                    switch (static_cast<VCControlKey>(k)) {
+                        case VCControlKey::VisualArtifacts:
+                            readString(p.negatives.visualArtifacts);
+                            break;
+                        case VCControlKey::ContentExclusions:
+                            readString(p.negatives.contentExclusions);
+                            break;
+                        default:
+                            skipValue();
+                            break;
+                    }
+                });
+                break;
+            default:
+                skipValue();
+                break;
+        }
+    }
+
+    // JSON number grammar; whole decimals ("35.000000") skip strtod.
+    double parseNumber(std::string_view a) const {
+        std::size_t i = 0;
+        const std::size_t n = a.size();
+        if (i < n && a[i] == '-') ++i;
+        if (i >= n) fail("invalid number");
+        if (a[i] == '0') {
+            ++i;
+        } else if (a[i] >= '1' && a[i] <= '9') {
+            while (i < n && a[i] >= '0' && a[i] <= '9') ++i;
+        } else {
+            fail("invalid number");
+        }
+        const std::size_t intEnd = i;
+        bool wholeFraction = true;
+        if (i < n && a[i] == '.') {
+            ++i;
+            if (i >= n || a[i] < '0' || a[i] > '9') fail("invalid number");
+            while (i < n && a[i] >= '0' && a[i] <= '9') {
+                if (a[i] != '0') wholeFraction = false;
+                ++i;
+            }
+        }
+        bool exponent = false;
+        if (i < n && (a[i] == 'e' || a[i] == 'E')) {
+            exponent = true;
+            ++i;
+            if (i < n && (a[i] == '+' || a[i] == '-')) ++i;
+            if (i >= n || a[i] < '0' || a[i] > '9') fail("invalid number");
+            while (i < n && a[i] >= '0' && a[i] <= '9') ++i;
+        }
+        if (i != n) fail("invalid number");
+
+        const bool negative = a[0] == '-';
+        const std::size_t digits = intEnd - (negative ? 1 : 0);
+        if (!exponent && wholeFraction && digits <= 15) {
+            double v = 0.0;
+            for (std::size_t d = negative ? 1 : 0; d < intEnd; ++d)
+                v = v * 10.0 + (a[d] - '0');
+            return negative ? -v : v;
+        }
+        char buf[64];
+        if (n >= sizeof(buf)) fail("number too long");
+        std::memcpy(buf, a.data(), n);
+        buf[n] = '\0';
+        return std::strtod(buf, nullptr);
+    }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    uint32_t readHex4(const char *s, std::size_t n, std::size_t i) const {
+        if (i + 4 > n) fail("truncated \\u escape");
+        uint32_t v = 0;
+        for (std::size_t k = 0; k < 4; ++k) {
+            const int h = hexValue(s[i + k]);
+            if (h < 0) fail("bad \\u escape");
+            v = (v << 4) | static_cast<uint32_t>(h);
+        }
+        return v;
+    }
+
+    std::string_view unescape(const char *s, std::size_t n) {
+        scratch_.resize(n);  // decoded text is never longer than its escapes
+        char *o = &scratch_[0];
+        std::size_t w = 0;
+        for (std::size_t i = 0; i < n;) {
+            if (s[i] != '\\') {
+                o[w++] = s[i++];
+                continue;
+            }
+            if (i + 1 >= n) fail("bad escape");
+            const char e = s[i + 1];
+            i += 2;
+            switch (e) {
+                case '"':  o[w++] = '"'; break;
+                case '\\': o[w++] = '\\'; break;
+                case '/':  o[w++] = '/'; break;
+                case 'b':  o[w++] = '\b'; break;
+                case 'f':  o[w++] = '\f'; break;
+                case 'n':  o[w++] = '\n'; break;
+                case 'r':  o[w++] = '\r'; break;
+                case 't':  o[w++] = '\t'; break;
+                case 'u': {
+                    uint32_t cp = readHex4(s, n, i);
+                    i += 4;
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        if (i + 2 > n || s[i] != '\\' || s[i + 1] != 'u')
+                            fail("unpaired surrogate");
+                        const uint32_t lo = readHex4(s, n, i + 2);
+                        if (lo < 0xDC00 || lo > 0xDFFF)
+                            fail("unpaired surrogate");
+                        i += 6;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                        fail("unpaired surrogate");
+                    }
+                    w += static_cast<std::size_t>(encodeUTF8(cp, o + w));
+                    break;
+                }
+                default:
+                    fail("bad escape");
+            }
+        }
+        return std::string_view(o, w);
+    }
+};
+
+// -----------------------------------------------------------------------------
+// Entry points
+// -----------------------------------------------------------------------------
+
+// Index and scratch buffers are thread-local and keep their capacity
+// between calls.
+static inline void parseControlJSON(const char *data, std::size_t len, VCScenePlan &plan,
+                                    bool patch) {
+    if (!isValidUTF8(data, len))
+        throw std::runtime_error("control JSON: invalid UTF-8");
+    thread_local std::vector<uint32_t> index;
+    thread_local std::string scratch;
+    bool hasEscapes = false;
+    const std::size_t count = buildJsonStructuralIndex(data, len, index, hasEscapes);
+    VCControlJSONParser(data, len, index.data(), count, hasEscapes, scratch).parse(plan, patch);
+}
+
+// Parses control JSON into `plan`, overwriting only the members whose keys
+// are present (null resets a member).
+static void parseScenePlanJSON(const char *data, std::size_t len, VCScenePlan &plan) {
+    parseControlJSON(data, len, plan, false);
+}
+
+static VCScenePlan parseScenePlanJSON(const std::string &json) {
+    VCScenePlan plan{};
+    parseScenePlanJSON(json.data(), json.size(), plan);
+    return plan;
+}
+
+// Applies a scene patch to `plan`. A patch with a missing or different
+// patch_format throws before any member is changed.
+static inline void parseScenePlanPatch(const char *data, std::size_t len, VCScenePlan &plan) {
+    parseControlJSON(data, len, plan, true);
+}
+
+} // namespace vc_vlig
+
+#ifdef VC_VLIG_SCENE_PLAN_JSON_BENCH
+#include <chrono>
+
+int main() {
+    using namespace vc_vlig;
+    const char *prompts[] = {
+        "Ultra-detailed cinematic portrait of a lone astronaut standing in a "
+        "foggy forest at sunset, teal and orange color grade, soft lighting, "
+        "shot on a 50mm lens, rule of thirds composition, 16:9.",
+        "anime girl with a \"red\" umbrella in the rain, city at night, wide shot, 9:16",
+        "watercolor painting of a castle on a hill"
+    };
+    std::vector<std::string> docs;
+    for (const char *p : prompts)
+        docs.push_back(BuildSemanticIGSpec(p, VCIGMode::TextToImage, VCSafetyProfile::Safe,
+                                           VCQualityPreset::High).jsonControl);
+    std::string longPrompt;
+    while (longPrompt.size() < 7000)
+        longPrompt += "misty pine forest with a wooden cabin, golden hour, film grain, ";
+    docs.push_back(BuildSemanticIGSpec(longPrompt, VCIGMode::ImageToImage, VCSafetyProfile::Safe,
+                                       VCQualityPreset::Ultra).jsonControl);
+
+    int failures = 0;
+    for (const std::string &doc : docs) {
+        VCScenePlan plan = parseScenePlanJSON(doc);
+        std::string again;
+        serializeScenePlanToJSON(plan, again);
+        if (again != doc)
+            ++failures;
+
+        const int iters = doc.size() > 4000 ? 20000 : 200000;
+        std::vector<uint32_t> index;
+        bool hasEscapes = false;
+        std::size_t sink = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iters; ++i)
+            sink += buildJsonStructuralIndex(doc.data(), doc.size(), index, hasEscapes);
+        auto t1 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iters; ++i) {
+            parseScenePlanJSON(doc.data(), doc.size(), plan);
+            sink += plan.corePrompt.size();
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        const double bytes = static_cast<double>(doc.size()) * iters;
+        const double s1 = std::chrono::duration<double>(t1 - t0).count();
+        const double s2 = std::chrono::duration<double>(t2 - t1).count();
+        std::printf("%6zu B: stage 1 %.2f GB/s, full parse %.2f GB/s (%.0f ns/doc) [%zu]\n",
+                    doc.size(), bytes / s1 / 1e9, bytes / s2 / 1e9, s2 * 1e9 / iters, sink % 10);
+    }
+    std::printf("round trip: %s\n", failures == 0 ? "ok" : "MISMATCH");
+    return failures == 0 ? 0 : 1;
+}
+#endif
+
+#endif // VC_VLIG_SCENE_PLAN_JSON_PARSER_CPP
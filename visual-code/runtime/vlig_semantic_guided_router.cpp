@@ -13,13 +13,34 @@
 //   and emits a canonical JSON control spec that can be mapped directly
 //   into model‑specific parameters in a server or plugin layer. [file:1]
 
+#ifndef VC_VLIG_SEMANTIC_GUIDED_ROUTER_CPP
+#define VC_VLIG_SEMANTIC_GUIDED_ROUTER_CPP
+
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <initializer_list>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <stdexcept>
 #include <iostream>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VC_VLIG_SSE2 1
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define VC_VLIG_SSSE3 1
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VC_VLIG_NEON 1
+#endif
+
 namespace vc_vlig {
 
 enum class VCPlatform {
@@ -118,29 +139,982 @@ static inline bool isAsciiPrintable(char c) {
     return u >= 32 && u <= 126;
 }
 
-static std::string stripControl(const std::string &in) {
-    std::string out;
-    out.reserve(in.size());
-    for (char c : in) {
-        if (isAsciiPrintable(c) || c == '\n' || c == '\t')
-            out.push_back(c);
+static inline char toLowerASCII(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// -----------------------------------------------------------------------------
+// UTF-8 handling
+//
+// Prompts keep valid multibyte text. Invalid sequences, C1 controls,
+// zero-width / bidi-override characters are dropped; Unicode spaces join the
+// ASCII whitespace collapse; dashes, curly quotes, ellipsis and fullwidth
+// ASCII fold to their ASCII forms so keyword matching sees them. The
+// lowercase buffer additionally folds Latin-1, Greek and Cyrillic capitals;
+// those folds keep the byte length, so text and lower stay index-aligned.
+// -----------------------------------------------------------------------------
+
+// Decodes one sequence. Returns its length (1-4), 0 if the bytes at p are not
+// a valid sequence (overlong, surrogate, > U+10FFFF, stray continuation), or
+// -1 if p holds a valid prefix cut off by the end of input.
+static inline int decodeUTF8(const unsigned char *p, std::size_t avail, uint32_t &cp) {
+    const unsigned char b0 = p[0];
+    if (b0 < 0x80) {
+        cp = b0;
+        return 1;
     }
-    return out;
+    int n;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (b0 < 0xC2) return 0;
+    if (b0 < 0xE0) {
+        n = 2;
+        cp = b0 & 0x1Fu;
+    } else if (b0 < 0xF0) {
+        n = 3;
+        cp = b0 & 0x0Fu;
+        if (b0 == 0xE0) lo = 0xA0;
+        if (b0 == 0xED) hi = 0x9F;
+    } else if (b0 < 0xF5) {
+        n = 4;
+        cp = b0 & 0x07u;
+        if (b0 == 0xF0) lo = 0x90;
+        if (b0 == 0xF4) hi = 0x8F;
+    } else {
+        return 0;
+    }
+    for (int k = 1; k < n; ++k) {
+        if (static_cast<std::size_t>(k) >= avail) return -1;
+        const unsigned char b = p[k];
+        if (b < (k == 1 ? lo : 0x80) || b > (k == 1 ? hi : 0xBF)) return 0;
+        cp = (cp << 6) | (b & 0x3Fu);
+    }
+    return n;
+}
+
+// Bytes at the end of [.., end) that belong to a sequence whose lead byte
+// says it continues past `end` (0-3). Reads end[-3 .. -1].
+static inline std::size_t utf8TailLength(const char *end) {
+    for (std::size_t k = 1; k <= 3; ++k) {
+        const unsigned char b = static_cast<unsigned char>(*(end - k));
+        if ((b & 0xC0) != 0x80) {
+            const std::size_t need = b >= 0xF0 ? 4 : b >= 0xE0 ? 3 : b >= 0xC0 ? 2 : 1;
+            return need > k ? k : 0;
+        }
+    }
+    return 0;
+}
+
+static inline int encodeUTF8(uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = static_cast<char>(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (cp >> 6));
+        out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (cp >> 12));
+        out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (cp >> 18));
+    out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+enum : int {
+    kUcKeep  = 0,   // copy the original bytes
+    kUcDrop  = -1,  // remove
+    kUcSpace = -2,  // whitespace (collapsed like ' ')
+    kUcEllip = -3   // "..."
+    // > 0: replace with that ASCII character
+};
+
+static inline int normalizeCodePoint(uint32_t cp) {
+    if (cp < 0xA0) return kUcDrop;  // C1 controls
+    if (cp > 0x3000 && cp < 0xFE00) return kUcKeep;  // CJK, kana, Hangul
+    switch (cp) {
+        case 0x00A0: case 0x1680: case 0x2028: case 0x2029: case 0x202F:
+        case 0x205F: case 0x3000:
+            return kUcSpace;
+        case 0x00AD: case 0x034F: case 0x061C: case 0x180E: case 0x2060:
+        case 0xFEFF:
+            return kUcDrop;
+        case 0x2018: case 0x2019: case 0x201A: case 0x201B: case 0x2032:
+            return '\'';
+        case 0x00AB: case 0x00BB: case 0x201C: case 0x201D: case 0x201E:
+        case 0x201F: case 0x2033:
+            return '"';
+        case 0x2212: case 0xFE63:
+            return '-';
+        case 0x2026:
+            return kUcEllip;
+        default:
+            break;
+    }
+    if (cp >= 0x2000 && cp <= 0x200A) return kUcSpace;
+    if (cp >= 0x200B && cp <= 0x200F) return kUcDrop;  // zero-width, LRM/RLM
+    if (cp >= 0x202A && cp <= 0x202E) return kUcDrop;  // bidi embeddings
+    if (cp >= 0x2066 && cp <= 0x2069) return kUcDrop;  // bidi isolates
+    if (cp >= 0x2010 && cp <= 0x2015) return '-';
+    if (cp >= 0xFF01 && cp <= 0xFF5E) return static_cast<int>(cp - 0xFEE0);
+    return kUcKeep;
+}
+
+static inline uint32_t foldLowerCodePoint(uint32_t cp) {
+    if (cp > 0x42F) return cp;
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) return cp + 0x20;    // Latin-1
+    if (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2) return cp + 0x20; // Greek
+    if (cp >= 0x410 && cp <= 0x42F) return cp + 0x20;                // Cyrillic
+    if (cp >= 0x400 && cp <= 0x40F) return cp + 0x50;
+    return cp;
+}
+
+#if defined(VC_VLIG_SSSE3) || defined(VC_VLIG_NEON)
+// Lookup-table UTF-8 validation (Keiser & Lemire, "Validating UTF-8 In Less
+// Than One Instruction Per Byte"): three nibble lookups classify every byte
+// pair, plus a check that 3-/4-byte leads get their continuation bytes.
+enum : uint8_t {
+    kU8TooShort  = 1 << 0,
+    kU8TooLong   = 1 << 1,
+    kU8Overlong3 = 1 << 2,
+    kU8TooLarge  = 1 << 3,
+    kU8Surrogate = 1 << 4,
+    kU8Overlong2 = 1 << 5,
+    kU8TooLarge1000 = 1 << 6,
+    kU8Overlong4 = 1 << 6,
+    kU8TwoConts  = 1 << 7,
+    kU8Carry     = kU8TooShort | kU8TooLong | kU8TwoConts
+};
+
+alignas(16) static const uint8_t kU8Byte1High[16] = {
+    kU8TooLong, kU8TooLong, kU8TooLong, kU8TooLong,
+    kU8TooLong, kU8TooLong, kU8TooLong, kU8TooLong,
+    kU8TwoConts, kU8TwoConts, kU8TwoConts, kU8TwoConts,
+    kU8TooShort | kU8Overlong2,
+    kU8TooShort,
+    kU8TooShort | kU8Overlong3 | kU8Surrogate,
+    kU8TooShort | kU8TooLarge | kU8TooLarge1000 | kU8Overlong4
+};
+alignas(16) static const uint8_t kU8Byte1Low[16] = {
+    kU8Carry | kU8Overlong3 | kU8Overlong2 | kU8Overlong4,
+    kU8Carry | kU8Overlong2,
+    kU8Carry,
+    kU8Carry,
+    kU8Carry | kU8TooLarge,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000 | kU8Surrogate,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000,
+    kU8Carry | kU8TooLarge | kU8TooLarge1000
+};
+alignas(16) static const uint8_t kU8Byte2High[16] = {
+    kU8TooShort, kU8TooShort, kU8TooShort, kU8TooShort,
+    kU8TooShort, kU8TooShort, kU8TooShort, kU8TooShort,
+    kU8TooLong | kU8Overlong2 | kU8TwoConts | kU8Overlong3 | kU8TooLarge1000 | kU8Overlong4,
+    kU8TooLong | kU8Overlong2 | kU8TwoConts | kU8Overlong3 | kU8TooLarge,
+    kU8TooLong | kU8Overlong2 | kU8TwoConts | kU8Surrogate | kU8TooLarge,
+    kU8TooLong | kU8Overlong2 | kU8TwoConts | kU8Surrogate | kU8TooLarge,
+    kU8TooShort, kU8TooShort, kU8TooShort, kU8TooShort
+};
+
+// Lead bytes whose code points normalizeCodePoint or foldLowerCodePoint may
+// rewrite (U+0080-00FF, U+034F, Greek, Cyrillic, U+061C, U+1680/180E,
+// U+2000-2FFF, U+3000, U+FE63/FEFF/FFxx), as a low-nibble x high-nibble
+// bitmap: bit 0 = 0xC_, bit 1 = 0xD_, bit 2 = 0xE_.
+alignas(16) static const uint8_t kU8RewriteLeadLo[16] = {
+    2, 2 | 4, 1 | 4, 1 | 4, 0, 0, 0, 0, 2, 0, 0, 0, 0, 1, 1, 1 | 4
+};
+alignas(16) static const uint8_t kU8RewriteLeadHi[16] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 0
+};
+#endif
+
+#if defined(VC_VLIG_SSSE3)
+// Non-zero lanes flag errors in `in` given the 16 bytes before it.
+static inline __m128i utf8BlockError(__m128i in, __m128i prev) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i prev1 = _mm_alignr_epi8(in, prev, 15);
+    const __m128i sc = _mm_and_si128(
+        _mm_and_si128(
+            _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(kU8Byte1High)),
+                             _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+            _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(kU8Byte1Low)),
+                             _mm_and_si128(prev1, nibble))),
+        _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(kU8Byte2High)),
+                         _mm_and_si128(_mm_srli_epi16(in, 4), nibble)));
+    const __m128i third = _mm_subs_epu8(_mm_alignr_epi8(in, prev, 14),
+                                        _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+    const __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(in, prev, 13),
+                                         _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+    const __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth),
+                                         _mm_set1_epi8(static_cast<char>(0x80)));
+    return _mm_xor_si128(must23, sc);
+}
+
+// Non-zero lanes if the block ends inside a sequence.
+static inline __m128i utf8BlockIncomplete(__m128i in) {
+    return _mm_subs_epu8(in, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                           static_cast<char>(0xF0 - 1),
+                                           static_cast<char>(0xE0 - 1),
+                                           static_cast<char>(0xC0 - 1)));
+}
+
+static inline __m128i utf8RewriteLeads(__m128i in) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    return _mm_and_si128(
+        _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(kU8RewriteLeadLo)),
+                         _mm_and_si128(in, nibble)),
+        _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(kU8RewriteLeadHi)),
+                         _mm_and_si128(_mm_srli_epi16(in, 4), nibble)));
+}
+#elif defined(VC_VLIG_NEON)
+static inline uint8x16_t utf8BlockError(uint8x16_t in, uint8x16_t prev) {
+    const uint8x16_t prev1 = vextq_u8(prev, in, 15);
+    const uint8x16_t sc = vandq_u8(
+        vandq_u8(vqtbl1q_u8(vld1q_u8(kU8Byte1High), vshrq_n_u8(prev1, 4)),
+                 vqtbl1q_u8(vld1q_u8(kU8Byte1Low), vandq_u8(prev1, vdupq_n_u8(0x0F)))),
+        vqtbl1q_u8(vld1q_u8(kU8Byte2High), vshrq_n_u8(in, 4)));
+    const uint8x16_t third = vqsubq_u8(vextq_u8(prev, in, 14), vdupq_n_u8(0xE0 - 0x80));
+    const uint8x16_t fourth = vqsubq_u8(vextq_u8(prev, in, 13), vdupq_n_u8(0xF0 - 0x80));
+    const uint8x16_t must23 = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+    return veorq_u8(must23, sc);
+}
+
+static inline uint8x16_t utf8BlockIncomplete(uint8x16_t in) {
+    static const uint8_t kMaxTail[16] = {255, 255, 255, 255, 255, 255, 255, 255, 255,
+                                         255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1};
+    return vqsubq_u8(in, vld1q_u8(kMaxTail));
+}
+
+static inline uint8x16_t utf8RewriteLeads(uint8x16_t in) {
+    return vandq_u8(vqtbl1q_u8(vld1q_u8(kU8RewriteLeadLo), vandq_u8(in, vdupq_n_u8(0x0F))),
+                    vqtbl1q_u8(vld1q_u8(kU8RewriteLeadHi), vshrq_n_u8(in, 4)));
+}
+#endif
+
+// True if [data, data + len) is well-formed UTF-8. Pure-ASCII blocks cost one
+// compare; mixed blocks take the lookup path 16 bytes at a time (SSSE3 or
+// AArch64 NEON), and the scalar decoder finishes the tail.
+static inline bool isValidUTF8(const char *data, std::size_t len) {
+    std::size_t i = 0;
+#if defined(VC_VLIG_SSSE3)
+    __m128i error = _mm_setzero_si128();
+    __m128i prev = _mm_setzero_si128();
+    __m128i prevIncomplete = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        if (_mm_movemask_epi8(in) == 0) {
+            error = _mm_or_si128(error, prevIncomplete);
+            prevIncomplete = _mm_setzero_si128();
+        } else {
+            error = _mm_or_si128(error, utf8BlockError(in, prev));
+            prevIncomplete = utf8BlockIncomplete(in);
+        }
+        prev = in;
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xFFFF)
+        return false;
+#elif defined(VC_VLIG_NEON)
+    uint8x16_t error = vdupq_n_u8(0);
+    uint8x16_t prev = vdupq_n_u8(0);
+    uint8x16_t prevIncomplete = vdupq_n_u8(0);
+    for (; i + 16 <= len; i += 16) {
+        const uint8x16_t in = vld1q_u8(reinterpret_cast<const uint8_t *>(data + i));
+        if (vmaxvq_u8(in) < 0x80) {
+            error = vorrq_u8(error, prevIncomplete);
+            prevIncomplete = vdupq_n_u8(0);
+        } else {
+            error = vorrq_u8(error, utf8BlockError(in, prev));
+            prevIncomplete = utf8BlockIncomplete(in);
+        }
+        prev = in;
+    }
+    if (vmaxvq_u8(error) != 0)
+        return false;
+#endif
+    // Re-check from the lead byte of any sequence straddling the vector tail.
+    if (i >= 3)
+        i -= utf8TailLength(data + i);
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    while (i < len) {
+#if defined(VC_VLIG_SSE2)
+        if (p[i] < 0x80 && i + 16 <= len &&
+            _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i))) == 0) {
+            i += 16;
+            continue;
+        }
+#endif
+        if (p[i] < 0x80 && i + 8 <= len) {
+            uint64_t word;
+            std::memcpy(&word, p + i, 8);
+            if ((word & 0x8080808080808080ull) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+        uint32_t cp;
+        const int n = decodeUTF8(p + i, len - i, cp);
+        if (n <= 0) return false;
+        i += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Reusable sanitizer output; capacity is kept across prompts so a warm
+// buffer pair sanitizes without allocating.
+struct VCPromptBuffers {
+    std::string text;   // cleaned prompt, original case
+    std::string lower;  // lowercase copy used for keyword decisions
+};
+
+// Fused control stripping + UTF-8 normalization + whitespace collapsing +
+// lowercasing. Keeps printable ASCII plus '\n' / '\t' and valid multibyte
+// text (see normalizeCodePoint), turns every whitespace run into a single
+// ' ' (dropped bytes do not break a run) and trims one trailing space in
+// finish(). Input may arrive in chunks; the whitespace state and any UTF-8
+// sequence split across the chunk boundary carry over between feed() calls.
+//
+// The vector path classifies 16 bytes per step: a block of printable ASCII
+// with no doubled spaces is copied and lowercased as a whole, a validated
+// all-multibyte block with nothing to fold is copied as is (SSSE3 / NEON),
+// anything else falls back to the scalar loop for that block only.
+class VCPromptSanitizer {
+public:
+    explicit VCPromptSanitizer(VCPromptBuffers &buffers) : buf_(buffers) {}
+
+    void reset() {
+        buf_.text.clear();
+        buf_.lower.clear();
+        lastSpace_ = false;
+        pendingLen_ = 0;
+    }
+
+    void feed(const char *data, std::size_t len) {
+        const std::size_t base = buf_.text.size();
+        // Normalization never grows a sequence; only carried-over bytes add.
+        buf_.text.resize(base + len + pendingLen_);
+        buf_.lower.resize(base + len + pendingLen_);
+        char *t = &buf_.text[0] + base;
+        char *l = &buf_.lower[0] + base;
+        std::size_t w = 0;
+        std::size_t i = 0;
+        if (pendingLen_ != 0)
+            i = feedPending(data, len, t, l, w);
+#if defined(VC_VLIG_SSE2)
+        const __m128i lo = _mm_set1_epi8(0x20);
+        const __m128i hi = _mm_set1_epi8(0x7F);
+        const __m128i sp = _mm_set1_epi8(' ');
+        const __m128i upA = _mm_set1_epi8('A' - 1);
+        const __m128i upZ = _mm_set1_epi8('Z' + 1);
+        const __m128i caseBit = _mm_set1_epi8(0x20);
+        while (i + 16 <= len) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            // Signed compares: bytes >= 0x80 are negative and fail "> 0x20".
+            const __m128i graph = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+            const unsigned graphMask = static_cast<unsigned>(_mm_movemask_epi8(graph));
+            const unsigned spaceMask =
+                static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, sp)));
+            const unsigned prevSpace = (spaceMask << 1) | (lastSpace_ ? 1u : 0u);
+            if ((graphMask | spaceMask) != 0xFFFFu || (spaceMask & prevSpace) != 0) {
+#if defined(VC_VLIG_SSSE3)
+                // All-multibyte block of valid sequences none of which
+                // normalization rewrites (CJK, Hangul, emoji, ...): both
+                // buffers take it verbatim, up to the last complete sequence.
+                if (_mm_movemask_epi8(v) == 0xFFFF) {
+                    const __m128i bad = _mm_or_si128(utf8BlockError(v, _mm_setzero_si128()),
+                                                     utf8RewriteLeads(v));
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) == 0xFFFF) {
+                        const std::size_t n = 16 - utf8TailLength(data + i + 16);
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(t + w), v);
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(l + w), v);
+                        w += n;
+                        i += n;
+                        lastSpace_ = false;
+                        continue;
+                    }
+                }
+#endif
+                i += feedScalar(data + i, len - i, 16, t, l, w);
+                continue;
+            }
+            const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, upA), _mm_cmplt_epi8(v, upZ));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(t + w), v);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(l + w),
+                             _mm_add_epi8(v, _mm_and_si128(upper, caseBit)));
+            w += 16;
+            i += 16;
+            lastSpace_ = (spaceMask & 0x8000u) != 0;
+        }
+#elif defined(VC_VLIG_NEON)
+        const uint8x16_t lo = vdupq_n_u8(0x20);
+        const uint8x16_t hi = vdupq_n_u8(0x7F);
+        const uint8x16_t sp = vdupq_n_u8(' ');
+        const uint8x16_t upA = vdupq_n_u8('A' - 1);
+        const uint8x16_t upZ = vdupq_n_u8('Z' + 1);
+        const uint8x16_t caseBit = vdupq_n_u8(0x20);
+        while (i + 16 <= len) {
+            const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(data + i));
+            const uint8x16_t graph = vandq_u8(vcgtq_u8(v, lo), vcltq_u8(v, hi));
+            const uint8x16_t space = vceqq_u8(v, sp);
+            const uint8x16_t carry = vdupq_n_u8(lastSpace_ ? 0xFF : 0x00);
+            const uint8x16_t prevSpace = vextq_u8(carry, space, 15);
+            if (vminvq_u8(vorrq_u8(graph, space)) == 0 ||
+                vmaxvq_u8(vandq_u8(space, prevSpace)) != 0) {
+                if (vminvq_u8(v) >= 0x80) {
+                    const uint8x16_t bad = vorrq_u8(utf8BlockError(v, vdupq_n_u8(0)),
+                                                    utf8RewriteLeads(v));
+                    if (vmaxvq_u8(bad) == 0) {
+                        const std::size_t n = 16 - utf8TailLength(data + i + 16);
+                        vst1q_u8(reinterpret_cast<uint8_t *>(t + w), v);
+                        vst1q_u8(reinterpret_cast<uint8_t *>(l + w), v);
+                        w += n;
+                        i += n;
+                        lastSpace_ = false;
+                        continue;
+                    }
+                }
+                i += feedScalar(data + i, len - i, 16, t, l, w);
+                continue;
+            }
+            const uint8x16_t upper = vandq_u8(vcgtq_u8(v, upA), vcltq_u8(v, upZ));
+            vst1q_u8(reinterpret_cast<uint8_t *>(t + w), v);
+            vst1q_u8(reinterpret_cast<uint8_t *>(l + w), vaddq_u8(v, vandq_u8(upper, caseBit)));
+            w += 16;
+            i += 16;
+            lastSpace_ = vgetq_lane_u8(space, 15) != 0;
+        }
+#endif
+        if (i < len)
+            feedScalar(data + i, len - i, len - i, t, l, w);
+        buf_.text.resize(base + w);
+        buf_.lower.resize(base + w);
+    }
+
+    // A sequence still incomplete at the end of input is dropped.
+    void finish() {
+        pendingLen_ = 0;
+        if (!buf_.text.empty() && buf_.text.back() == ' ') {
+            buf_.text.pop_back();
+            buf_.lower.pop_back();
+        }
+    }
+
+private:
+    VCPromptBuffers &buf_;
+    bool lastSpace_ = false;
+    unsigned char pending_[4] = {0, 0, 0, 0};
+    std::size_t pendingLen_ = 0;
+
+    void emitSpace(char *t, char *l, std::size_t &w) {
+        if (!lastSpace_) {
+            t[w] = ' ';
+            l[w] = ' ';
+            ++w;
+            lastSpace_ = true;
+        }
+    }
+
+    void emitAscii(char c, char *t, char *l, std::size_t &w) {
+        t[w] = c;
+        l[w] = toLowerASCII(c);
+        ++w;
+        lastSpace_ = false;
+    }
+
+    void emitCodePoint(uint32_t cp, const unsigned char *bytes, int n,
+                       char *t, char *l, std::size_t &w) {
+        const int action = normalizeCodePoint(cp);
+        if (action == kUcDrop) return;
+        if (action == kUcSpace) {
+            emitSpace(t, l, w);
+        } else if (action == kUcEllip) {
+            for (int k = 0; k < 3; ++k) emitAscii('.', t, l, w);
+        } else if (action > 0) {
+            emitAscii(static_cast<char>(action), t, l, w);
+        } else {
+            const uint32_t folded = foldLowerCodePoint(cp);
+            for (int k = 0; k < n; ++k) {
+                t[w + k] = static_cast<char>(bytes[k]);
+                l[w + k] = static_cast<char>(bytes[k]);
+            }
+            if (folded != cp)
+                encodeUTF8(folded, l + w);
+            w += static_cast<std::size_t>(n);
+            lastSpace_ = false;
+        }
+    }
+
+    // Consumes at least `want` bytes (more if a sequence straddles that
+    // point) out of `avail`; returns the count consumed. A valid prefix cut
+    // off by the end of the chunk is parked in pending_.
+    std::size_t feedScalar(const char *data, std::size_t avail, std::size_t want,
+                           char *t, char *l, std::size_t &w) {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+        std::size_t i = 0;
+        while (i < want) {
+            const char c = data[i];
+            if (static_cast<unsigned char>(c) < 0x80) {
+                if (c == ' ' || c == '\t' || c == '\n') {
+                    emitSpace(t, l, w);
+                } else if (isAsciiPrintable(c)) {
+                    emitAscii(c, t, l, w);
+                }
+                ++i;
+                continue;
+            }
+            uint32_t cp;
+            const int n = decodeUTF8(p + i, avail - i, cp);
+            if (n == 0) {
+                ++i;  // invalid byte: drop and resync
+            } else if (n < 0) {
+                pendingLen_ = avail - i;
+                std::memcpy(pending_, p + i, pendingLen_);
+                return avail;
+            } else {
+                emitCodePoint(cp, p + i, n, t, l, w);
+                i += static_cast<std::size_t>(n);
+            }
+        }
+        return i;
+    }
+
+    // Completes the sequence carried over from the previous chunk; returns
+    // how many bytes of `data` it used.
+    std::size_t feedPending(const char *data, std::size_t len, char *t, char *l, std::size_t &w) {
+        unsigned char seq[4];
+        std::memcpy(seq, pending_, pendingLen_);
+        const std::size_t take = std::min<std::size_t>(4 - pendingLen_, len);
+        std::memcpy(seq + pendingLen_, data, take);
+        const std::size_t have = pendingLen_ + take;
+        const std::size_t carried = pendingLen_;
+        pendingLen_ = 0;
+        uint32_t cp;
+        const int n = decodeUTF8(seq, have, cp);
+        if (n < 0) {
+            std::memcpy(pending_, seq, have);
+            pendingLen_ = have;
+            return len;
+        }
+        if (n == 0) return 0;  // drop the carried bytes, rescan data as is
+        emitCodePoint(cp, seq, n, t, l, w);
+        return static_cast<std::size_t>(n) - carried;
+    }
+};
+
+// -----------------------------------------------------------------------------
+// Keyword automaton
+//
+// Every keyword the planner looks for, plus the NSFW blocklist, lives in one
+// pattern table that the compiler turns into a single Aho‑Corasick DFA
+// (transition table plus per-state output sets). One pass over the
+// lowercase prompt yields a bitmap of keyword hits (read by every guess*
+// decision) and the spans of blocklist matches to mask. Keyword matching
+// keeps the substring semantics of the std::string::find chains it
+// replaces; masking resolves overlapping blocklist matches the way the
+// original find-and-mask loop did (see applyBlockSpans).
+// -----------------------------------------------------------------------------
+
+enum class VCKeyword : uint8_t {
+    // aspect ratio
+    Vertical, Portrait, Ratio_9_16, Cinematic, Wide, Ratio_16_9, Ratio_21_9,
+    Ratio_4_3, Ratio_3_4,
+    // art style
+    Photo, Photoreal, Realistic, Anime, Manga, Watercolor, Pixel, LineArt,
+    Sketch, LowPoly, LowPolyHyphen, ConceptArt, KeyArt, Painting,
+    DigitalPainting,
+    // lighting
+    SoftLight, SoftLighting, Dramatic, CinematicLight, Studio, ThreePoint,
+    HardLight,
+    // color tone
+    TealAndOrange, Warm, Sunset, Cool, Blueish, Pastel, HighContrast, Noir,
+    // camera
+    TopDownHyphen, TopDown, BirdsEye, CloseUpHyphen, CloseUp, PortraitShot,
+    WideShot, WideAngle, LowAngle, HighAngle, Isometric,
+    // composition
+    RuleOfThirds, Centered, Symmetrical, Symmetry, GoldenRatio, LeadingLines,
+    Symmetric,
+    // background
+    Forest, City, Space, Galaxy, Nebula, Beach, Ocean, Sea,
+    Night, Dawn, Sunrise,
+    Rain, Fog, Mist, Snow,
+
+    Count
+};
+
+static_assert(static_cast<int>(VCKeyword::Count) <= 128,
+              "VCKeywordHits holds at most 128 keywords");
+
+struct VCKeywordHits {
+    uint64_t bits[2] = {0, 0};
+
+    constexpr void set(VCKeyword k) {
+        const unsigned i = static_cast<unsigned>(k);
+        bits[i >> 6] |= (uint64_t{1} << (i & 63));
+    }
+    constexpr bool has(VCKeyword k) const {
+        const unsigned i = static_cast<unsigned>(k);
+        return (bits[i >> 6] >> (i & 63)) & 1u;
+    }
+    bool any(std::initializer_list<VCKeyword> ks) const {
+        for (VCKeyword k : ks)
+            if (has(k)) return true;
+        return false;
+    }
+    constexpr void merge(const VCKeywordHits &o) {
+        bits[0] |= o.bits[0];
+        bits[1] |= o.bits[1];
+    }
+};
+
+struct VCKeywordPattern {
+    const char *text;     // lowercase ASCII
+    VCKeyword   keyword;  // ignored for blocklist entries
+    bool        block;    // NSFW blocklist term: masked, not reported
+};
+
+constexpr VCKeywordPattern kRouterPatterns[] = {
+    {"vertical", VCKeyword::Vertical, false},
+    {"portrait", VCKeyword::Portrait, false},
+    {"9:16", VCKeyword::Ratio_9_16, false},
+    {"cinematic", VCKeyword::Cinematic, false},
+    {"wide", VCKeyword::Wide, false},
+    {"16:9", VCKeyword::Ratio_16_9, false},
+    {"21:9", VCKeyword::Ratio_21_9, false},
+    {"4:3", VCKeyword::Ratio_4_3, false},
+    {"3:4", VCKeyword::Ratio_3_4, false},
+
+    {"photo", VCKeyword::Photo, false},
+    {"photoreal", VCKeyword::Photoreal, false},
+    {"realistic", VCKeyword::Realistic, false},
+    {"anime", VCKeyword::Anime, false},
+    {"manga", VCKeyword::Manga, false},
+    {"watercolor", VCKeyword::Watercolor, false},
+    {"pixel", VCKeyword::Pixel, false},
+    {"line art", VCKeyword::LineArt, false},
+    {"sketch", VCKeyword::Sketch, false},
+    {"low poly", VCKeyword::LowPoly, false},
+    {"low-poly", VCKeyword::LowPolyHyphen, false},
+    {"concept art", VCKeyword::ConceptArt, false},
+    {"key art", VCKeyword::KeyArt, false},
+    {"painting", VCKeyword::Painting, false},
+    {"digital painting", VCKeyword::DigitalPainting, false},
+
+    {"soft light", VCKeyword::SoftLight, false},
+    {"soft lighting", VCKeyword::SoftLighting, false},
+    {"dramatic", VCKeyword::Dramatic, false},
+    {"cinematic light", VCKeyword::CinematicLight, false},
+    {"studio", VCKeyword::Studio, false},
+    {"three-point", VCKeyword::ThreePoint, false},
+    {"hard light", VCKeyword::HardLight, false},
+
+    {"teal and orange", VCKeyword::TealAndOrange, false},
+    {"warm", VCKeyword::Warm, false},
+    {"sunset", VCKeyword::Sunset, false},
+    {"cool", VCKeyword::Cool, false},
+    {"blueish", VCKeyword::Blueish, false},
+    {"pastel", VCKeyword::Pastel, false},
+    {"high contrast", VCKeyword::HighContrast, false},
+    {"noir", VCKeyword::Noir, false},
+
+    {"top-down", VCKeyword::TopDownHyphen, false},
+    {"top down", VCKeyword::TopDown, false},
+    {"bird's-eye", VCKeyword::BirdsEye, false},
+    {"close-up", VCKeyword::CloseUpHyphen, false},
+    {"close up", VCKeyword::CloseUp, false},
+    {"portrait shot", VCKeyword::PortraitShot, false},
+    {"wide shot", VCKeyword::WideShot, false},
+    {"wide angle", VCKeyword::WideAngle, false},
+    {"low angle", VCKeyword::LowAngle, false},
+    {"high angle", VCKeyword::HighAngle, false},
+    {"isometric", VCKeyword::Isometric, false},
+
+    {"rule of thirds", VCKeyword::RuleOfThirds, false},
+    {"centered", VCKeyword::Centered, false},
+    {"symmetrical", VCKeyword::Symmetrical, false},
+    {"symmetry", VCKeyword::Symmetry, false},
+    {"golden ratio", VCKeyword::GoldenRatio, false},
+    {"leading lines", VCKeyword::LeadingLines, false},
+    {"symmetric", VCKeyword::Symmetric, false},
+
+    {"forest", VCKeyword::Forest, false},
+    {"city", VCKeyword::City, false},
+    {"space", VCKeyword::Space, false},
+    {"galaxy", VCKeyword::Galaxy, false},
+    {"nebula", VCKeyword::Nebula, false},
+    {"beach", VCKeyword::Beach, false},
+    {"ocean", VCKeyword::Ocean, false},
+    {"sea", VCKeyword::Sea, false},
+    {"night", VCKeyword::Night, false},
+    {"dawn", VCKeyword::Dawn, false},
+    {"sunrise", VCKeyword::Sunrise, false},
+    {"rain", VCKeyword::Rain, false},
+    {"fog", VCKeyword::Fog, false},
+    {"mist", VCKeyword::Mist, false},
+    {"snow", VCKeyword::Snow, false},
+
+    // Basic NSFW keyword blocking; can be extended server‑side. [file:1]
+    {"nsfw", VCKeyword::Count, true},
+    {"nude", VCKeyword::Count, true},
+    {"nudity", VCKeyword::Count, true},
+    {"porn", VCKeyword::Count, true},
+    {"explicit", VCKeyword::Count, true},
+    {"sexual", VCKeyword::Count, true},
+    {"erotic", VCKeyword::Count, true},
+};
+
+// Read-only byte-class DFA: next[state * numClasses + classOf[byte]].
+// Class 0 covers every byte no pattern uses, which keeps the dense
+// transition table small enough to stay in L1/L2.
+struct VCKeywordDFAView {
+    const uint8_t          *classOf;
+    std::size_t             numClasses;
+    const uint16_t         *next;
+    const VCKeywordHits    *out;
+    const uint8_t          *blockLen;
+    const VCKeywordPattern *patterns;      // table the DFA was built from
+    std::size_t             patternCount;
+    bool                    blockNested;   // a blocklist term contains another
+
+    // One pass over lowercase text. Keyword hits are OR‑ed into `hits`;
+    // onBlock(begin, end) fires for every blocklist match. All matches ending
+    // at a position are suffixes of the longest one, so reporting the longest
+    // covers them.
+    template <typename OnBlock>
+    void scan(const char *text, std::size_t len, VCKeywordHits &hits, OnBlock &&onBlock) const {
+        scanRange(0, text, 0, len, hits, onBlock);
+    }
+
+    // Resumable form for text that grows in place: continues from state `s`
+    // over text[from, to) and returns the state reached. onBlock positions
+    // index `text` and may start before `from`.
+    template <typename OnBlock>
+    std::size_t scanRange(std::size_t s, const char *text, std::size_t from, std::size_t to,
+                          VCKeywordHits &hits, OnBlock &&onBlock) const {
+        for (std::size_t i = from; i < to; ++i) {
+            s = next[s * numClasses + classOf[static_cast<unsigned char>(text[i])]];
+            hits.merge(out[s]);
+            if (blockLen[s])
+                onBlock(i + 1 - blockLen[s], i + 1);
+        }
+        return s;
+    }
+};
+
+constexpr std::size_t vcPatternLength(const char *s) {
+    std::size_t n = 0;
+    while (s[n]) ++n;
+    return n;
+}
+
+constexpr std::size_t vcCountByteClasses(const VCKeywordPattern *patterns, std::size_t count) {
+    bool seen[256] = {};
+    std::size_t classes = 1;
+    for (std::size_t p = 0; p < count; ++p) {
+        for (const char *c = patterns[p].text; *c; ++c) {
+            const unsigned char u = static_cast<unsigned char>(*c);
+            if (!seen[u]) {
+                seen[u] = true;
+                ++classes;
+            }
+        }
+    }
+    return classes;
 }
 
-static std::string collapseWhitespace(const std::string &in) {
+// Exact trie size: each pattern adds the nodes past its longest common
+// prefix with any earlier pattern.
+constexpr std::size_t vcCountTrieStates(const VCKeywordPattern *patterns, std::size_t count) {
+    std::size_t states = 1;
+    for (std::size_t p = 0; p < count; ++p) {
+        const std::size_t len = vcPatternLength(patterns[p].text);
+        std::size_t shared = 0;
+        for (std::size_t q = 0; q < p; ++q) {
+            std::size_t l = 0;
+            while (l < len && patterns[q].text[l] == patterns[p].text[l]) ++l;
+            shared = std::max(shared, l);
+        }
+        states += len - shared;
+    }
+    return states;
+}
+
+// Aho‑Corasick construction, usable at compile time and at runtime. Store
+// provides classOf[256], numClasses, next(i), out(s), blockLen(s),
+// addState(), patterns, patternCount and blockNested; fail and queue are
+// scratch arrays with one slot per state. `patterns` must outlive the DFA.
+template <typename Store>
+constexpr void vcBuildKeywordDFA(Store &dfa,
+                                 const VCKeywordPattern *patterns,
+                                 std::size_t count,
+                                 uint16_t *fail,
+                                 uint16_t *queue) {
+    constexpr uint16_t kNone = 0xFFFF;
+    dfa.patterns = patterns;
+    dfa.patternCount = count;
+    dfa.blockNested = false;
+    for (std::size_t i = 0; i < 256; ++i) dfa.classOf[i] = 0;
+    dfa.numClasses = 1;
+    for (std::size_t p = 0; p < count; ++p) {
+        for (const char *c = patterns[p].text; *c; ++c) {
+            const unsigned char u = static_cast<unsigned char>(*c);
+            if (dfa.classOf[u] == 0)
+                dfa.classOf[u] = static_cast<uint8_t>(dfa.numClasses++);
+        }
+    }
+
+    const std::size_t C = dfa.numClasses;
+    dfa.addState();
+    for (std::size_t p = 0; p < count; ++p) {
+        std::size_t s = 0;
+        std::size_t len = 0;
+        for (const char *c = patterns[p].text; *c; ++c, ++len) {
+            const std::size_t slot = s * C + dfa.classOf[static_cast<unsigned char>(*c)];
+            if (dfa.next(slot) == kNone) {
+                const uint16_t child = dfa.addState();  // may grow storage
+                dfa.next(slot) = child;
+            }
+            s = dfa.next(slot);
+        }
+        if (patterns[p].block)
+            dfa.blockLen(s) = std::max<uint8_t>(dfa.blockLen(s), static_cast<uint8_t>(len));
+        else
+            dfa.out(s).set(patterns[p].keyword);
+    }
+
+    // BFS turns the trie into a complete DFA; outputs are merged along
+    // failure links so every state carries all matches ending there.
+    std::size_t tail = 0;
+    for (std::size_t c = 0; c < C; ++c) {
+        if (dfa.next(c) == kNone) {
+            dfa.next(c) = 0;
+        } else {
+            fail[dfa.next(c)] = 0;
+            queue[tail++] = dfa.next(c);
+        }
+    }
+    for (std::size_t head = 0; head < tail; ++head) {
+        const std::size_t s = queue[head];
+        for (std::size_t c = 0; c < C; ++c) {
+            const uint16_t viaFail = dfa.next(fail[s] * C + c);
+            const uint16_t child = dfa.next(s * C + c);
+            if (child == kNone) {
+                dfa.next(s * C + c) = viaFail;
+            } else {
+                fail[child] = viaFail;
+                dfa.out(child).merge(dfa.out(viaFail));
+                // A blocklist term ending here with a shorter one as suffix.
+                if (dfa.blockLen(child) != 0 && dfa.blockLen(viaFail) != 0)
+                    dfa.blockNested = true;
+                dfa.blockLen(child) = std::max(dfa.blockLen(child), dfa.blockLen(viaFail));
+                queue[tail++] = child;
+            }
+        }
+    }
+    // A blocklist term ending strictly inside another one.
+    for (std::size_t p = 0; p < count && !dfa.blockNested; ++p) {
+        if (!patterns[p].block) continue;
+        std::size_t s = 0;
+        for (const char *c = patterns[p].text; c[0] && c[1]; ++c) {
+            s = dfa.next(s * C + dfa.classOf[static_cast<unsigned char>(*c)]);
+            if (dfa.blockLen(s) != 0) {
+                dfa.blockNested = true;
+                break;
+            }
+        }
+    }
+}
+
+// Fixed-capacity DFA storage, sized exactly for a constexpr pattern table.
+template <std::size_t States, std::size_t Classes>
+struct VCStaticKeywordDFA {
+    static constexpr std::size_t kStates = States;
+
+    uint8_t       classOf[256] = {};
+    std::size_t   numClasses = 0;
+    std::size_t   numStates = 0;
+    uint16_t      nextTable[States * Classes] = {};
+    VCKeywordHits outTable[States] = {};
+    uint8_t       blockTable[States] = {};
+    const VCKeywordPattern *patterns = nullptr;
+    std::size_t   patternCount = 0;
+    bool          blockNested = false;
+
+    constexpr uint16_t addState() {
+        if (numStates >= States || numClasses != Classes)
+            throw std::logic_error("VCStaticKeywordDFA capacity mismatch");
+        for (std::size_t c = 0; c < Classes; ++c)
+            nextTable[numStates * Classes + c] = 0xFFFF;
+        return static_cast<uint16_t>(numStates++);
+    }
+    constexpr uint16_t &next(std::size_t i) { return nextTable[i]; }
+    constexpr VCKeywordHits &out(std::size_t s) { return outTable[s]; }
+    constexpr uint8_t &blockLen(std::size_t s) { return blockTable[s]; }
+
+    constexpr VCKeywordDFAView view() const {
+        return VCKeywordDFAView{classOf,  numClasses,   nextTable,  outTable,
+                                blockTable, patterns, patternCount, blockNested};
+    }
+};
+
+constexpr std::size_t kRouterPatternCount = sizeof(kRouterPatterns) / sizeof(kRouterPatterns[0]);
+
+using VCRouterKeywordDFA =
+    VCStaticKeywordDFA<vcCountTrieStates(kRouterPatterns, kRouterPatternCount),
+                       vcCountByteClasses(kRouterPatterns, kRouterPatternCount)>;
+
+constexpr VCRouterKeywordDFA vcMakeRouterKeywordDFA() {
+    VCRouterKeywordDFA dfa{};
+    uint16_t fail[VCRouterKeywordDFA::kStates] = {};
+    uint16_t queue[VCRouterKeywordDFA::kStates] = {};
+    vcBuildKeywordDFA(dfa, kRouterPatterns, kRouterPatternCount, fail, queue);
+    return dfa;
+}
+
+// Built entirely by the compiler: the tables live in .rodata, so startup does
+// no construction and every process mapping this binary shares the pages.
+static constexpr VCRouterKeywordDFA kRouterKeywordDFA = vcMakeRouterKeywordDFA();
+
+static constexpr VCKeywordDFAView routerAutomaton() {
+    return kRouterKeywordDFA.view();
+}
+
+// Everything the planner takes from rule tables: the keyword/blocklist
+// automaton and the default negative constraints. The built-in set below is
+// compiled in; vlig_router_rule_store.cpp loads replacements from config.
+struct VCRouterRules {
+    VCKeywordDFAView automaton;
+    std::string_view visualArtifacts;
+    std::string_view contentExclusions;
+};
+
+static constexpr VCRouterRules kBuiltinRouterRules{
+    routerAutomaton(),
+    "blurry, extra limbs, distorted faces, text artifacts",
+    "no gore, no real-world logos"};
+
+// Puts a configured pattern in the shape the sanitizer gives prompt text
+// (lowercase, single spaces) so it can match the lowercase buffer.
+static inline std::string normalizeKeywordPattern(std::string_view value) {
     std::string out;
-    out.reserve(in.size());
-    bool space = false;
-    for (char c : in) {
+    out.reserve(value.size());
+    for (char c : value) {
         if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
-            if (!space) {
+            if (!out.empty() && out.back() != ' ')
                 out.push_back(' ');
-                space = true;
-            }
         } else {
-            out.push_back(c);
-            space = false;
+            out.push_back(toLowerASCII(c));
         }
     }
     if (!out.empty() && out.back() == ' ')
@@ -148,52 +1122,195 @@ static std::string collapseWhitespace(const std::string &in) {
     return out;
 }
 
-static std::string toLowerASCII(const std::string &in) {
-    std::string out;
-    out.reserve(in.size());
-    for (char c : in) {
-        if (c >= 'A' && c <= 'Z')
-            out.push_back(static_cast<char>(c - 'A' + 'a'));
-        else
-            out.push_back(c);
-    }
-    return out;
-}
+// Blocklist match [begin, end) reported by the automaton.
+struct VCBlockSpan {
+    std::size_t begin;
+    std::size_t end;
+};
 
-// Basic NSFW keyword blocking; can be extended server‑side. [file:1]
-static std::string stripNSFWMarkers(const std::string &in) {
-    static const char* kBlockList[] = {
-        "nsfw", "nude", "nudity", "porn", "explicit", "sexual", "erotic"
-    };
-    std::string lower = toLowerASCII(in);
-    std::string out = in;
-    for (const char* token : kBlockList) {
-        std::string t(token);
-        std::size_t pos = 0;
-        while (true) {
-            pos = lower.find(t, pos);
-            if (pos == std::string::npos) break;
-            for (std::size_t i = 0; i < t.size() && (pos + i) < out.size(); ++i) {
-                out[pos + i] = '*';
-                lower[pos + i] = '*';
+// Masks the blocklist matches `spans` (in scan order) in both the
+// original-case text and its unmasked lowercase copy. The result is that of
+// the original find-and-mask loop: terms in table order, each masking its
+// leftmost non-overlapping occurrences not already touched by an earlier
+// term, so "nuderotic" becomes "****rotic". When the spans are pairwise
+// disjoint and no term contains another, that is every span, which is the
+// common case; otherwise the loop itself runs. Returns true if anything was
+// masked.
+static bool applyBlockSpans(std::string &text, std::string &lower, const VCBlockSpan *spans,
+                            std::size_t count, const VCKeywordDFAView &automaton) {
+    if (count == 0) return false;
+    bool disjoint = !automaton.blockNested;
+    for (std::size_t i = 1; disjoint && i < count; ++i)
+        disjoint = spans[i].begin >= spans[i - 1].end;
+    if (disjoint) {
+        for (std::size_t k = 0; k < count; ++k) {
+            for (std::size_t i = spans[k].begin; i < spans[k].end; ++i) {
+                text[i] = '*';
+                lower[i] = '*';
             }
-            pos += t.size();
         }
+        return true;
     }
-    return out;
+    bool masked = false;
+    for (std::size_t p = 0; p < automaton.patternCount; ++p) {
+        if (!automaton.patterns[p].block) continue;
+        const std::string_view term(automaton.patterns[p].text);
+        for (std::size_t pos = lower.find(term); pos != std::string::npos;
+             pos = lower.find(term, pos + term.size())) {
+            for (std::size_t i = pos; i < pos + term.size(); ++i) {
+                text[i] = '*';
+                lower[i] = '*';
+            }
+            masked = true;
+        }
+    }
+    return masked;
+}
+
+// Masks blocklist matches in both the original-case text and its lowercase
+// copy, collecting keyword hits from the same automaton pass. Returns true if
+// anything was masked.
+static bool stripNSFWMarkers(std::string &text, std::string &lower, VCKeywordHits &hits,
+                             const VCKeywordDFAView &automaton = routerAutomaton()) {
+    thread_local std::vector<VCBlockSpan> spans;
+    spans.clear();
+    automaton.scan(lower.data(), lower.size(), hits,
+                   [&](std::size_t begin, std::size_t end) { spans.push_back({begin, end}); });
+    return applyBlockSpans(text, lower, spans.data(), spans.size(), automaton);
 }
 
-static std::string sanitizePromptForVision(const std::string &raw) {
+struct VCSanitizedPrompt {
+    VCPromptBuffers buffers;  // text + lower
+    VCKeywordHits   hits;     // keywords present in buffers.lower
+};
+
+// First stage of sanitizeAndScanPrompt: the fused cleaning pass only. What
+// follows is a deterministic function of this text, so it is also what the
+// plan cache keys on.
+static void cleanPromptText(const std::string &raw, VCPromptBuffers &buffers) {
     if (raw.empty())
         throw std::invalid_argument("empty prompt");
-    std::string step1 = stripControl(raw);
-    std::string step2 = collapseWhitespace(step1);
-    std::string step3 = stripNSFWMarkers(step2);
-    if (step3.empty())
+    VCPromptSanitizer sanitizer(buffers);
+    sanitizer.reset();
+    sanitizer.feed(raw.data(), raw.size());
+    sanitizer.finish();
+}
+
+// Applies the length cap to scanned text and settles the hits; `masked` says
+// whether the scan masked anything.
+static void finishScannedPrompt(VCSanitizedPrompt &p, bool masked,
+                                const VCRouterRules &rules = kBuiltinRouterRules) {
+    std::string &text = p.buffers.text;
+    std::string &lower = p.buffers.lower;
+    if (text.empty())
         throw std::runtime_error("prompt sanitized to empty");
-    if (step3.size() > 8000)
-        step3.resize(8000);
-    return step3;
+    bool truncated = false;
+    if (text.size() > 8000) {
+        // Back off to a sequence boundary so the cut never splits a character.
+        std::size_t cut = 8000;
+        while (cut > 0 && (static_cast<unsigned char>(text[cut]) & 0xC0) == 0x80)
+            --cut;
+        text.resize(cut);
+        lower.resize(cut);
+        truncated = true;
+    }
+    // Rare path: masking can break keywords that overlapped a blocked term,
+    // and truncation drops trailing ones; rescan the final text so hits match
+    // exactly what the planner sees.
+    if (masked || truncated) {
+        p.hits = VCKeywordHits{};
+        rules.automaton.scan(lower.data(), lower.size(), p.hits,
+                               [](std::size_t, std::size_t) {});
+    }
+}
+
+// Second stage: one automaton pass for keyword hits and blocklist masking,
+// then the length cap.
+static void scanCleanedPrompt(VCSanitizedPrompt &p,
+                              const VCRouterRules &rules = kBuiltinRouterRules) {
+    p.hits = VCKeywordHits{};
+    const bool masked = stripNSFWMarkers(p.buffers.text, p.buffers.lower, p.hits,
+                                         rules.automaton);
+    finishScannedPrompt(p, masked, rules);
+}
+
+// Sanitizes into `p`, reusing its buffers.
+static void sanitizeAndScanPrompt(const std::string &raw, VCSanitizedPrompt &p,
+                                  const VCRouterRules &rules = kBuiltinRouterRules) {
+    cleanPromptText(raw, p.buffers);
+    scanCleanedPrompt(p, rules);
+}
+
+// -----------------------------------------------------------------------------
+// Perfect hashing
+//
+// Lookup tables for small fixed string sets (enum names, JSON keys, word
+// lists), built by the compiler: a seed is searched until every key hashes to
+// its own power-of-two slot, so a lookup is one hash, one slot read and one
+// compare against the stored key.
+// -----------------------------------------------------------------------------
+
+// Length plus the first and last four bytes, mixed with one multiply: no
+// per-byte dependency chain. Keys that agree on all three cannot be
+// separated by any seed and fail the build instead of colliding.
+constexpr uint32_t vcPerfectHash(const char *s, std::size_t n, uint32_t seed) {
+    uint64_t head = 0;
+    uint64_t tail = 0;
+    const std::size_t k = n < 4 ? n : 4;
+    for (std::size_t i = 0; i < k; ++i) {
+        head |= static_cast<uint64_t>(static_cast<unsigned char>(s[i])) << (8 * i);
+        tail |= static_cast<uint64_t>(static_cast<unsigned char>(s[n - k + i])) << (8 * i);
+    }
+    uint64_t x = ((head << 32) | tail) + static_cast<uint64_t>(n) * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (static_cast<uint64_t>(seed) * 0xC2B2AE3D27D4EB4Full)) * 0xFF51AFD7ED558CCDull;
+    return static_cast<uint32_t>(x ^ (x >> 33));
+}
+
+template <std::size_t N, std::size_t Slots>
+struct VCPerfectHashTable {
+    static_assert((Slots & (Slots - 1)) == 0 && Slots >= N, "Slots: power of two >= N");
+    static_assert(N < 0xFFFF, "too many keys");
+
+    const char *keys[N] = {};
+    std::size_t lens[N] = {};
+    uint16_t slot[Slots] = {};  // key index + 1; 0 = empty
+    uint32_t seed = 0;
+
+    // Index of the key equal to [s, s + n), or -1.
+    int find(const char *s, std::size_t n) const {
+        const uint16_t e = slot[vcPerfectHash(s, n, seed) & (Slots - 1)];
+        if (e == 0 || lens[e - 1] != n || std::memcmp(keys[e - 1], s, n) != 0)
+            return -1;
+        return static_cast<int>(e - 1);
+    }
+};
+
+// Keys must be distinct; a set with no collision-free seed in range fails to
+// compile (the throw is reached during constant evaluation).
+template <std::size_t Slots, std::size_t N>
+constexpr VCPerfectHashTable<N, Slots> vcMakePerfectHashTable(const char *const (&keys)[N]) {
+    VCPerfectHashTable<N, Slots> t{};
+    for (std::size_t i = 0; i < N; ++i) {
+        t.keys[i] = keys[i];
+        t.lens[i] = vcPatternLength(keys[i]);
+    }
+    for (uint32_t seed = 1; seed < 200000; ++seed) {
+        for (std::size_t s = 0; s < Slots; ++s)
+            t.slot[s] = 0;
+        bool ok = true;
+        for (std::size_t i = 0; i < N && ok; ++i) {
+            const uint32_t h = vcPerfectHash(t.keys[i], t.lens[i], seed) & (Slots - 1);
+            if (t.slot[h] != 0)
+                ok = false;
+            else
+                t.slot[h] = static_cast<uint16_t>(i + 1);
+        }
+        if (ok) {
+            t.seed = seed;
+            return t;
+        }
+    }
+    throw std::logic_error("no perfect hash seed found");
 }
 
 struct VCSubjectDescriptor {
@@ -253,275 +1370,521 @@ struct VCScenePlan {
     VCQualityPreset            quality;
 };
 
-static VCAspectRatio guessAspectFromText(const std::string &lower) {
-    if (lower.find("vertical") != std::string::npos ||
-        lower.find("portrait") != std::string::npos ||
-        lower.find("9:16") != std::string::npos) {
+// Non-owning counterpart of VCScenePlan. Text taken from the prompt is a view
+// into the VCSanitizedPrompt buffers it was built from, fixed text points at
+// static storage, so building one allocates nothing; it stays valid until
+// those buffers are reused. toScenePlan() makes the owning copy.
+struct VCSubjectView {
+    std::string_view name;
+    std::string_view attributes;
+    std::string_view positionHint;
+};
+
+struct VCSubjectViewList {
+    const VCSubjectView *items = nullptr;
+    std::size_t          count = 0;
+
+    std::size_t size() const { return count; }
+    const VCSubjectView &operator[](std::size_t i) const { return items[i]; }
+};
+
+struct VCBackgroundView {
+    std::string_view environment;
+    std::string_view timeOfDay;
+    std::string_view weather;
+};
+
+struct VCColorLightingView {
+    VCColorTone      colorTone;
+    VCLighting       lighting;
+    std::string_view paletteHint;
+};
+
+struct VCArtStyleView {
+    VCArtStyle       style;
+    VCBrushDetail    brushDetail;
+    std::string_view eraHint;
+};
+
+struct VCNegativeConstraintsView {
+    std::string_view visualArtifacts;
+    std::string_view contentExclusions;
+};
+
+struct VCScenePlanView {
+    std::string_view           corePrompt;
+    VCSubjectView              primarySubject;
+    VCSubjectViewList          secondarySubjects;
+    VCBackgroundView           background;
+    VCColorLightingView        colorLighting;
+    VCCameraDescriptor         camera;
+    VCCompositionDescriptor    composition;
+    VCArtStyleView             artStyle;
+    VCNegativeConstraintsView  negatives;
+    VCAspectRatio              aspectRatio;
+    VCIGMode                   mode;
+    VCSafetyProfile            safety;
+    VCQualityPreset            quality;
+};
+
+static VCSubjectDescriptor toSubjectDescriptor(const VCSubjectView &v) {
+    VCSubjectDescriptor s;
+    s.name.assign(v.name.data(), v.name.size());
+    s.attributes.assign(v.attributes.data(), v.attributes.size());
+    s.positionHint.assign(v.positionHint.data(), v.positionHint.size());
+    return s;
+}
+
+static VCScenePlan toScenePlan(const VCScenePlanView &v) {
+    VCScenePlan plan{};
+    plan.corePrompt.assign(v.corePrompt.data(), v.corePrompt.size());
+    plan.primarySubject = toSubjectDescriptor(v.primarySubject);
+    plan.secondarySubjects.reserve(v.secondarySubjects.size());
+    for (std::size_t i = 0; i < v.secondarySubjects.size(); ++i)
+        plan.secondarySubjects.push_back(toSubjectDescriptor(v.secondarySubjects[i]));
+    plan.background.environment.assign(v.background.environment.data(), v.background.environment.size());
+    plan.background.timeOfDay.assign(v.background.timeOfDay.data(), v.background.timeOfDay.size());
+    plan.background.weather.assign(v.background.weather.data(), v.background.weather.size());
+    plan.colorLighting.colorTone = v.colorLighting.colorTone;
+    plan.colorLighting.lighting = v.colorLighting.lighting;
+    plan.colorLighting.paletteHint.assign(v.colorLighting.paletteHint.data(),
+                                          v.colorLighting.paletteHint.size());
+    plan.camera = v.camera;
+    plan.composition = v.composition;
+    plan.artStyle.style = v.artStyle.style;
+    plan.artStyle.brushDetail = v.artStyle.brushDetail;
+    plan.artStyle.eraHint.assign(v.artStyle.eraHint.data(), v.artStyle.eraHint.size());
+    plan.negatives.visualArtifacts.assign(v.negatives.visualArtifacts.data(),
+                                          v.negatives.visualArtifacts.size());
+    plan.negatives.contentExclusions.assign(v.negatives.contentExclusions.data(),
+                                            v.negatives.contentExclusions.size());
+    plan.aspectRatio = v.aspectRatio;
+    plan.mode = v.mode;
+    plan.safety = v.safety;
+    plan.quality = v.quality;
+    return plan;
+}
+
+static VCAspectRatio guessAspectFromText(const VCKeywordHits &hits) {
+    if (hits.any({VCKeyword::Vertical, VCKeyword::Portrait, VCKeyword::Ratio_9_16})) {
         return VCAspectRatio::Ratio_9_16;
     }
-    if (lower.find("cinematic") != std::string::npos ||
-        lower.find("wide") != std::string::npos ||
-        lower.find("16:9") != std::string::npos ||
-        lower.find("21:9") != std::string::npos) {
-        if (lower.find("21:9") != std::string::npos)
+    if (hits.any({VCKeyword::Cinematic, VCKeyword::Wide, VCKeyword::Ratio_16_9,
+                  VCKeyword::Ratio_21_9})) {
+        if (hits.has(VCKeyword::Ratio_21_9))
             return VCAspectRatio::Ratio_21_9;
         return VCAspectRatio::Ratio_16_9;
     }
-    if (lower.find("4:3") != std::string::npos)
+    if (hits.has(VCKeyword::Ratio_4_3))
         return VCAspectRatio::Ratio_4_3;
-    if (lower.find("3:4") != std::string::npos)
+    if (hits.has(VCKeyword::Ratio_3_4))
         return VCAspectRatio::Ratio_3_4;
     return VCAspectRatio::Ratio_1_1;
 }
 
-static VCArtStyle guessArtStyle(const std::string &lower) {
-    if (lower.find("photo") != std::string::npos ||
-        lower.find("photoreal") != std::string::npos ||
-        lower.find("realistic") != std::string::npos) {
+static VCArtStyle guessArtStyle(const VCKeywordHits &hits) {
+    if (hits.any({VCKeyword::Photo, VCKeyword::Photoreal, VCKeyword::Realistic})) {
         return VCArtStyle::Photorealistic;
     }
-    if (lower.find("anime") != std::string::npos ||
-        lower.find("manga") != std::string::npos) {
+    if (hits.any({VCKeyword::Anime, VCKeyword::Manga})) {
         return VCArtStyle::Anime;
     }
-    if (lower.find("watercolor") != std::string::npos) {
+    if (hits.has(VCKeyword::Watercolor)) {
         return VCArtStyle::Watercolor;
     }
-    if (lower.find("pixel") != std::string::npos) {
+    if (hits.has(VCKeyword::Pixel)) {
         return VCArtStyle::PixelArt;
     }
-    if (lower.find("line art") != std::string::npos ||
-        lower.find("sketch") != std::string::npos) {
+    if (hits.any({VCKeyword::LineArt, VCKeyword::Sketch})) {
         return VCArtStyle::LineArt;
     }
-    if (lower.find("low poly") != std::string::npos ||
-        lower.find("low-poly") != std::string::npos) {
+    if (hits.any({VCKeyword::LowPoly, VCKeyword::LowPolyHyphen})) {
         return VCArtStyle::LowPoly;
     }
-    if (lower.find("concept art") != std::string::npos ||
-        lower.find("key art") != std::string::npos) {
+    if (hits.any({VCKeyword::ConceptArt, VCKeyword::KeyArt})) {
         return VCArtStyle::ConceptArt;
     }
-    if (lower.find("painting") != std::string::npos ||
-        lower.find("digital painting") != std::string::npos) {
+    if (hits.any({VCKeyword::Painting, VCKeyword::DigitalPainting})) {
         return VCArtStyle::DigitalPainting;
     }
     return VCArtStyle::Unspecified;
 }
 
-static VCLighting guessLighting(const std::string &lower) {
-    if (lower.find("soft light") != std::string::npos ||
-        lower.find("soft lighting") != std::string::npos) {
+static VCLighting guessLighting(const VCKeywordHits &hits) {
+    if (hits.any({VCKeyword::SoftLight, VCKeyword::SoftLighting})) {
         return VCLighting::Soft;
     }
-    if (lower.find("dramatic") != std::string::npos ||
-        lower.find("cinematic light") != std::string::npos) {
+    if (hits.any({VCKeyword::Dramatic, VCKeyword::CinematicLight})) {
         return VCLighting::Dramatic;
     }
-    if (lower.find("studio") != std::string::npos ||
-        lower.find("three-point") != std::string::npos) {
+    if (hits.any({VCKeyword::Studio, VCKeyword::ThreePoint})) {
         return VCLighting::Studio;
     }
-    if (lower.find("hard light") != std::string::npos) {
+    if (hits.has(VCKeyword::HardLight)) {
         return VCLighting::Hard;
     }
     return VCLighting::Auto;
 }
 
-static VCColorTone guessColorTone(const std::string &lower) {
-    if (lower.find("teal and orange") != std::string::npos ||
-        lower.find("warm") != std::string::npos ||
-        lower.find("sunset") != std::string::npos) {
+static VCColorTone guessColorTone(const VCKeywordHits &hits) {
+    if (hits.any({VCKeyword::TealAndOrange, VCKeyword::Warm, VCKeyword::Sunset})) {
         return VCColorTone::Warm;
     }
-    if (lower.find("cool") != std::string::npos ||
-        lower.find("blueish") != std::string::npos) {
+    if (hits.any({VCKeyword::Cool, VCKeyword::Blueish})) {
         return VCColorTone::Cool;
     }
-    if (lower.find("pastel") != std::string::npos) {
+    if (hits.has(VCKeyword::Pastel)) {
         return VCColorTone::Pastel;
     }
-    if (lower.find("high contrast") != std::string::npos ||
-        lower.find("noir") != std::string::npos) {
+    if (hits.any({VCKeyword::HighContrast, VCKeyword::Noir})) {
         return VCColorTone::HighContrast;
     }
     return VCColorTone::Neutral;
 }
 
-static VCCameraAngle guessCameraAngle(const std::string &lower) {
-    if (lower.find("top-down") != std::string::npos ||
-        lower.find("top down") != std::string::npos ||
-        lower.find("bird's-eye") != std::string::npos) {
+static VCCameraAngle guessCameraAngle(const VCKeywordHits &hits) {
+    if (hits.any({VCKeyword::TopDownHyphen, VCKeyword::TopDown, VCKeyword::BirdsEye})) {
         return VCCameraAngle::TopDown;
     }
-    if (lower.find("close-up") != std::string::npos ||
-        lower.find("close up") != std::string::npos ||
-        lower.find("portrait shot") != std::string::npos) {
+    if (hits.any({VCKeyword::CloseUpHyphen, VCKeyword::CloseUp, VCKeyword::PortraitShot})) {
         return VCCameraAngle::CloseUp;
     }
-    if (lower.find("wide shot") != std::string::npos ||
-        lower.find("wide angle") != std::string::npos) {
+    if (hits.any({VCKeyword::WideShot, VCKeyword::WideAngle})) {
         return VCCameraAngle::WideShot;
     }
-    if (lower.find("low angle") != std::string::npos) {
+    if (hits.has(VCKeyword::LowAngle)) {
         return VCCameraAngle::LowAngle;
     }
-    if (lower.find("high angle") != std::string::npos) {
+    if (hits.has(VCKeyword::HighAngle)) {
         return VCCameraAngle::HighAngle;
     }
-    if (lower.find("isometric") != std::string::npos) {
+    if (hits.has(VCKeyword::Isometric)) {
         return VCCameraAngle::Isometric;
     }
     return VCCameraAngle::EyeLevel;
 }
 
-static VCCompositionRule guessComposition(const std::string &lower) {
-    if (lower.find("rule of thirds") != std::string::npos)
+static VCCompositionRule guessComposition(const VCKeywordHits &hits) {
+    if (hits.has(VCKeyword::RuleOfThirds))
         return VCCompositionRule::RuleOfThirds;
-    if (lower.find("centered") != std::string::npos ||
-        lower.find("symmetrical") != std::string::npos ||
-        lower.find("symmetry") != std::string::npos)
+    if (hits.any({VCKeyword::Centered, VCKeyword::Symmetrical, VCKeyword::Symmetry}))
         return VCCompositionRule::Centered;
-    if (lower.find("golden ratio") != std::string::npos)
+    if (hits.has(VCKeyword::GoldenRatio))
         return VCCompositionRule::GoldenRatio;
-    if (lower.find("leading lines") != std::string::npos)
+    if (hits.has(VCKeyword::LeadingLines))
         return VCCompositionRule::LeadingLines;
-    if (lower.find("symmetric") != std::string::npos)
+    if (hits.has(VCKeyword::Symmetric))
         return VCCompositionRule::Symmetric;
     return VCCompositionRule::None;
 }
 
-// A minimal noun guesser: pick last "main" word as subject name.
-static std::string guessSubjectName(const std::string &prompt) {
-    std::string lower = toLowerASCII(prompt);
-    // crude split on spaces
-    std::vector<std::string> tokens;
-    {
-        std::string cur;
-        for (char c : lower) {
-            if (c == ' ' || c == ',' || c == '.' || c == '!' || c == '?') {
-                if (!cur.empty()) {
-                    tokens.push_back(cur);
-                    cur.clear();
-                }
-            } else {
-                cur.push_back(c);
-            }
-        }
-        if (!cur.empty()) tokens.push_back(cur);
+// Splits text on the subject guesser's separators (space , . ! ?) and hands
+// out the tokens as views from either end; nothing is copied or allocated.
+class VCTokenizer {
+public:
+    explicit VCTokenizer(std::string_view text) : text_(text), front_(0), back_(text.size()) {}
+
+    static bool isSeparator(char c) {
+        return c == ' ' || c == ',' || c == '.' || c == '!' || c == '?';
     }
-    if (tokens.empty())
-        return "subject";
-    // Return last token that is not an article or preposition.
-    static const char* stopWords[] = {"a", "an", "the", "of", "in", "on", "with", "at", "to", "for"};
-    for (int i = static_cast<int>(tokens.size()) - 1; i >= 0; --i) {
-        bool isStop = false;
-        for (const char* s : stopWords) {
-            if (tokens[i] == s) {
-                isStop = true;
-                break;
-            }
-        }
-        if (!isStop)
-            return tokens[i];
+
+    // Next token from the front; false when none is left.
+    bool next(std::string_view &token) {
+        while (front_ < back_ && isSeparator(text_[front_])) ++front_;
+        if (front_ == back_) return false;
+        const std::size_t start = front_;
+        while (front_ < back_ && !isSeparator(text_[front_])) ++front_;
+        token = text_.substr(start, front_ - start);
+        return true;
     }
-    return tokens.back();
+
+    // Next token from the back; false when none is left.
+    bool prev(std::string_view &token) {
+        while (back_ > front_ && isSeparator(text_[back_ - 1])) --back_;
+        if (back_ == front_) return false;
+        const std::size_t end = back_;
+        while (back_ > front_ && !isSeparator(text_[back_ - 1])) --back_;
+        token = text_.substr(back_, end - back_);
+        return true;
+    }
+
+private:
+    std::string_view text_;
+    std::size_t front_;
+    std::size_t back_;
+};
+
+// Articles and prepositions the subject guesser skips.
+static constexpr const char *kSubjectStopWords[] = {
+    "a", "an", "the", "of", "in", "on", "with", "at", "to", "for"};
+static constexpr auto kSubjectStopWordTable = vcMakePerfectHashTable<16>(kSubjectStopWords);
+
+// A minimal noun guesser: pick last "main" word as subject name. The result
+// is a view into `lower` (or a literal).
+static std::string_view guessSubjectName(std::string_view lower) {
+    VCTokenizer tokens(lower);
+    std::string_view token;
+    if (!tokens.prev(token))
+        return "subject";
+    // Return last token that is not an article or preposition; if all are,
+    // the last token.
+    const std::string_view last = token;
+    do {
+        if (kSubjectStopWordTable.find(token.data(), token.size()) < 0)
+            return token;
+    } while (tokens.prev(token));
+    return last;
 }
 
-// Main parser from user text into a structured scene plan. [file:1]
-static VCScenePlan buildScenePlanFromPrompt(const std::string &rawPrompt,
-                                            VCIGMode igMode,
-                                            VCSafetyProfile safety,
-                                            VCQualityPreset quality) {
-    VCScenePlan plan{};
-    plan.corePrompt = sanitizePromptForVision(rawPrompt);
-    std::string lower = toLowerASCII(plan.corePrompt);
+// Builds the plan from an already sanitized prompt, as views into `prompt`,
+// `rules` and string literals.
+static VCScenePlanView buildScenePlanView(const VCSanitizedPrompt &prompt,
+                                          VCIGMode igMode,
+                                          VCSafetyProfile safety,
+                                          VCQualityPreset quality,
+                                          const VCRouterRules &rules = kBuiltinRouterRules) {
+    VCScenePlanView plan{};
+    const VCKeywordHits &hits = prompt.hits;
+    plan.corePrompt = prompt.buffers.text;
 
     plan.mode   = igMode;
     plan.safety = safety;
     plan.quality = quality;
 
-    plan.aspectRatio = guessAspectFromText(lower);
-    plan.artStyle.style = guessArtStyle(lower);
+    plan.aspectRatio = guessAspectFromText(hits);
+    plan.artStyle.style = guessArtStyle(hits);
     plan.artStyle.brushDetail = VCBrushDetail::Normal;
     plan.artStyle.eraHint = "";
 
-    plan.colorLighting.colorTone = guessColorTone(lower);
-    plan.colorLighting.lighting  = guessLighting(lower);
+    plan.colorLighting.colorTone = guessColorTone(hits);
+    plan.colorLighting.lighting  = guessLighting(hits);
     plan.colorLighting.paletteHint = "";
 
-    plan.camera.angle = guessCameraAngle(lower);
+    plan.camera.angle = guessCameraAngle(hits);
     plan.camera.focalLengthMM = 35.0f;
     plan.camera.depthOfField = (plan.camera.angle == VCCameraAngle::CloseUp);
 
-    plan.composition.rule = guessComposition(lower);
+    plan.composition.rule = guessComposition(hits);
     plan.composition.allowCropping = true;
     plan.composition.centerMainSubject = true;
 
-    plan.primarySubject.name = guessSubjectName(plan.corePrompt);
+    plan.primarySubject.name = guessSubjectName(prompt.buffers.lower);
     plan.primarySubject.attributes = "";
     plan.primarySubject.positionHint = "center";
 
     plan.background.environment = "";
-    if (lower.find("forest") != std::string::npos)
+    if (hits.has(VCKeyword::Forest))
         plan.background.environment = "forest";
-    else if (lower.find("city") != std::string::npos)
+    else if (hits.has(VCKeyword::City))
         plan.background.environment = "city";
-    else if (lower.find("space") != std::string::npos ||
-             lower.find("galaxy") != std::string::npos ||
-             lower.find("nebula") != std::string::npos)
+    else if (hits.any({VCKeyword::Space, VCKeyword::Galaxy, VCKeyword::Nebula}))
         plan.background.environment = "space";
-    else if (lower.find("beach") != std::string::npos ||
-             lower.find("ocean") != std::string::npos ||
-             lower.find("sea") != std::string::npos)
+    else if (hits.any({VCKeyword::Beach, VCKeyword::Ocean, VCKeyword::Sea}))
         plan.background.environment = "seaside";
 
     plan.background.timeOfDay = "";
-    if (lower.find("sunset") != std::string::npos)
+    if (hits.has(VCKeyword::Sunset))
         plan.background.timeOfDay = "sunset";
-    else if (lower.find("night") != std::string::npos)
+    else if (hits.has(VCKeyword::Night))
         plan.background.timeOfDay = "night";
-    else if (lower.find("dawn") != std::string::npos ||
-             lower.find("sunrise") != std::string::npos)
+    else if (hits.any({VCKeyword::Dawn, VCKeyword::Sunrise}))
         plan.background.timeOfDay = "dawn";
 
     plan.background.weather = "";
-    if (lower.find("rain") != std::string::npos)
+    if (hits.has(VCKeyword::Rain))
         plan.background.weather = "rainy";
-    else if (lower.find("fog") != std::string::npos ||
-             lower.find("mist") != std::string::npos)
+    else if (hits.any({VCKeyword::Fog, VCKeyword::Mist}))
         plan.background.weather = "foggy";
-    else if (lower.find("snow") != std::string::npos)
+    else if (hits.has(VCKeyword::Snow))
         plan.background.weather = "snowy";
 
-    plan.negatives.visualArtifacts   = "blurry, extra limbs, distorted faces, text artifacts";
-    plan.negatives.contentExclusions = "no gore, no real-world logos";
+    plan.negatives.visualArtifacts   = rules.visualArtifacts;
+    plan.negatives.contentExclusions = rules.contentExclusions;
 
     return plan;
 }
 
-static std::string jsonEscape(const std::string &in) {
-    std::string out;
-    out.reserve(in.size() + 8);
-    for (char c : in) {
+static VCScenePlan buildScenePlanFromSanitized(const VCSanitizedPrompt &prompt,
+                                               VCIGMode igMode,
+                                               VCSafetyProfile safety,
+                                               VCQualityPreset quality) {
+    return toScenePlan(buildScenePlanView(prompt, igMode, safety, quality));
+}
+
+// Main parser from user text into a structured scene plan. [file:1]
+static VCScenePlan buildScenePlanFromPrompt(const std::string &rawPrompt,
+                                            VCIGMode igMode,
+                                            VCSafetyProfile safety,
+                                            VCQualityPreset quality) {
+    thread_local VCSanitizedPrompt prompt;
+    sanitizeAndScanPrompt(rawPrompt, prompt);
+    return buildScenePlanFromSanitized(prompt, igMode, safety, quality);
+}
+
+// -----------------------------------------------------------------------------
+// JSON writer
+//
+// Appends straight into one caller-owned std::string: the buffer is sized once
+// from an estimate (grown only if a field overruns it), keys and punctuation
+// are compile-time literals, strings are escaped 16 bytes at a time and floats
+// are formatted on the stack. With a warm buffer a plan serializes without
+// allocating.
+// -----------------------------------------------------------------------------
+
+static inline unsigned countTrailingZeros64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+    unsigned n = 0;
+    while ((x & 1u) == 0) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+class VCJsonWriter {
+public:
+    VCJsonWriter(std::string &out, std::size_t sizeHint) : out_(out), pos_(out.size()) {
+        out_.resize(pos_ + sizeHint);
+    }
+
+    template <std::size_t N>
+    void literal(const char (&s)[N]) {
+        std::memcpy(reserve(N - 1), s, N - 1);
+        pos_ += N - 1;
+    }
+
+    // Quoted value that never needs escaping (enum names).
+    void quoted(const char *s) {
+        const std::size_t n = std::strlen(s);
+        char *d = reserve(n + 2);
+        d[0] = '"';
+        std::memcpy(d + 1, s, n);
+        d[n + 1] = '"';
+        pos_ += n + 2;
+    }
+
+    // Quoted, escaped string: '"', '\\', '\n', '\r', '\t' are escaped, other
+    // control characters dropped, everything else copied through.
+    void string(std::string_view s) {
+        const char *src = s.data();
+        const std::size_t n = s.size();
+        char *const begin = reserve(2 * n + 2 + 16);  // +16: vector store overrun
+        char *d = begin;
+        *d++ = '"';
+        std::size_t i = 0;
+#if defined(VC_VLIG_SSE2)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i bslash = _mm_set1_epi8('\\');
+        const __m128i ctl = _mm_set1_epi8(0x1F);
+        while (i + 16 <= n) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(d), v);
+            const __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v));
+            const uint64_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+            if (mask == 0) {
+                d += 16;
+                i += 16;
+                continue;
+            }
+            const unsigned k = countTrailingZeros64(mask);
+            d = escapeByte(src[i + k], d + k);
+            i += k + 1;
+        }
+#elif defined(VC_VLIG_NEON)
+        const uint8x16_t quote = vdupq_n_u8('"');
+        const uint8x16_t bslash = vdupq_n_u8('\\');
+        const uint8x16_t ctl = vdupq_n_u8(0x20);
+        while (i + 16 <= n) {
+            const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t *>(src + i));
+            vst1q_u8(reinterpret_cast<uint8_t *>(d), v);
+            const uint8x16_t special =
+                vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, bslash)), vcltq_u8(v, ctl));
+            // 4 bits per byte lane.
+            const uint64_t mask = vget_lane_u64(
+                vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(special), 4)), 0);
+            if (mask == 0) {
+                d += 16;
+                i += 16;
+                continue;
+            }
+            const unsigned k = countTrailingZeros64(mask) >> 2;
+            d = escapeByte(src[i + k], d + k);
+            i += k + 1;
+        }
+#endif
+        for (; i < n; ++i)
+            d = escapeByte(src[i], d);
+        *d++ = '"';
+        pos_ += static_cast<std::size_t>(d - begin);
+    }
+
+    // Same text as std::to_string(float) ("%f"). Whole numbers, the usual
+    // case for focal lengths, skip printf entirely.
+    void number(float v) {
+        char *d = reserve(64);
+        const double x = v;
+        if (x >= 0.0 && x < 4294967296.0 && !std::signbit(x) &&
+            x == static_cast<double>(static_cast<uint32_t>(x))) {
+            char digits[10];
+            int n = 0;
+            uint32_t u = static_cast<uint32_t>(x);
+            do {
+                digits[n++] = static_cast<char>('0' + u % 10);
+                u /= 10;
+            } while (u != 0);
+            for (int k = 0; k < n; ++k)
+                d[k] = digits[n - 1 - k];
+            std::memcpy(d + n, ".000000", 7);
+            pos_ += static_cast<std::size_t>(n) + 7;
+            return;
+        }
+        char buf[64];
+        const int n = std::snprintf(buf, sizeof(buf), "%f", x);
+        if (n > 0 && static_cast<std::size_t>(n) < sizeof(buf)) {
+            std::memcpy(d, buf, static_cast<std::size_t>(n));
+            pos_ += static_cast<std::size_t>(n);
+        }
+    }
+
+    void boolean(bool b) {
+        if (b) literal("true");
+        else literal("false");
+    }
+
+    // Trims the buffer to what was written.
+    void finish() { out_.resize(pos_); }
+
+private:
+    std::string &out_;
+    std::size_t pos_;
+
+    char *reserve(std::size_t n) {
+        if (out_.size() - pos_ < n)
+            out_.resize(std::max(out_.size() * 2, pos_ + n));
+        return &out_[0] + pos_;
+    }
+
+    static char *escapeByte(char c, char *d) {
         switch (c) {
-            case '\"': out += "\\\""; break;
-            case '\\': out += "\\\\"; break;
-            case '\n': out += "\\n"; break;
-            case '\r': out += "\\r"; break;
-            case '\t': out += "\\t"; break;
+            case '\"': *d++ = '\\'; *d++ = '\"'; break;
+            case '\\': *d++ = '\\'; *d++ = '\\'; break;
+            case '\n': *d++ = '\\'; *d++ = 'n'; break;
+            case '\r': *d++ = '\\'; *d++ = 'r'; break;
+            case '\t': *d++ = '\\'; *d++ = 't'; break;
             default:
-                if (static_cast<unsigned char>(c) < 32) {
-                    // drop other control chars
-                } else {
-                    out.push_back(c);
-                }
+                if (static_cast<unsigned char>(c) >= 32)  // drop other control chars
+                    *d++ = c;
         }
+        return d;
     }
-    return out;
-}
+};
 
-static const char* toString(VCAspectRatio r) {
+static constexpr const char* toString(VCAspectRatio r) {
     switch (r) {
         case VCAspectRatio::Ratio_1_1:  return "1:1";
         case VCAspectRatio::Ratio_16_9: return "16:9";
@@ -533,7 +1896,7 @@ static const char* toString(VCAspectRatio r) {
     return "1:1";
 }
 
-static const char* toString(VCIGMode m) {
+static constexpr const char* toString(VCIGMode m) {
     switch (m) {
         case VCIGMode::TextToImage: return "text-to-image";
         case VCIGMode::ImageToImage: return "image-to-image";
@@ -543,7 +1906,7 @@ static const char* toString(VCIGMode m) {
     return "text-to-image";
 }
 
-static const char* toString(VCSafetyProfile s) {
+static constexpr const char* toString(VCSafetyProfile s) {
     switch (s) {
         case VCSafetyProfile::Safe:      return "safe";
         case VCSafetyProfile::AllowNSFW: return "allow-nsfw";
@@ -551,7 +1914,7 @@ static const char* toString(VCSafetyProfile s) {
     return "safe";
 }
 
-static const char* toString(VCQualityPreset q) {
+static constexpr const char* toString(VCQualityPreset q) {
     switch (q) {
         case VCQualityPreset::Draft:    return "draft";
         case VCQualityPreset::Standard: return "standard";
@@ -561,7 +1924,7 @@ static const char* toString(VCQualityPreset q) {
     return "standard";
 }
 
-static const char* toString(VCColorTone t) {
+static constexpr const char* toString(VCColorTone t) {
     switch (t) {
         case VCColorTone::Neutral:      return "neutral";
         case VCColorTone::Warm:         return "warm";
@@ -572,7 +1935,7 @@ static const char* toString(VCColorTone t) {
     return "neutral";
 }
 
-static const char* toString(VCLighting l) {
+static constexpr const char* toString(VCLighting l) {
     switch (l) {
         case VCLighting::Auto:     return "auto";
         case VCLighting::Soft:     return "soft";
@@ -583,7 +1946,7 @@ static const char* toString(VCLighting l) {
     return "auto";
 }
 
-static const char* toString(VCCameraAngle a) {
+static constexpr const char* toString(VCCameraAngle a) {
     switch (a) {
         case VCCameraAngle::EyeLevel:  return "eye-level";
         case VCCameraAngle::LowAngle:  return "low-angle";
@@ -596,7 +1959,7 @@ static const char* toString(VCCameraAngle a) {
     return "eye-level";
 }
 
-static const char* toString(VCCompositionRule r) {
+static constexpr const char* toString(VCCompositionRule r) {
     switch (r) {
         case VCCompositionRule::None:         return "none";
         case VCCompositionRule::RuleOfThirds: return "rule-of-thirds";
@@ -608,7 +1971,7 @@ static const char* toString(VCCompositionRule r) {
     return "none";
 }
 
-static const char* toString(VCArtStyle s) {
+static constexpr const char* toString(VCArtStyle s) {
     switch (s) {
         case VCArtStyle::Unspecified:     return "unspecified";
         case VCArtStyle::Photorealistic:  return "photorealistic";
@@ -623,7 +1986,7 @@ static const char* toString(VCArtStyle s) {
     return "unspecified";
 }
 
-static const char* toString(VCBrushDetail d) {
+static constexpr const char* toString(VCBrushDetail d) {
     switch (d) {
         case VCBrushDetail::Auto:   return "auto";
         case VCBrushDetail::Minimal:return "minimal";
@@ -634,81 +1997,131 @@ static const char* toString(VCBrushDetail d) {
     return "normal";
 }
 
-static std::string serializeScenePlanToJSON(const VCScenePlan &p) {
-    std::string j;
-    j.reserve(4096);
-    j += "{";
+// Upper bound for everything but the escaped strings: keys, punctuation, enum
+// names and the focal length.
+static constexpr std::size_t kScenePlanJSONSkeleton = 1024;
+static constexpr std::size_t kSubjectJSONSkeleton = 64;
+
+// The serializer is shared by VCScenePlan and VCScenePlanView, which have the
+// same members.
+template <class Plan>
+static std::size_t estimateScenePlanJSONSize(const Plan &p) {
+    std::size_t text = p.corePrompt.size() + p.primarySubject.name.size() +
+                       p.primarySubject.attributes.size() +
+                       p.primarySubject.positionHint.size() + p.background.environment.size() +
+                       p.background.timeOfDay.size() + p.background.weather.size() +
+                       p.colorLighting.paletteHint.size() + p.artStyle.eraHint.size() +
+                       p.negatives.visualArtifacts.size() + p.negatives.contentExclusions.size();
+    std::size_t bound = kScenePlanJSONSkeleton;
+    for (std::size_t i = 0; i < p.secondarySubjects.size(); ++i) {
+        const auto &s = p.secondarySubjects[i];
+        text += s.name.size() + s.attributes.size() + s.positionHint.size();
+        bound += kSubjectJSONSkeleton;
+    }
+    // Plain text copies 1:1; escapes are rare, the writer grows if needed.
+    return bound + text + text / 8;
+}
 
-    j += "\"core_prompt\":\"" + jsonEscape(p.corePrompt) + "\",";
-    j += "\"mode\":\""; j += toString(p.mode); j += "\",";
-    j += "\"safety_profile\":\""; j += toString(p.safety); j += "\",";
-    j += "\"quality_preset\":\""; j += toString(p.quality); j += "\",";
-    j += "\"aspect_ratio\":\""; j += toString(p.aspectRatio); j += "\",";
+template <class Subject>
+static void writeSubjectJSON(VCJsonWriter &w, const Subject &s) {
+    w.literal("{\"name\":");
+    w.string(s.name);
+    w.literal(",\"attributes\":");
+    w.string(s.attributes);
+    w.literal(",\"position_hint\":");
+    w.string(s.positionHint);
+    w.literal("}");
+}
+
+// Appends the control JSON for `p` to `out` (batch output, NDJSON).
+template <class Plan>
+static void appendScenePlanJSON(const Plan &p, std::string &out) {
+    VCJsonWriter w(out, estimateScenePlanJSONSize(p));
+
+    w.literal("{\"core_prompt\":");
+    w.string(p.corePrompt);
+    w.literal(",\"mode\":");
+    w.quoted(toString(p.mode));
+    w.literal(",\"safety_profile\":");
+    w.quoted(toString(p.safety));
+    w.literal(",\"quality_preset\":");
+    w.quoted(toString(p.quality));
+    w.literal(",\"aspect_ratio\":");
+    w.quoted(toString(p.aspectRatio));
 
     // Primary subject
-    j += "\"primary_subject\":{";
-    j += "\"name\":\"" + jsonEscape(p.primarySubject.name) + "\",";
-    j += "\"attributes\":\"" + jsonEscape(p.primarySubject.attributes) + "\",";
-    j += "\"position_hint\":\"" + jsonEscape(p.primarySubject.positionHint) + "\"";
-    j += "},";
+    w.literal(",\"primary_subject\":");
+    writeSubjectJSON(w, p.primarySubject);
 
     // Secondary subjects
-    j += "\"secondary_subjects\":[";
+    w.literal(",\"secondary_subjects\":[");
     for (std::size_t i = 0; i < p.secondarySubjects.size(); ++i) {
-        const auto &s = p.secondarySubjects[i];
-        j += "{";
-        j += "\"name\":\"" + jsonEscape(s.name) + "\",";
-        j += "\"attributes\":\"" + jsonEscape(s.attributes) + "\",";
-        j += "\"position_hint\":\"" + jsonEscape(s.positionHint) + "\"";
-        j += "}";
-        if (i + 1 < p.secondarySubjects.size())
-            j += ",";
+        if (i != 0)
+            w.literal(",");
+        writeSubjectJSON(w, p.secondarySubjects[i]);
     }
-    j += "],";
+    w.literal("]");
 
     // Background
-    j += "\"background\":{";
-    j += "\"environment\":\"" + jsonEscape(p.background.environment) + "\",";
-    j += "\"time_of_day\":\"" + jsonEscape(p.background.timeOfDay) + "\",";
-    j += "\"weather\":\"" + jsonEscape(p.background.weather) + "\"";
-    j += "},";
+    w.literal(",\"background\":{\"environment\":");
+    w.string(p.background.environment);
+    w.literal(",\"time_of_day\":");
+    w.string(p.background.timeOfDay);
+    w.literal(",\"weather\":");
+    w.string(p.background.weather);
+    w.literal("}");
 
     // Color + lighting
-    j += "\"color_lighting\":{";
-    j += "\"color_tone\":\""; j += toString(p.colorLighting.colorTone); j += "\",";
-    j += "\"lighting\":\""; j += toString(p.colorLighting.lighting); j += "\",";
-    j += "\"palette_hint\":\"" + jsonEscape(p.colorLighting.paletteHint) + "\"";
-    j += "},";
+    w.literal(",\"color_lighting\":{\"color_tone\":");
+    w.quoted(toString(p.colorLighting.colorTone));
+    w.literal(",\"lighting\":");
+    w.quoted(toString(p.colorLighting.lighting));
+    w.literal(",\"palette_hint\":");
+    w.string(p.colorLighting.paletteHint);
+    w.literal("}");
 
     // Camera
-    j += "\"camera\":{";
-    j += "\"angle\":\""; j += toString(p.camera.angle); j += "\",";
-    j += "\"focal_length_mm\":"; j += std::to_string(p.camera.focalLengthMM); j += ",";
-    j += "\"depth_of_field\":"; j += (p.camera.depthOfField ? "true" : "false");
-    j += "},";
+    w.literal(",\"camera\":{\"angle\":");
+    w.quoted(toString(p.camera.angle));
+    w.literal(",\"focal_length_mm\":");
+    w.number(p.camera.focalLengthMM);
+    w.literal(",\"depth_of_field\":");
+    w.boolean(p.camera.depthOfField);
+    w.literal("}");
 
     // Composition
-    j += "\"composition\":{";
-    j += "\"rule\":\""; j += toString(p.composition.rule); j += "\",";
-    j += "\"allow_cropping\":"; j += (p.composition.allowCropping ? "true" : "false"); j += ",";
-    j += "\"center_main_subject\":"; j += (p.composition.centerMainSubject ? "true" : "false");
-    j += "},";
+    w.literal(",\"composition\":{\"rule\":");
+    w.quoted(toString(p.composition.rule));
+    w.literal(",\"allow_cropping\":");
+    w.boolean(p.composition.allowCropping);
+    w.literal(",\"center_main_subject\":");
+    w.boolean(p.composition.centerMainSubject);
+    w.literal("}");
 
     // Art style
-    j += "\"art_style\":{";
-    j += "\"style\":\""; j += toString(p.artStyle.style); j += "\",";
-    j += "\"brush_detail\":\""; j += toString(p.artStyle.brushDetail); j += "\",";
-    j += "\"era_hint\":\"" + jsonEscape(p.artStyle.eraHint) + "\"";
-    j += "},";
+    w.literal(",\"art_style\":{\"style\":");
+    w.quoted(toString(p.artStyle.style));
+    w.literal(",\"brush_detail\":");
+    w.quoted(toString(p.artStyle.brushDetail));
+    w.literal(",\"era_hint\":");
+    w.string(p.artStyle.eraHint);
+    w.literal("}");
 
     // Negatives
-    j += "\"negative_constraints\":{";
-    j += "\"visual_artifacts\":\"" + jsonEscape(p.negatives.visualArtifacts) + "\",";
-    j += "\"content_exclusions\":\"" + jsonEscape(p.negatives.contentExclusions) + "\"";
-    j += "}";
+    w.literal(",\"negative_constraints\":{\"visual_artifacts\":");
+    w.string(p.negatives.visualArtifacts);
+    w.literal(",\"content_exclusions\":");
+    w.string(p.negatives.contentExclusions);
+    w.literal("}}");
 
-    j += "}";
-    return j;
+    w.finish();
+}
+
+// Serializes into `out`, replacing its contents; reuse the same string across
+// calls to keep its capacity.
+static void serializeScenePlanToJSON(const VCScenePlan &p, std::string &out) {
+    out.clear();
+    appendScenePlanJSON(p, out);
 }
 
 struct VCSemanticIGResult {
@@ -716,19 +2129,64 @@ struct VCSemanticIGResult {
     std::string jsonControl;      // Canonical JSON for downstream adapters
 };
 
-// High-level entry point.
+// Reference-image variant: paletteHint comes from the reference image
+// (see pipelines/cpp/dominant_palette_extractor.cpp). Only applied to modes
+// that actually carry a reference image.
 static VCSemanticIGResult BuildSemanticIGSpec(const std::string &userPrompt,
                                               VCIGMode mode,
                                               VCSafetyProfile safety,
-                                              VCQualityPreset quality) {
+                                              VCQualityPreset quality,
+                                              const std::string &referencePaletteHint) {
     VCSemanticIGResult result;
     result.scene = buildScenePlanFromPrompt(userPrompt, mode, safety, quality);
-    result.jsonControl = serializeScenePlanToJSON(result.scene);
+    if (mode != VCIGMode::TextToImage && !referencePaletteHint.empty())
+        result.scene.colorLighting.paletteHint = referencePaletteHint;
+    serializeScenePlanToJSON(result.scene, result.jsonControl);
     return result;
 }
 
+// High-level entry point.
+static inline VCSemanticIGResult BuildSemanticIGSpec(const std::string &userPrompt,
+                                                     VCIGMode mode,
+                                                     VCSafetyProfile safety,
+                                                     VCQualityPreset quality) {
+    return BuildSemanticIGSpec(userPrompt, mode, safety, quality, std::string());
+}
+
+} // namespace vc_vlig
+
 #ifdef VC_VLIG_SEMANTIC_ROUTER_DEMO
+#include <random>
+
+// The original masking loop, kept as the reference for the demo's
+// differential check.
+static std::string referenceStripNSFWMarkers(const std::string &in) {
+    using vc_vlig::toLowerASCII;
+    static const char* kBlockList[] = {
+        "nsfw", "nude", "nudity", "porn", "explicit", "sexual", "erotic"
+    };
+    std::string lower = in;
+    for (char &c : lower)
+        c = toLowerASCII(c);
+    std::string out = in;
+    for (const char* token : kBlockList) {
+        std::string t(token);
+        std::size_t pos = 0;
+        while (true) {
+            pos = lower.find(t, pos);
+            if (pos == std::string::npos) break;
+            for (std::size_t i = 0; i < t.size() && (pos + i) < out.size(); ++i) {
+                out[pos + i] = '*';
+                lower[pos + i] = '*';
+            }
+            pos += t.size();
+        }
+    }
+    return out;
+}
+
 int main() {
+    using namespace vc_vlig;
     std::string prompt =
         "Ultra‑detailed cinematic portrait of a lone astronaut standing in a "
         "foggy forest at sunset, teal and orange color grade, soft lighting, "
@@ -743,8 +2201,33 @@ int main() {
 
     std::cout << "Sanitized core prompt:\n" << res.scene.corePrompt << "\n\n";
     std::cout << "Semantic control JSON:\n" << res.jsonControl << "\n";
-    return 0;
+
+    // Masking must match the reference loop, including overlapping and
+    // adjacent terms ("nuderotic", "pornporn", "sexualerotic").
+    static const char* kPieces[] = {
+        "nsfw", "nude", "nudity", "porn", "explicit", "sexual", "erotic",
+        "NuDe", "nud", "e", "rotic", "sexu", "alerotic", "nsf", "w", "ity",
+        "expli", "cit", "pornporn", "eroticexplicit", "nuderotic", " ", ", ",
+        "cat", "forest", "x"};
+    std::mt19937 rng(79);
+    int mismatches = 0;
+    VCPromptBuffers buffers;
+    for (int i = 0; i < 30000; ++i) {
+        std::string prompt = "a";
+        for (unsigned n = 1 + rng() % 12; n > 0; --n)
+            prompt += kPieces[rng() % (sizeof(kPieces) / sizeof(kPieces[0]))];
+        cleanPromptText(prompt, buffers);
+        const std::string expected = referenceStripNSFWMarkers(buffers.text);
+        VCKeywordHits hits;
+        stripNSFWMarkers(buffers.text, buffers.lower, hits);
+        if (buffers.text != expected && ++mismatches <= 3)
+            std::cout << "MISMATCH: \"" << prompt << "\" -> \"" << buffers.text
+                      << "\", reference \"" << expected << "\"\n";
+    }
+    std::cout << "\nMasking vs reference loop: " << mismatches
+              << " mismatches over 30000 prompts\n";
+    return mismatches == 0 ? 0 : 1;
 }
 #endif
 
-} // namespace vc_vlig
+#endif // VC_VLIG_SEMANTIC_GUIDED_ROUTER_CPP
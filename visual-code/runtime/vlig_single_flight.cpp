@@ -0,0 +1,376 @@
+// File: /visual-code/runtime/vlig_single_flight.cpp
+// Platform: Windows/Linux/Ubuntu, Android/iOS NDK
+// Language: C++ (sanitized, production-grade)
+// Purpose:
+//   Single-flight coalescing for generation requests. When a prompt goes
+//   viral, many requests plan to the same control JSON at once and would
+//   each run a full generation. Here the first request for a (canonical
+//   control JSON, seed) pair starts the work, and every identical request
+//   that arrives while it runs attaches to it. All of them receive the same
+//   immutable result, or the same exception.
+//
+//   Every caller is only a waiter. The work runs on an executor (a detached
+//   thread by default), so any waiter, including the first, can stop waiting
+//   through its VCCancelToken without affecting the others. When the last
+//   waiter cancels, the flight's own token is cancelled so the generator can
+//   stop early. The flight also leaves the table at that point, so a later
+//   identical request starts fresh instead of joining abandoned work.
+//
+//   A flight leaves the table as soon as it completes: this layer
+//   deduplicates concurrent work only. Caching finished results is
+//   VCScenePlanCache's job for plans and the caller's for images.
+//
+//   Lock order is table, then flight. Cancellation callbacks take only the
+//   flight lock and run outside the token's lock.
+
+#ifndef VC_VLIG_SINGLE_FLIGHT_CPP
+#define VC_VLIG_SINGLE_FLIGHT_CPP
+
+#include "vlig_semantic_guided_router.cpp"
+#include "vlig_scene_plan_cache.cpp"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <thread>
+
+namespace vc_vlig {
+
+// Shared cancellation flag; copies refer to the same state. Callbacks
+// registered with subscribe() run once, on the thread that calls cancel(),
+// or immediately if the token is already cancelled.
+class VCCancelToken {
+public:
+    VCCancelToken() : s_(std::make_shared<State>()) {}
+
+    void cancel() const {
+        std::vector<std::pair<uint64_t, std::function<void()>>> run;
+        {
+            std::lock_guard<std::mutex> lock(s_->mu);
+            if (s_->cancelled.exchange(true, std::memory_order_acq_rel)) return;
+            run.swap(s_->callbacks);
+        }
+        for (auto &cb : run)
+            cb.second();
+    }
+
+    bool cancelled() const { return s_->cancelled.load(std::memory_order_acquire); }
+
+    // Returns an id for unsubscribe(); 0 if the callback already ran.
+    uint64_t subscribe(std::function<void()> fn) const {
+        {
+            std::lock_guard<std::mutex> lock(s_->mu);
+            if (!s_->cancelled.load(std::memory_order_relaxed)) {
+                s_->callbacks.emplace_back(++s_->nextId, std::move(fn));
+                return s_->nextId;
+            }
+        }
+        fn();
+        return 0;
+    }
+
+    // The callback may still run once if cancel() is concurrently in
+    // progress; callbacks must tolerate that.
+    void unsubscribe(uint64_t id) const {
+        if (id == 0) return;
+        std::lock_guard<std::mutex> lock(s_->mu);
+        auto &cbs = s_->callbacks;
+        for (std::size_t i = 0; i < cbs.size(); ++i) {
+            if (cbs[i].first == id) {
+                cbs[i] = std::move(cbs.back());
+                cbs.pop_back();
+                return;
+            }
+        }
+    }
+
+private:
+    struct State {
+        std::mutex mu;
+        std::atomic<bool> cancelled{false};
+        uint64_t nextId = 0;
+        std::vector<std::pair<uint64_t, std::function<void()>>> callbacks;
+    };
+    std::shared_ptr<State> s_;
+};
+
+class VCCancelledError : public std::runtime_error {
+public:
+    VCCancelledError() : std::runtime_error("request cancelled") {}
+};
+
+struct VCSingleFlightStats {
+    uint64_t started = 0;     // computations actually run
+    uint64_t coalesced = 0;   // requests that joined one already running
+    uint64_t cancelled = 0;   // waiters that stopped waiting
+    uint64_t abandoned = 0;   // flights whose last waiter cancelled
+    std::size_t inFlight = 0;
+};
+
+// Key hash of a canonical control JSON and generation seed.
+static inline uint64_t hashSingleFlightKey(std::string_view canonicalJson, uint64_t seed) {
+    return fmix64(hashScenePlanKey(canonicalJson.data(), canonicalJson.size(), 0) ^
+                  fmix64(seed ^ 0xD6E8FEB86659FD93ull));
+}
+
+template <class Result>
+class VCSingleFlight {
+public:
+    using Value = std::shared_ptr<const Result>;
+    using Executor = std::function<void(std::function<void()>)>;
+
+    // `executor` runs each computation; the default gives each one a
+    // detached thread. The work may outlive this object.
+    explicit VCSingleFlight(Executor executor = {})
+        : table_(std::make_shared<Table>()), executor_(std::move(executor)) {
+        if (!executor_)
+            executor_ = [](std::function<void()> job) { std::thread(std::move(job)).detach(); };
+    }
+
+    VCSingleFlight(const VCSingleFlight &) = delete;
+    VCSingleFlight &operator=(const VCSingleFlight &) = delete;
+
+    // Returns the result of fn(flightToken) for this key, running it only if
+    // no identical request is in flight. Blocks until the result is ready;
+    // throws VCCancelledError if `waiter` is cancelled first, or what fn
+    // threw. fn should poll flightToken and give up once it is cancelled.
+    template <class Fn>
+    Value run(std::string_view canonicalJson, uint64_t seed, Fn &&fn,
+              const VCCancelToken &waiter = VCCancelToken()) {
+        if (waiter.cancelled()) throw VCCancelledError();
+        const uint64_t hash = hashSingleFlightKey(canonicalJson, seed);
+        std::shared_ptr<Flight> flight;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(table_->mu);
+            auto range = table_->flights.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second->seed == seed && it->second->key == canonicalJson) {
+                    flight = it->second;
+                    break;
+                }
+            }
+            if (flight) {
+                ++table_->stats.coalesced;
+            } else {
+                flight = std::make_shared<Flight>();
+                flight->hash = hash;
+                flight->seed = seed;
+                flight->key.assign(canonicalJson.data(), canonicalJson.size());
+                table_->flights.emplace(hash, flight);
+                ++table_->stats.started;
+                leader = true;
+            }
+            std::lock_guard<std::mutex> fl(flight->mu);
+            ++flight->waiters;
+        }
+
+        if (leader) {
+            std::shared_ptr<Table> table = table_;
+            executor_([table, flight, fn = std::forward<Fn>(fn)]() mutable {
+                Value value;
+                std::exception_ptr error;
+                try {
+                    const VCCancelToken &token = flight->token;
+                    value = std::make_shared<const Result>(fn(token));
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(table->mu);
+                    table->erase(flight);
+                }
+                std::lock_guard<std::mutex> fl(flight->mu);
+                flight->value = std::move(value);
+                flight->error = error;
+                flight->done = true;
+                flight->cv.notify_all();
+            });
+        }
+
+        const uint64_t sub = waiter.subscribe([flight] {
+            std::lock_guard<std::mutex> fl(flight->mu);
+            flight->cv.notify_all();
+        });
+        {
+            std::unique_lock<std::mutex> fl(flight->mu);
+            flight->cv.wait(fl, [&] { return flight->done || waiter.cancelled(); });
+            if (flight->done) {
+                --flight->waiters;
+                fl.unlock();
+                waiter.unsubscribe(sub);
+                if (flight->error) std::rethrow_exception(flight->error);
+                return flight->value;
+            }
+        }
+        waiter.unsubscribe(sub);
+
+        bool abandon = false;
+        {
+            std::lock_guard<std::mutex> lock(table_->mu);
+            std::lock_guard<std::mutex> fl(flight->mu);
+            ++table_->stats.cancelled;
+            abandon = --flight->waiters == 0 && !flight->done;
+            if (abandon) {
+                table_->erase(flight);
+                ++table_->stats.abandoned;
+            }
+        }
+        if (abandon)
+            flight->token.cancel();
+        throw VCCancelledError();
+    }
+
+    VCSingleFlightStats stats() const {
+        std::lock_guard<std::mutex> lock(table_->mu);
+        VCSingleFlightStats s = table_->stats;
+        s.inFlight = table_->flights.size();
+        return s;
+    }
+
+private:
+    struct Flight {
+        uint64_t hash = 0;
+        uint64_t seed = 0;
+        std::string key;
+        VCCancelToken token;  // cancelled once nobody waits any more
+        std::mutex mu;
+        std::condition_variable cv;
+        std::size_t waiters = 0;
+        bool done = false;
+        Value value;
+        std::exception_ptr error;
+    };
+
+    struct Table {
+        std::mutex mu;
+        std::unordered_multimap<uint64_t, std::shared_ptr<Flight>> flights;
+        VCSingleFlightStats stats;
+
+        // Removes `f` if it is still the table's entry for its key.
+        void erase(const std::shared_ptr<Flight> &f) {
+            auto range = flights.equal_range(f->hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == f) {
+                    flights.erase(it);
+                    return;
+                }
+            }
+        }
+    };
+
+    std::shared_ptr<Table> table_;
+    Executor executor_;
+};
+
+// Plans `userPrompt` and runs generate(spec, seed, flightToken) once per
+// distinct (control JSON, seed) among concurrent callers.
+template <class Result, class Generate>
+static std::shared_ptr<const Result>
+BuildAndGenerateCoalesced(VCSingleFlight<Result> &flights, const std::string &userPrompt,
+                          VCIGMode mode, VCSafetyProfile safety, VCQualityPreset quality,
+                          uint64_t seed, Generate &&generate,
+                          const VCCancelToken &waiter = VCCancelToken()) {
+    auto spec = std::make_shared<const VCSemanticIGResult>(
+        BuildSemanticIGSpec(userPrompt, mode, safety, quality));
+    return flights.run(spec->jsonControl, seed,
+                       [spec, seed, generate](const VCCancelToken &token) {
+                           return generate(*spec, seed, token);
+                       },
+                       waiter);
+}
+
+} // namespace vc_vlig
+
+#ifdef VC_VLIG_SINGLE_FLIGHT_DEMO
+#include <chrono>
+
+int main() {
+    using namespace vc_vlig;
+    using namespace std::chrono_literals;
+    struct Image {
+        std::string spec;
+        uint64_t seed;
+    };
+    std::atomic<int> generations{0};
+    std::atomic<int> stoppedEarly{0};
+    // Stand-in generator: 200 ms of "denoising" in 10 ms steps.
+    auto generate = [&](const VCSemanticIGResult &spec, uint64_t seed, const VCCancelToken &token) {
+        generations.fetch_add(1);
+        for (int step = 0; step < 20; ++step) {
+            if (token.cancelled()) {
+                stoppedEarly.fetch_add(1);
+                throw VCCancelledError();
+            }
+            std::this_thread::sleep_for(10ms);
+        }
+        return Image{spec.jsonControl, seed};
+    };
+
+    VCSingleFlight<Image> flights;
+    const std::string viral = "Ultra-detailed cinematic portrait of a corgi astronaut on the moon, 16:9";
+    const int callers = 64;
+    std::atomic<int> served{0}, cancelled{0}, sameObject{0};
+    std::shared_ptr<const Image> first;
+    std::mutex firstMu;
+    std::vector<std::thread> pool;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < callers; ++i) {
+        pool.emplace_back([&, i] {
+            // Trailing whitespace differs per caller but plans identically.
+            const std::string prompt = viral + (i % 2 ? "  " : "") + (i % 3 ? "\t" : "");
+            VCCancelToken mine;
+            std::thread impatient;
+            if (i % 8 == 0)  // every eighth user closes the tab after 50 ms
+                impatient = std::thread([mine] { std::this_thread::sleep_for(50ms); mine.cancel(); });
+            try {
+                auto img = BuildAndGenerateCoalesced(flights, prompt, VCIGMode::TextToImage,
+                                                     VCSafetyProfile::Safe, VCQualityPreset::High,
+                                                     42, generate, mine);
+                served.fetch_add(1);
+                std::lock_guard<std::mutex> lock(firstMu);
+                if (!first) first = img;
+                if (first == img) sameObject.fetch_add(1);
+            } catch (const VCCancelledError &) {
+                cancelled.fetch_add(1);
+            }
+            if (impatient.joinable()) impatient.join();
+        });
+    }
+    for (std::thread &t : pool) t.join();
+    auto t1 = std::chrono::steady_clock::now();
+
+    // Everyone waiting on a flight cancels: the generator is told to stop.
+    {
+        VCCancelToken a, b;
+        std::thread ta([&] {
+            try { flights.run("{\"x\":1}", 7, [&](const VCCancelToken &t) {
+                      return generate(VCSemanticIGResult{}, 7, t); }, a); } catch (const VCCancelledError &) {}
+        });
+        std::thread tb([&] {
+            try { flights.run("{\"x\":1}", 7, [&](const VCCancelToken &t) {
+                      return generate(VCSemanticIGResult{}, 7, t); }, b); } catch (const VCCancelledError &) {}
+        });
+        std::this_thread::sleep_for(30ms);
+        a.cancel();
+        b.cancel();
+        ta.join();
+        tb.join();
+        std::this_thread::sleep_for(50ms);  // let the generator notice
+    }
+
+    const VCSingleFlightStats s = flights.stats();
+    std::cout << callers << " identical requests in "
+              << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms: "
+              << generations.load() - 1 << " generation(s), " << served.load() << " served ("
+              << sameObject.load() << " sharing one result), " << cancelled.load()
+              << " cancelled by their callers\n";
+    std::cout << "stats: started " << s.started << ", coalesced " << s.coalesced
+              << ", cancelled " << s.cancelled << ", abandoned " << s.abandoned
+              << ", generators stopped early " << stoppedEarly.load() << ", in flight "
+              << s.inFlight << "\n";
+    return generations.load() == 2 && stoppedEarly.load() == 1 && s.inFlight == 0 ? 0 : 1;
+}
+#endif
+
+#endif // VC_VLIG_SINGLE_FLIGHT_CPP